@@ -270,7 +270,7 @@
 				document(concat('data/timings_', $input, '_', $algnum, '_5.xml')) |
 				document(concat('data/timings_', $input, '_', $algnum, '_6.xml')) |
 				document(concat('data/timings_', $input, '_', $algnum, '_7.xml'))
-				)/event/time"/>
+				)/events/event/time"/>
 			<abbr title="{$events[1]/@seconds} {$events[2]/@seconds} {$events[3]/@seconds} {$events[4]/@seconds} {$events[5]/@seconds} {$events[6]/@seconds} {$events[7]/@seconds}">
 			<xsl:value-of select="format-number(
 				(sum($events/@seconds) - math:min($events/@seconds) - math:max($events/@seconds)) div 5,
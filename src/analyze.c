@@ -0,0 +1,141 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/*
+ * Exact input characterization: the strings are sorted with a fast routine,
+ * and a single pass over the sorted order computes the LCP of each pair of
+ * neighbours, the distinguishing prefixes and the histograms.
+ */
+
+#include "analyze.h"
+#include "routines.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static unsigned
+bucket(unsigned long long v)
+{
+	unsigned b = 0;
+	while (v) {
+		v >>= 1;
+		++b;
+	}
+	return b;
+}
+
+static int
+cmp(const void *a, const void *b)
+{
+	return strcmp(*(const char **)a, *(const char **)b);
+}
+
+static void
+sort_strings(unsigned char **strings, size_t n)
+{
+	const struct routine *r = NULL;
+#ifdef _OPENMP
+	if (omp_get_max_threads() > 1)
+		r = routine_from_name("parallel_msd_radix_sort");
+#endif
+	if (!r)
+		r = routine_from_name("msd_CE2");
+	if (r)
+		r->f(strings, n);
+	else
+		qsort(strings, n, sizeof(unsigned char *), cmp);
+}
+
+static size_t
+lcp(const unsigned char *a, const unsigned char *b)
+{
+	size_t i = 0;
+	while (a[i] && a[i] == b[i])
+		++i;
+	return i;
+}
+
+int
+analyze_strings(unsigned char **strings, size_t n, size_t sample,
+		struct input_analysis *a)
+{
+	unsigned char **s;
+	unsigned long long total_len = 0, max_len = 0;
+	unsigned long long dprefix = 0, lcp_total = 0, lcp_max = 0;
+	size_t duplicates = 0;
+	size_t lcp_hist[ANALYZE_BUCKETS] = { 0 };
+	size_t len_hist[ANALYZE_BUCKETS] = { 0 };
+	unsigned char chars[256] = { 0 };
+	if (sample == 0 || sample > n)
+		sample = n;
+	memset(a, 0, sizeof(*a));
+	a->n = sample;
+	if (sample == 0)
+		return 0;
+	s = malloc(sample * sizeof(unsigned char *));
+	if (!s)
+		return -1;
+	for (size_t i=0; i < sample; ++i)
+		s[i] = strings[i*(n/sample) + (i*(n%sample))/sample];
+	sort_strings(s, sample);
+#pragma omp parallel for schedule(dynamic, 4096) \
+	reduction(+:total_len,dprefix,lcp_total,duplicates,lcp_hist[:ANALYZE_BUCKETS],len_hist[:ANALYZE_BUCKETS]) \
+	reduction(max:max_len,lcp_max) reduction(|:chars[:256])
+	for (size_t i=0; i < sample; ++i) {
+		size_t len, lp = 0, ln = 0, dp;
+		for (len=0; s[i][len]; ++len)
+			chars[s[i][len]] = 1;
+		if (i) {
+			lp = lcp(s[i-1], s[i]);
+			if (lp == len && s[i-1][lp] == 0)
+				++duplicates;
+			lcp_total += lp;
+			if (lp > lcp_max)
+				lcp_max = lp;
+			++lcp_hist[bucket(lp)];
+		}
+		if (i+1 < sample)
+			ln = lcp(s[i], s[i+1]);
+		dp = (lp > ln ? lp : ln) + 1;
+		dprefix += dp;
+		total_len += len;
+		if (len > max_len)
+			max_len = len;
+		++len_hist[bucket(len)];
+	}
+	free(s);
+	a->duplicates = duplicates;
+	a->total_len = total_len;
+	a->max_len = max_len;
+	a->dprefix = dprefix;
+	a->lcp_total = lcp_total;
+	a->lcp_max = lcp_max;
+	memcpy(a->lcp_histogram, lcp_hist, sizeof(lcp_hist));
+	memcpy(a->len_histogram, len_hist, sizeof(len_hist));
+	memcpy(a->chars, chars, sizeof(chars));
+	for (unsigned c=0; c < 256; ++c)
+		a->alphabet += chars[c];
+	return 0;
+}
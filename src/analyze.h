@@ -0,0 +1,55 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include <stddef.h>
+
+/* Bucket 0 counts zero values, bucket i counts values in [2^(i-1), 2^i). */
+#define ANALYZE_BUCKETS 65
+
+struct input_analysis {
+	size_t n;
+	size_t duplicates;
+	unsigned alphabet;
+	unsigned char chars[256];
+	unsigned long long total_len;
+	unsigned long long max_len;
+	/* Total length of the distinguishing prefixes, counting the
+	 * terminating null byte when it must be inspected. */
+	unsigned long long dprefix;
+	unsigned long long lcp_total;
+	unsigned long long lcp_max;
+	size_t lcp_histogram[ANALYZE_BUCKETS];
+	size_t len_histogram[ANALYZE_BUCKETS];
+};
+
+/* Analyzes the strings, or an evenly spaced sample of `sample' strings if
+ * sample is nonzero and smaller than n. The LCP and distinguishing prefix
+ * values of a sample underestimate the values of the full input. The input
+ * array is not modified. Returns -1 if out of memory. */
+int analyze_strings(unsigned char **strings, size_t n, size_t sample,
+		struct input_analysis *);
+
+#endif /* ANALYZE_H */
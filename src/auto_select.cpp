@@ -0,0 +1,223 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/* Selects a sorting routine based on statistics sampled from the input.
+ *
+ * The decision model is a set of prototypes: feature vectors of benchmarked
+ * inputs, each labelled with the fastest routine for that input. The input
+ * is dispatched to the routine of the nearest prototype, with the distance
+ * computed over logarithmically scaled features. A built-in model covers the
+ * typical input classes, and a model trained from benchmark results with
+ * report/train-auto-model can be given in $SORTSTRING_AUTO_MODEL.
+ *
+ * Model file format, one prototype per line, '#' starts a comment:
+ *
+ *     n alphabet dprefix duplicates avg_len routine
+ */
+
+#include "routine.h"
+#include "routines.h"
+#include "auto_select.h"
+#include "util/debug.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/* The sample size, and the maximum number of bytes examined per string. */
+static const size_t sample_size = 4096;
+static const size_t sample_maxlen = 4096;
+
+static size_t
+capped_lcp(const unsigned char* a, const unsigned char* b)
+{
+	size_t i = 0;
+	while (i < sample_maxlen && a[i] && a[i] == b[i]) ++i;
+	return i;
+}
+
+static size_t
+capped_len(const unsigned char* a)
+{
+	size_t i = 0;
+	while (i < sample_maxlen && a[i]) ++i;
+	return i;
+}
+
+extern "C" void
+input_features_sample(unsigned char** strings, size_t n,
+		struct input_features* f)
+{
+	const size_t k = std::min(n, sample_size);
+	std::vector<unsigned char*> sample(k);
+	std::vector<size_t> lcp(k+1, 0);
+	bool seen[256] = { false };
+	double len_sum = 0, dprefix_sum = 0;
+	size_t dups = 0;
+	f->n = n;
+	f->alphabet = 0;
+	f->dprefix = f->duplicates = f->avg_len = 0;
+	if (k == 0) return;
+	for (size_t i=0; i < k; ++i)
+		sample[i] = strings[i*n/k];
+	for (size_t i=0; i < k; ++i) {
+		size_t len = capped_len(sample[i]);
+		for (size_t j=0; j < len; ++j)
+			seen[sample[i][j]] = true;
+		len_sum += len;
+	}
+	for (unsigned c=0; c < 256; ++c)
+		f->alphabet += seen[c];
+	std::sort(sample.begin(), sample.end(),
+		[](const unsigned char* a, const unsigned char* b) {
+			return strcmp((const char*)a, (const char*)b) < 0; });
+	for (size_t i=1; i < k; ++i) {
+		lcp[i] = capped_lcp(sample[i-1], sample[i]);
+		if (strcmp((const char*)sample[i-1], (const char*)sample[i]) == 0)
+			++dups;
+	}
+	for (size_t i=0; i < k; ++i) {
+		size_t len = capped_len(sample[i]);
+		dprefix_sum += std::min(std::max(lcp[i], lcp[i+1]) + 1, len);
+	}
+	f->avg_len = len_sum / k;
+	f->duplicates = k > 1 ? double(dups) / (k-1) : 0;
+	f->dprefix = dprefix_sum / k;
+	/* Sampled neighbours are further apart than the neighbours in the full
+	 * input. With an alphabet of size a, each a-fold increase in density
+	 * adds roughly one character to the LCPs of random strings. */
+	if (n > k && f->alphabet > 1)
+		f->dprefix += std::log(double(n)/k) / std::log(double(f->alphabet));
+	f->dprefix = std::min(f->dprefix, f->avg_len + 1);
+}
+
+struct prototype
+{
+	input_features f;
+	std::string routine;
+};
+
+static const prototype builtin_model[] = {
+	/* URLs: long shared prefixes, moderate alphabet. */
+	{ { 1000000, 70,  30.0, 0.05,  60.0 }, "burstsort2_superalphabet_vector" },
+	/* Random strings: short distinguishing prefixes. */
+	{ { 1000000, 62,   5.0, 0.00,  10.0 }, "msd_CE2" },
+	{ { 1000000,  4,  12.0, 0.00,  12.0 }, "msd_CE2" },
+	/* Genome data: long LCPs over a tiny alphabet. */
+	{ { 1000000,  4, 200.0, 0.00, 250.0 }, "mergesort_lcp_2way" },
+	/* Many duplicates, e.g. words of natural language. */
+	{ { 1000000, 30,   8.0, 0.80,   8.0 }, "multikey_simd1" },
+	/* Small inputs. */
+	{ {    1000, 60,   5.0, 0.00,  10.0 }, "multikey_simd1" },
+};
+
+static std::vector<prototype>
+load_model()
+{
+	std::vector<prototype> model;
+	const char* filename = getenv("SORTSTRING_AUTO_MODEL");
+	if (filename && *filename) {
+		FILE* fp = fopen(filename, "r");
+		char line[1024];
+		if (!fp) {
+			fprintf(stderr, "WARNING: unable to open auto_select "
+					"model '%s', using the built-in model.\n",
+					filename);
+		}
+		while (fp && fgets(line, sizeof(line), fp)) {
+			prototype p;
+			char name[256];
+			if (line[0] == '#')
+				continue;
+			if (sscanf(line, "%zu %u %lf %lf %lf %255s", &p.f.n,
+					&p.f.alphabet, &p.f.dprefix,
+					&p.f.duplicates, &p.f.avg_len, name) != 6)
+				continue;
+			p.routine = name;
+			model.push_back(p);
+		}
+		if (fp)
+			fclose(fp);
+	}
+	if (model.empty())
+		model.assign(std::begin(builtin_model), std::end(builtin_model));
+	return model;
+}
+
+static double
+distance(const input_features& a, const input_features& b)
+{
+	double d = 0, x;
+	x = std::log(a.n+1.0) - std::log(b.n+1.0);              d += 0.25*x*x;
+	x = std::log(a.alphabet+1.0) - std::log(b.alphabet+1.0); d += x*x;
+	x = std::log1p(a.dprefix) - std::log1p(b.dprefix);       d += 2*x*x;
+	x = 4*(a.duplicates - b.duplicates);                     d += x*x;
+	x = std::log1p(a.avg_len) - std::log1p(b.avg_len);       d += x*x;
+	return d;
+}
+
+void auto_select(unsigned char**, size_t);
+
+static const routine*
+select_routine(const input_features& f)
+{
+	static const std::vector<prototype> model = load_model();
+	const routine* best = nullptr;
+	double best_distance = 0;
+	for (const prototype& p : model) {
+		const routine* r = routine_from_name(p.routine.c_str());
+		// auto_select is registered as a single core routine, so a
+		// model trained on older results must not make it parallel.
+		if (!r || r->f == auto_select || r->multicore) continue;
+		double d = distance(f, p.f);
+		if (!best || d < best_distance) {
+			best = r;
+			best_distance = d;
+		}
+	}
+	return best;
+}
+
+void auto_select(unsigned char** strings, size_t n)
+{
+	input_features f;
+	if (n < 2) return;
+	input_features_sample(strings, n, &f);
+	const routine* r = select_routine(f);
+	debug() << __func__ << "(): n=" << n << ", alphabet=" << f.alphabet
+		<< ", dprefix=" << f.dprefix << ", duplicates=" << f.duplicates
+		<< ", avg_len=" << f.avg_len << " => "
+		<< (r ? r->name : "std::sort") << "\n";
+	if (r) {
+		r->f(strings, n);
+		return;
+	}
+	std::sort(strings, strings+n,
+		[](const unsigned char* a, const unsigned char* b) {
+			return strcmp((const char*)a, (const char*)b) < 0; });
+}
+ROUTINE_REGISTER_SINGLECORE(auto_select,
+		"Selects the routine from sampled input statistics")
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef AUTO_SELECT_H
+#define AUTO_SELECT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Statistics estimated from a sample of the input strings. */
+struct input_features {
+	size_t n;
+	/* Number of distinct byte values. */
+	unsigned alphabet;
+	/* Estimated average length of the distinguishing prefix. */
+	double dprefix;
+	/* Fraction of strings equal to their predecessor in sorted order. */
+	double duplicates;
+	double avg_len;
+};
+
+void input_features_sample(unsigned char **strings, size_t n,
+		struct input_features *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUTO_SELECT_H */
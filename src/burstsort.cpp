@@ -40,6 +40,7 @@
 #include "routine.h"
 #include "util/get_char.h"
 #include "util/debug.h"
+#include "util/insertion_sort.h"
 #include <vector>
 #include <iostream>
 #include <bitset>
@@ -76,6 +77,7 @@ struct BurstSimple
 	TrieNode<CharT>*
 	operator()(const BucketT& bucket, size_t depth) const
 	{
+		typedef typename BucketT::value_type StringT;
 		TrieNode<CharT>* new_node = new TrieNode<CharT>;
 		const unsigned bucket_size = bucket.size();
 		// Use a small cache to reduce memory stalls. Also cache the
@@ -84,7 +86,7 @@ struct BurstSimple
 		unsigned i=0;
 		for (; i < bucket_size-bucket_size%64; i+=64) {
 			array<CharT, 64> cache;
-			array<unsigned char*, 64> strings;
+			array<StringT, 64> strings;
 			for (unsigned j=0; j < 64; ++j) {
 				strings[j] = bucket[i+j];
 				cache[j] = get_char<CharT>(strings[j], depth);
@@ -101,7 +103,7 @@ struct BurstSimple
 			}
 		}
 		for (; i < bucket_size; ++i) {
-			unsigned char* ptr = bucket[i];
+			StringT ptr = bucket[i];
 			const CharT ch = get_char<CharT>(ptr, depth);
 			BucketT* sub_bucket = static_cast<BucketT*>(
 				new_node->buckets[ch]);
@@ -124,6 +126,7 @@ struct BurstRecursive
 	TrieNode<CharT>*
 	operator()(const BucketT& bucket, size_t depth) const
 	{
+		typedef typename BucketT::value_type StringT;
 		TrieNode<CharT>* new_node
 			= BurstSimple<CharT>()(bucket, depth);
 		const size_t threshold = std::max(
@@ -137,7 +140,7 @@ struct BurstRecursive
 			if (not is_end(i) and sub_bucket->size() > threshold) {
 				new_node->buckets[i] =
 					BurstRecursive<CharT>()(*sub_bucket,
-							depth+sizeof(CharT));
+						depth+char_step<CharT, StringT>::value);
 				delete sub_bucket;
 				new_node->is_trie[i] = true;
 			}
@@ -147,9 +150,9 @@ struct BurstRecursive
 };
 
 // Uses a random sample to create an initial tree.
-template <typename CharT>
+template <typename CharT, typename StringT>
 static TrieNode<CharT>*
-random_sample(unsigned char** strings, size_t n)
+random_sample(StringT* strings, size_t n)
 {
 	// Limit the maximum number of nodes to whatever fits in 30 megabytes.
 	const size_t sample_size = n/8192;
@@ -157,13 +160,13 @@ random_sample(unsigned char** strings, size_t n)
 	debug()<<__PRETTY_FUNCTION__<<" sampling "<<sample_size<<" strings\n";
 	TrieNode<CharT>* root = new TrieNode<CharT>;
 	for (size_t i=0; i < sample_size; ++i) {
-		unsigned char* str = strings[size_t(drand48()*n)];
+		const StringT& str = strings[size_t(drand48()*n)];
 		size_t depth = 0;
 		TrieNode<CharT>* node = root;
 		while (true) {
 			CharT c = get_char<CharT>(str, depth);
 			if (is_end(c)) break;
-			depth += sizeof(CharT);
+			depth += char_step<CharT, StringT>::value;
 			if (not node->is_trie[c]) {
 				node->is_trie[c] = true;
 				node->buckets[c] = new TrieNode<CharT>;
@@ -178,22 +181,22 @@ finish:
 }
 
 // Uses a pseudo random sample to create an initial tree.
-template <typename CharT>
+template <typename CharT, typename StringT>
 static TrieNode<CharT>*
-pseudo_sample(unsigned char** strings, size_t n)
+pseudo_sample(StringT* strings, size_t n)
 {
 	// Limit the maximum number of nodes to whatever fits in 30 megabytes.
 	debug()<<__func__<<"(): sampling "<<n/8192<<" strings ...\n";
 	size_t max_nodes = 30000000/sizeof(TrieNode<CharT>);
 	TrieNode<CharT>* root = new TrieNode<CharT>;
 	for (size_t i=0; i < n; i += 8192) {
-		unsigned char* str = strings[i];
+		const StringT& str = strings[i];
 		size_t depth = 0;
 		TrieNode<CharT>* node = root;
 		while (true) {
 			CharT c = get_char<CharT>(str, depth);
 			if (is_end(c)) break;
-			depth += sizeof(CharT);
+			depth += char_step<CharT, StringT>::value;
 			if (not node->is_trie[c]) {
 				node->is_trie[c] = true;
 				node->buckets[c] = new TrieNode<CharT>;
@@ -212,17 +215,19 @@ finish:
 template <unsigned Threshold, typename BucketT,
           typename BurstImpl, typename CharT>
 static inline void
-insert(TrieNode<CharT>* root, unsigned char** strings, size_t n)
+insert(TrieNode<CharT>* root, typename BucketT::value_type* strings,
+       size_t n)
 {
+	typedef typename BucketT::value_type StringT;
 	for (size_t i=0; i < n; ++i) {
-		unsigned char* str = strings[i];
+		const StringT& str = strings[i];
 		size_t depth = 0;
 		CharT c = get_char<CharT>(str, 0);
 		TrieNode<CharT>* node = root;
 		while (node->is_trie[c]) {
 			assert(not is_end(c));
 			node = static_cast<TrieNode<CharT>*>(node->buckets[c]);
-			depth += sizeof(CharT);
+			depth += char_step<CharT, StringT>::value;
 			c = get_char<CharT>(str, depth);
 		}
 		BucketT* bucket = static_cast<BucketT*>(node->buckets[c]);
@@ -233,7 +238,7 @@ insert(TrieNode<CharT>* root, unsigned char** strings, size_t n)
 		if (is_end(c)) continue;
 		if (bucket->size() > Threshold) {
 			node->buckets[c] = BurstImpl()(*bucket,
-					depth+sizeof(CharT));
+					depth+char_step<CharT, StringT>::value);
 			node->is_trie[c] = true;
 			delete bucket;
 		}
@@ -242,8 +247,9 @@ insert(TrieNode<CharT>* root, unsigned char** strings, size_t n)
 
 // Use a wrapper to std::copy(). I haven't implemented iterators for some of my
 // containers, instead they have optimized copy(bucket, dst).
+template <typename StringT>
 static inline void
-copy(const std::vector<unsigned char*>& bucket, unsigned char** dst)
+copy(const std::vector<StringT>& bucket, StringT* dst)
 {
 	std::copy(bucket.begin(), bucket.end(), dst);
 }
@@ -252,24 +258,27 @@ copy(const std::vector<unsigned char*>& bucket, unsigned char** dst)
 // Nodes and buckets are deleted from memory during the traversal. The root
 // node given to this function will also be deleted.
 template <typename BucketT, typename SmallSort, typename CharT>
-static unsigned char**
+static typename BucketT::value_type*
 traverse(TrieNode<CharT>* node,
-         unsigned char** dst,
+         typename BucketT::value_type* dst,
          size_t depth,
          SmallSort small_sort)
 {
+	typedef typename BucketT::value_type StringT;
 	for (unsigned i=0; i < max<CharT>::value; ++i) {
 		if (node->is_trie[i]) {
 			dst = traverse<BucketT>(
 				static_cast<TrieNode<CharT>*>(node->buckets[i]),
-				dst, depth+sizeof(CharT), small_sort);
+				dst, depth+char_step<CharT, StringT>::value,
+				small_sort);
 		} else {
 			BucketT* bucket =
 				static_cast<BucketT*>(node->buckets[i]);
 			if (not bucket) continue;
 			size_t bsize = bucket->size();
 			copy(*bucket, dst);
-			if (not is_end(i)) small_sort(dst, bsize, depth);
+			if (not is_end(i))
+				small_sort(dst, bsize, depth);
 			dst += bsize;
 			delete bucket;
 		}
@@ -278,12 +287,123 @@ traverse(TrieNode<CharT>* node,
 	return dst;
 }
 
+// Copies the strings of the trie to dst without sorting the buckets, and
+// deletes the trie.
+template <typename BucketT, typename CharT>
+static typename BucketT::value_type*
+dump(TrieNode<CharT>* node, typename BucketT::value_type* dst)
+{
+	for (unsigned i=0; i < max<CharT>::value; ++i) {
+		if (node->is_trie[i]) {
+			dst = dump<BucketT>(
+				static_cast<TrieNode<CharT>*>(node->buckets[i]),
+				dst);
+		} else {
+			BucketT* bucket =
+				static_cast<BucketT*>(node->buckets[i]);
+			if (not bucket) continue;
+			copy(*bucket, dst);
+			dst += bucket->size();
+			delete bucket;
+		}
+	}
+	delete node;
+	return dst;
+}
+
+// Same as traverse(), but only descends into the tries and sorts the buckets
+// that start before `limit'. Once dst reaches the limit, the rest of the trie
+// is dumped unsorted. The strings are still all inserted into the trie
+// before, so the saving is in the traversal only.
+template <typename BucketT, typename SmallSort, typename CharT>
+static typename BucketT::value_type*
+traverse_top(TrieNode<CharT>* node,
+             typename BucketT::value_type* dst,
+             size_t depth,
+             SmallSort small_sort,
+             typename BucketT::value_type* limit)
+{
+	typedef typename BucketT::value_type StringT;
+	for (unsigned i=0; i < max<CharT>::value; ++i) {
+		if (node->is_trie[i]) {
+			TrieNode<CharT>* sub =
+				static_cast<TrieNode<CharT>*>(node->buckets[i]);
+			if (dst < limit)
+				dst = traverse_top<BucketT>(sub, dst,
+					depth+char_step<CharT, StringT>::value,
+					small_sort, limit);
+			else
+				dst = dump<BucketT>(sub, dst);
+		} else {
+			BucketT* bucket =
+				static_cast<BucketT*>(node->buckets[i]);
+			if (not bucket) continue;
+			size_t bsize = bucket->size();
+			copy(*bucket, dst);
+			if (not is_end(i) and dst < limit)
+				small_sort(dst, bsize, depth);
+			dst += bsize;
+			delete bucket;
+		}
+	}
+	delete node;
+	return dst;
+}
+
+// Same as traverse(), and stores lcp[i] = lcp(begin[i-1], begin[i]) for the
+// strings copied after `begin'. The strings of a bucket share depth+1
+// characters, and the first string copied from a node shares at least `shared'
+// characters with its predecessor, so the trie saves most of the comparisons.
+template <typename BucketT, typename SmallSort>
+static unsigned char**
+traverse_lcp(TrieNode<unsigned char>* node,
+             unsigned char** dst,
+             size_t depth,
+             size_t shared,
+             SmallSort small_sort,
+             unsigned char** begin,
+             size_t* lcp)
+{
+	for (unsigned i=0; i < max<unsigned char>::value; ++i) {
+		if (node->is_trie[i]) {
+			dst = traverse_lcp<BucketT>(
+				static_cast<TrieNode<unsigned char>*>(
+					node->buckets[i]),
+				dst, depth+1, shared, small_sort, begin, lcp);
+		} else {
+			BucketT* bucket =
+				static_cast<BucketT*>(node->buckets[i]);
+			if (not bucket) continue;
+			size_t bsize = bucket->size();
+			copy(*bucket, dst);
+			size_t* bucket_lcp = lcp + (dst-begin);
+			if (is_end(i)) {
+				for (size_t j=1; j < bsize; ++j)
+					bucket_lcp[j] = depth;
+			} else {
+				small_sort(dst, bsize, depth);
+				lcp_sorted(dst, bsize, depth+1, bucket_lcp);
+			}
+			if (dst != begin)
+				bucket_lcp[0] = lcp_from(dst[-1], dst[0], shared);
+			dst += bsize;
+			delete bucket;
+		}
+		shared = depth;
+	}
+	delete node;
+	return dst;
+}
+
 #define SmallSort mkqsort
 extern "C" void mkqsort(unsigned char**, int, int);
 
 //#define SmallSort msd_CE2
 //void msd_CE2(unsigned char**, size_t, size_t);
 
+void msd_CE2(bstring*, size_t, size_t);
+static void (*const BinarySmallSort)(bstring*, size_t, size_t) = msd_CE2;
+
 //
 // Normal variants
 //
@@ -297,6 +417,17 @@ void burstsort_vector(unsigned char** strings, size_t n)
 	insert<8000, BucketT, BurstImpl>(root, strings, n);
 	traverse<BucketT>(root, strings, 0, SmallSort);
 }
+// Binary strings use the 16-bit characters of get_char(const bstring&), that
+// cover one byte each, so the trie nodes are as large as with superalphabet.
+void burstsort_vector_binary(bstring* strings, size_t n)
+{
+	typedef uint16_t CharT;
+	typedef std::vector<bstring> BucketT;
+	typedef BurstSimple<CharT> BurstImpl;
+	TrieNode<CharT>* root = new TrieNode<CharT>;
+	insert<32000, BucketT, BurstImpl>(root, strings, n);
+	traverse<BucketT>(root, strings, 0, BinarySmallSort);
+}
 void burstsort_brodnik(unsigned char** strings, size_t n)
 {
 	typedef unsigned char CharT;
@@ -372,6 +503,26 @@ void burstsort_superalphabet_vector_block(unsigned char** strings, size_t n)
 	traverse<BucketT>(root, strings, 0, SmallSort);
 }
 
+void burstsort_vector_top(unsigned char** strings, size_t n, size_t k)
+{
+	typedef unsigned char CharT;
+	typedef std::vector<unsigned char*> BucketT;
+	typedef BurstSimple<CharT> BurstImpl;
+	TrieNode<CharT>* root = new TrieNode<CharT>;
+	insert<8000, BucketT, BurstImpl>(root, strings, n);
+	traverse_top<BucketT>(root, strings, 0, SmallSort, strings+k);
+}
+void burstsort_vector_lcp(unsigned char** strings, size_t n, size_t* lcp)
+{
+	typedef unsigned char CharT;
+	typedef std::vector<unsigned char*> BucketT;
+	typedef BurstSimple<CharT> BurstImpl;
+	TrieNode<CharT>* root = new TrieNode<CharT>;
+	insert<8000, BucketT, BurstImpl>(root, strings, n);
+	traverse_lcp<BucketT>(root, strings, 0, 0, SmallSort, strings, lcp);
+	if (n) lcp[0] = 0;
+}
+
 //
 // Sampling variants - byte alphabet
 //
@@ -385,6 +536,36 @@ void burstsort_sampling_vector(unsigned char** strings, size_t n)
 	insert<8000, BucketT, BurstImpl>(root, strings, n);
 	traverse<BucketT>(root, strings, 0, SmallSort);
 }
+void burstsort_sampling_vector_binary(bstring* strings, size_t n)
+{
+	typedef uint16_t CharT;
+	typedef std::vector<bstring> BucketT;
+	typedef BurstSimple<CharT> BurstImpl;
+	TrieNode<CharT>* root = pseudo_sample<CharT>(strings, n);
+	insert<32000, BucketT, BurstImpl>(root, strings, n);
+	traverse<BucketT>(root, strings, 0, BinarySmallSort);
+}
+void burstsort_sampling_vector_top(unsigned char** strings, size_t n,
+		size_t k)
+{
+	typedef unsigned char CharT;
+	typedef std::vector<unsigned char*> BucketT;
+	typedef BurstSimple<CharT> BurstImpl;
+	TrieNode<CharT>* root = pseudo_sample<CharT>(strings, n);
+	insert<8000, BucketT, BurstImpl>(root, strings, n);
+	traverse_top<BucketT>(root, strings, 0, SmallSort, strings+k);
+}
+void burstsort_sampling_vector_lcp(unsigned char** strings, size_t n,
+		size_t* lcp)
+{
+	typedef unsigned char CharT;
+	typedef std::vector<unsigned char*> BucketT;
+	typedef BurstSimple<CharT> BurstImpl;
+	TrieNode<CharT>* root = pseudo_sample<CharT>(strings, n);
+	insert<8000, BucketT, BurstImpl>(root, strings, n);
+	traverse_lcp<BucketT>(root, strings, 0, 0, SmallSort, strings, lcp);
+	if (n) lcp[0] = 0;
+}
 void burstsort_sampling_brodnik(unsigned char** strings, size_t n)
 {
 	typedef unsigned char CharT;
@@ -460,8 +641,11 @@ void burstsort_sampling_superalphabet_vector_block(unsigned char** strings, size
 	traverse<BucketT>(root, strings, 0, SmallSort);
 }
 
-ROUTINE_REGISTER_SINGLECORE(burstsort_vector,
-		"burstsort with std::vector bucket type")
+ROUTINE_REGISTER_FULL(burstsort_vector,
+		"burstsort with std::vector bucket type", 0,
+		ROUTINE_BINARY(burstsort_vector_binary),
+		ROUTINE_TOP(burstsort_vector_top),
+		ROUTINE_LCP(burstsort_vector_lcp))
 ROUTINE_REGISTER_SINGLECORE(burstsort_brodnik,
 		"burstsort with vector_brodnik bucket type")
 ROUTINE_REGISTER_SINGLECORE(burstsort_bagwell,
@@ -478,8 +662,11 @@ ROUTINE_REGISTER_SINGLECORE(burstsort_superalphabet_bagwell,
 ROUTINE_REGISTER_SINGLECORE(burstsort_superalphabet_vector_block,
 		"superalphabet burstsort with vector_block bucket type")
 
-ROUTINE_REGISTER_SINGLECORE(burstsort_sampling_vector,
-		"sampling burstsort with std::vector bucket type")
+ROUTINE_REGISTER_FULL(burstsort_sampling_vector,
+		"sampling burstsort with std::vector bucket type", 0,
+		ROUTINE_BINARY(burstsort_sampling_vector_binary),
+		ROUTINE_TOP(burstsort_sampling_vector_top),
+		ROUTINE_LCP(burstsort_sampling_vector_lcp))
 ROUTINE_REGISTER_SINGLECORE(burstsort_sampling_brodnik,
 		"sampling burstsort with vector_brodnik bucket type")
 ROUTINE_REGISTER_SINGLECORE(burstsort_sampling_bagwell,
@@ -27,6 +27,7 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/get_char.h"
 #include "util/median.h"
 #include "util/debug.h"
@@ -253,14 +254,14 @@ burst_insert(TSTNode<CharT>* root, unsigned char** strings, size_t N)
 				depth += sizeof(CharT);
 			}
 			CharT* oracle = static_cast<CharT*>(
-				malloc(buck->size()*sizeof(CharT)));
+				big_malloc(buck->size()*sizeof(CharT)));
 			for (unsigned j=0; j < buck->size(); ++j) {
 				oracle[j] = get_char<CharT>((*buck)[j], depth);
 			}
 			assert(verify_tst<BucketT>(root, 0));
 			TSTNode<CharT>* new_node
 				= BurstImpl()(*buck, oracle, depth);
-			free(oracle);
+			big_free(oracle);
 			delete buck;
 			node->buckets[bucket] = new_node;
 			node->is_tst[bucket] = true;
@@ -0,0 +1,547 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * External memory sorting, for inputs that are larger than the available
+ * memory. Works in two phases:
+ *
+ *   1. Run formation: the input file is read in chunks. The text of a chunk
+ *      and its string pointers share one buffer of `memory' bytes minus the
+ *      block of the run writer. Each chunk is sorted with any of the
+ *      registered routines, and written to a temporary file as a sorted run,
+ *      together with the LCP of each string with its predecessor. Routines
+ *      with a scratch variant get their temporary memory from the same
+ *      buffer; the temporary memory of other routines is not counted.
+ *
+ *   2. Merging: runs are merged with the LCP aware loser tree from
+ *      losertree.h, so that strings are compared only after the distinguishing
+ *      prefix known from the LCP values. Each run is read through two block
+ *      buffers: while one is being merged, the next block of the run is read
+ *      into the other buffer with asynchronous I/O. When the buffers of all
+ *      runs and the output block do not fit in `memory' bytes, groups of runs
+ *      are first merged into longer runs, in as many passes as needed.
+ *
+ * Run file format: a sequence of blocks of `block_size' bytes. Each block
+ * starts with the amount of used bytes as uint32_t, followed by records that
+ * never cross block boundaries:
+ *
+ *     [LCP varint] [length varint] [string bytes] [NULL byte]
+ */
+
+#include "routine.h"
+#include "external_sort.h"
+#include "losertree.h"
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <aio.h>
+
+static void
+fatal(const char* msg, const char* arg)
+{
+	fprintf(stderr, "ERROR: external sort: %s '%s': %s.\n",
+			msg, arg, strerror(errno));
+	exit(1);
+}
+
+static void*
+xmalloc(size_t bytes)
+{
+	void* p = malloc(bytes);
+	if (not p) {
+		fprintf(stderr,
+			"ERROR: external sort: unable to allocate %zu bytes.\n",
+			bytes);
+		exit(1);
+	}
+	return p;
+}
+
+static double
+now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000.0 + ts.tv_nsec/1e6;
+}
+
+static void
+write_all(int fd, const unsigned char* buf, size_t n, const char* fname)
+{
+	while (n) {
+		ssize_t ret = write(fd, buf, n);
+		if (ret < 0) {
+			if (errno == EINTR) continue;
+			fatal("unable to write", fname);
+		}
+		buf += ret;
+		n -= ret;
+	}
+}
+
+/* Reads until the buffer is full or EOF is reached. */
+static size_t
+read_full(int fd, unsigned char* buf, size_t n, const char* fname)
+{
+	size_t done = 0;
+	while (done < n) {
+		ssize_t ret = read(fd, buf+done, n-done);
+		if (ret < 0) {
+			if (errno == EINTR) continue;
+			fatal("unable to read", fname);
+		}
+		if (ret == 0) break;
+		done += ret;
+	}
+	return done;
+}
+
+static inline unsigned char*
+put_varint(unsigned char* p, size_t v)
+{
+	while (v >= 0x80) {
+		*p++ = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (unsigned char)v;
+	return p;
+}
+
+static inline const unsigned char*
+get_varint(const unsigned char* p, size_t* v)
+{
+	size_t result = 0;
+	unsigned shift = 0;
+	while (*p & 0x80) {
+		result |= size_t(*p++ & 0x7F) << shift;
+		shift += 7;
+	}
+	*v = result | (size_t(*p++) << shift);
+	return p;
+}
+
+static int
+temp_file(const char* tmpdir)
+{
+	std::vector<char> path(strlen(tmpdir) + 32);
+	snprintf(path.data(), path.size(), "%s/sortstring-run-XXXXXX", tmpdir);
+	int fd = mkstemp(path.data());
+	if (fd == -1)
+		fatal("unable to create temporary file in", tmpdir);
+	// The file is removed automatically when closed.
+	unlink(path.data());
+	return fd;
+}
+
+struct run_writer
+{
+	int fd;
+	const size_t block_size;
+	unsigned char* block;
+	size_t used;
+
+	run_writer(int fd_, size_t block_size_)
+		: fd(fd_), block_size(block_size_),
+		  block(static_cast<unsigned char*>(xmalloc(block_size_))),
+		  used(sizeof(uint32_t)) {}
+
+	~run_writer() { flush(); free(block); }
+
+	void flush()
+	{
+		if (used == sizeof(uint32_t))
+			return;
+		const uint32_t u = used;
+		memcpy(block, &u, sizeof(u));
+		memset(block+used, 0, block_size-used);
+		write_all(fd, block, block_size, "run file");
+		used = sizeof(uint32_t);
+	}
+
+	void add(const unsigned char* str, size_t lcp)
+	{
+		const size_t len = strlen(reinterpret_cast<const char*>(str));
+		// Two varints of at most 10 bytes, and the NULL byte.
+		const size_t max_record = 10 + 10 + len + 1;
+		if (max_record > block_size - sizeof(uint32_t)) {
+			fprintf(stderr,
+				"ERROR: external sort: string of %zu bytes does "
+				"not fit in block of %zu bytes.\n",
+				len, block_size);
+			exit(1);
+		}
+		if (used + max_record > block_size)
+			flush();
+		unsigned char* p = block + used;
+		p = put_varint(p, lcp);
+		p = put_varint(p, len);
+		memcpy(p, str, len+1);
+		used = p + len + 1 - block;
+	}
+};
+
+/* Reads a sorted run with double buffering: the next block is read
+ * asynchronously while the current one is being merged. */
+struct run_reader
+{
+	int fd;
+	size_t block_size;
+	size_t blocks;
+	size_t next_block;
+	unsigned char* buf[2];
+	unsigned cur;
+	struct aiocb cb;
+	bool pending;
+	const unsigned char* pos;
+	const unsigned char* end;
+	unsigned char* str;
+	size_t lcp;
+
+	void open(int fd_, size_t block_size_, size_t blocks_)
+	{
+		fd = fd_;
+		block_size = block_size_;
+		blocks = blocks_;
+		next_block = 0;
+		buf[0] = static_cast<unsigned char*>(xmalloc(block_size));
+		buf[1] = static_cast<unsigned char*>(xmalloc(block_size));
+		cur = 1;
+		pending = false;
+		pos = end = 0;
+		str = 0;
+		request();
+		next();
+	}
+
+	void close()
+	{
+		if (pending) {
+			const struct aiocb* list[1] = { &cb };
+			while (aio_error(&cb) == EINPROGRESS)
+				aio_suspend(list, 1, 0);
+			aio_return(&cb);
+		}
+		free(buf[0]);
+		free(buf[1]);
+		::close(fd);
+	}
+
+	/* Starts reading the next block into the buffer not in use. */
+	void request()
+	{
+		if (next_block == blocks)
+			return;
+		memset(&cb, 0, sizeof(cb));
+		cb.aio_fildes = fd;
+		cb.aio_buf = buf[cur ^ 1];
+		cb.aio_nbytes = block_size;
+		cb.aio_offset = off_t(next_block) * block_size;
+		if (aio_read(&cb) == -1)
+			fatal("unable to read", "run file");
+		pending = true;
+		++next_block;
+	}
+
+	/* Waits for the pending read, switches buffers and starts reading
+	 * the following block. Returns false at the end of the run. */
+	bool next_buffer()
+	{
+		if (not pending)
+			return false;
+		const struct aiocb* list[1] = { &cb };
+		int err;
+		while ((err = aio_error(&cb)) == EINPROGRESS)
+			aio_suspend(list, 1, 0);
+		pending = false;
+		if (err != 0 or aio_return(&cb) != ssize_t(block_size)) {
+			errno = err;
+			fatal("unable to read", "run file");
+		}
+		cur ^= 1;
+		uint32_t used;
+		memcpy(&used, buf[cur], sizeof(used));
+		pos = buf[cur] + sizeof(used);
+		end = buf[cur] + used;
+		request();
+		return true;
+	}
+
+	void next()
+	{
+		if (pos == end and not next_buffer()) {
+			str = 0;
+			return;
+		}
+		size_t len;
+		pos = get_varint(pos, &lcp);
+		pos = get_varint(pos, &len);
+		str = const_cast<unsigned char*>(pos);
+		pos += len + 1;
+	}
+
+	bool empty() const { return str == 0; }
+	unsigned char* head() const { return str; }
+	size_t head_lcp() const { return lcp; }
+};
+
+struct run_info { int fd; size_t blocks; };
+
+/* Completes a run that was written to fd with the given writer. */
+static run_info
+finish_run(int fd, run_writer& w)
+{
+	w.flush();
+	run_info run;
+	run.fd = fd;
+	run.blocks = lseek(fd, 0, SEEK_CUR) / w.block_size;
+	return run;
+}
+
+static size_t
+strings_lcp(const unsigned char* a, const unsigned char* b)
+{
+	size_t i = 0;
+	while (a[i] != 0 and a[i] == b[i])
+		++i;
+	return i;
+}
+
+/* Sorts the strings and writes them to a new run file. The scratch memory of
+ * the routine, if any, is just below the string pointers. */
+static run_info
+write_run(const struct routine* r, const struct external_sort_opts* opts,
+		unsigned char** strs, size_t n, size_t scratch_per_string)
+{
+	if (scratch_per_string)
+		r->f_scratch(strs, n, reinterpret_cast<unsigned char*>(strs)
+				- n*scratch_per_string);
+	else
+		r->f(strs, n);
+	const int fd = temp_file(opts->tmpdir);
+	run_writer w(fd, opts->block_size);
+	for (size_t i=0; i < n; ++i)
+		w.add(strs[i], i ? strings_lcp(strs[i-1], strs[i]) : 0);
+	return finish_run(fd, w);
+}
+
+/* The text of a chunk grows from the start of the buffer, and its string
+ * pointers down from the end, followed by the scratch memory of the routine.
+ * The input is read in steps of half of the free space between them, so that
+ * short strings leave room for their pointers. The chunk is full when the
+ * pointer and scratch memory of the next string would overwrite the text; the
+ * strings from there on are carried over to the next chunk. */
+static std::vector<run_info>
+create_runs(const struct routine* r, const struct external_sort_opts* opts,
+		size_t* strings)
+{
+	std::vector<run_info> runs;
+	int fd = open(opts->input, O_RDONLY);
+	if (fd == -1)
+		fatal("unable to open input file", opts->input);
+	// The run writer takes one block of the memory.
+	const size_t space = (opts->memory - opts->block_size)
+		/ sizeof(unsigned char*) * sizeof(unsigned char*);
+	unsigned char* text = static_cast<unsigned char*>(xmalloc(space));
+	unsigned char** const ptrs_end =
+		reinterpret_cast<unsigned char**>(text + space);
+	// Keep the scratch memory aligned like the pointers.
+	const size_t scratch = r->f_scratch
+		? (r->scratch_per_string + sizeof(unsigned char*) - 1)
+			/ sizeof(unsigned char*) * sizeof(unsigned char*)
+		: 0;
+	const size_t per_string = sizeof(unsigned char*) + scratch;
+	size_t filled = 0;
+	bool eof = false;
+	*strings = 0;
+	while (true) {
+		unsigned char** strs = ptrs_end;
+		size_t start = 0, scan = 0;
+		bool full = false;
+		while (true) {
+			for (; scan < filled; ++scan) {
+				if (text[scan] != opts->delim)
+					continue;
+				if ((ptrs_end-strs+1)*per_string
+						> space - filled) {
+					full = true;
+					break;
+				}
+				text[scan] = 0;
+				*--strs = text + start;
+				start = scan + 1;
+			}
+			if (full or eof)
+				break;
+			const size_t free_space = space - filled
+				- (ptrs_end-strs)*per_string;
+			if (free_space == 0) {
+				full = true;
+				break;
+			}
+			size_t step = free_space / 2;
+			if (step < 4096)
+				step = free_space;
+			const size_t got = read_full(fd, text+filled, step,
+					opts->input);
+			filled += got;
+			eof = got < step;
+		}
+		const size_t n = ptrs_end - strs;
+		if (n == 0) {
+			// Bytes after the last delimiter are ignored.
+			if (eof)
+				break;
+			fprintf(stderr,
+				"ERROR: external sort: string longer than the "
+				"memory limit of %zu bytes.\n", opts->memory);
+			exit(1);
+		}
+		runs.push_back(write_run(r, opts, strs, n, scratch));
+		*strings += n;
+		filled -= start;
+		memmove(text, text+start, filled);
+		if (eof and not full)
+			break;
+	}
+	free(text);
+	close(fd);
+	return runs;
+}
+
+/* Merges k runs, and passes each string with its LCP to the previous one to
+ * emit. The runs are closed, which removes their files. */
+template <typename Emit>
+static void
+merge(const run_info* runs, size_t k, size_t block_size, Emit emit)
+{
+	std::vector<run_reader> readers(k);
+	for (size_t i=0; i < k; ++i)
+		readers[i].open(runs[i].fd, block_size, runs[i].blocks);
+	{
+		lcp_loser_tree<run_reader> tree(readers.data(), k);
+		for (; not tree.empty(); tree.pop())
+			emit(tree.top(), tree.top_lcp());
+	}
+	for (size_t i=0; i < k; ++i)
+		readers[i].close();
+}
+
+static run_info
+merge_to_run(const run_info* runs, size_t k,
+		const struct external_sort_opts* opts)
+{
+	const int fd = temp_file(opts->tmpdir);
+	run_writer w(fd, opts->block_size);
+	merge(runs, k, opts->block_size,
+		[&](const unsigned char* str, size_t lcp) { w.add(str, lcp); });
+	return finish_run(fd, w);
+}
+
+static size_t
+merge_to_output(const run_info* runs, size_t k,
+		const struct external_sort_opts* opts)
+{
+	const size_t out_size = opts->block_size;
+	size_t wrong = 0;
+	int out = open(opts->output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out == -1)
+		fatal("unable to open output file", opts->output);
+	unsigned char* outbuf = static_cast<unsigned char*>(xmalloc(out_size));
+	size_t outpos = 0;
+	std::vector<unsigned char> prev;
+	bool first = true;
+	merge(runs, k, opts->block_size,
+			[&](const unsigned char* str, size_t) {
+		const size_t len = strlen(reinterpret_cast<const char*>(str));
+		if (opts->check) {
+			if (not first and strcmp(
+				reinterpret_cast<const char*>(prev.data()),
+				reinterpret_cast<const char*>(str)) > 0)
+				++wrong;
+			prev.assign(str, str+len+1);
+			first = false;
+		}
+		if (outpos + len + 1 > out_size) {
+			write_all(out, outbuf, outpos, opts->output);
+			outpos = 0;
+		}
+		if (len + 1 > out_size) {
+			write_all(out, str, len, opts->output);
+		} else {
+			memcpy(outbuf+outpos, str, len);
+			outpos += len;
+		}
+		outbuf[outpos++] = (unsigned char)opts->delim;
+	});
+	write_all(out, outbuf, outpos, opts->output);
+	free(outbuf);
+	if (close(out) == -1)
+		fatal("unable to close output file", opts->output);
+	return wrong;
+}
+
+/* Each run being merged takes two blocks, and the output one more. Runs are
+ * merged in groups until all of them can be merged at once. */
+static size_t
+merge_runs(std::vector<run_info>& runs, const struct external_sort_opts* opts,
+		size_t* passes)
+{
+	const size_t fan_in = (opts->memory / opts->block_size - 1) / 2;
+	*passes = 1;
+	while (runs.size() > fan_in) {
+		std::vector<run_info> merged;
+		for (size_t i=0; i < runs.size(); i += fan_in) {
+			const size_t k = std::min(fan_in, runs.size() - i);
+			if (k == 1)
+				merged.push_back(runs[i]);
+			else
+				merged.push_back(merge_to_run(&runs[i], k, opts));
+		}
+		runs.swap(merged);
+		++*passes;
+	}
+	return merge_to_output(runs.data(), runs.size(), opts);
+}
+
+extern "C" void
+external_sort(const struct routine* r, const struct external_sort_opts* opts,
+		struct external_sort_stats* stats)
+{
+	double start = now_ms();
+	std::vector<run_info> runs = create_runs(r, opts, &stats->strings);
+	stats->runs = runs.size();
+	stats->run_formation_ms = now_ms() - start;
+	start = now_ms();
+	stats->wrong_order = 0;
+	stats->merge_passes = 0;
+	if (not runs.empty())
+		stats->wrong_order = merge_runs(runs, opts,
+				&stats->merge_passes);
+	stats->merge_ms = now_ms() - start;
+}
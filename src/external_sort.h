@@ -0,0 +1,69 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include "routine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct external_sort_opts {
+	const char *input;
+	const char *output;
+	const char *tmpdir;
+	/* Strings are delimited with this character in input and output. */
+	int delim;
+	/* Memory limit for the text and string pointers of a sorted run, the
+	 * scratch memory of routines with f_scratch, and the I/O blocks. Must
+	 * be at least 5*block_size, so that at least two runs can be merged at
+	 * once. */
+	size_t memory;
+	/* Runs are read and written in blocks of this size, which also limits
+	 * the maximum length of a string. */
+	size_t block_size;
+	/* Verify the order of the merged output. */
+	int check;
+};
+
+struct external_sort_stats {
+	size_t strings;
+	size_t runs;
+	size_t merge_passes;
+	size_t wrong_order;
+	double run_formation_ms;
+	double merge_ms;
+};
+
+/* Sorts a file that is larger than the available memory. Sorted runs are
+ * created with the given routine, and stored in temporary files, which are
+ * then merged into the output file. */
+void external_sort(const struct routine *, const struct external_sort_opts *,
+		struct external_sort_stats *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EXTERNAL_SORT_H */
@@ -78,6 +78,7 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/debug.h"
 #include "util/insertion_sort.h"
 #include <algorithm>
@@ -658,6 +659,11 @@ funnelsort(unsigned char** strings, size_t n, unsigned char** restrict tmp)
 		insertion_sort(strings, n, 0);
 		return;
 	}
+	// The K-merger needs a string in every stream.
+	if (n < K) {
+		funnelsort<(K>16?K/4:K/2),BufferLayout>(strings, n, tmp);
+		return;
+	}
 	size_t splitter = n/K;
 	std::array<Stream, K> streams;
 	streams[0].stream = strings;
@@ -696,9 +702,9 @@ template <unsigned K, template <unsigned, unsigned> class BufferLayout>
 void funnelsort_Kway(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	funnelsort<K, BufferLayout>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
 
 void funnelsort_8way_bfs(unsigned char** strings, size_t n)
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include "libsortstring.h"
+#include "routines.h"
+#include "util/collation.h"
+#include "util/permutation.h"
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* The public routine handle is the registered struct routine. */
+static const struct routine *
+to_routine(const struct sortstring_routine *r)
+{
+	return (const struct routine *)r;
+}
+
+const struct sortstring_routine *
+sortstring_routine_lookup(const char *name)
+{
+	if (!name)
+		return NULL;
+	return (const struct sortstring_routine *)routine_from_name(name);
+}
+
+size_t
+sortstring_routine_count(void)
+{
+	const struct routine **routines;
+	unsigned cnt;
+	routine_get_all(&routines, &cnt);
+	return cnt;
+}
+
+const struct sortstring_routine *
+sortstring_routine_get(size_t index)
+{
+	const struct routine **routines;
+	unsigned cnt;
+	routine_get_all(&routines, &cnt);
+	if (index >= cnt)
+		return NULL;
+	return (const struct sortstring_routine *)routines[index];
+}
+
+const char *
+sortstring_routine_name(const struct sortstring_routine *r)
+{
+	return to_routine(r)->name;
+}
+
+const char *
+sortstring_routine_description(const struct sortstring_routine *r)
+{
+	return to_routine(r)->desc;
+}
+
+int
+sortstring_routine_multicore(const struct sortstring_routine *r)
+{
+	return to_routine(r)->multicore;
+}
+
+int
+sortstring_routine_binary(const struct sortstring_routine *r)
+{
+	return to_routine(r)->f_binary != NULL;
+}
+
+int
+sortstring_routine_collate(const struct sortstring_routine *r)
+{
+	return to_routine(r)->f_collate != NULL;
+}
+
+size_t
+sortstring_scratch_size(const struct sortstring_routine *r, size_t n)
+{
+	if (!to_routine(r)->f_scratch)
+		return SORTSTRING_SCRATCH_INTERNAL;
+	return n * to_routine(r)->scratch_per_string;
+}
+
+static size_t
+lcp_binary(const struct bstring *a, const struct bstring *b)
+{
+	size_t i = 0, len = a->len < b->len ? a->len : b->len;
+	while (i < len && a->ptr[i] == b->ptr[i])
+		++i;
+	return i;
+}
+
+/* Copies the options of the caller into *copy, and zeroes the options that
+ * the caller does not know of. Returns NULL if the size is invalid. */
+static const struct sortstring_options *
+copy_options(const struct sortstring_options *opts,
+		struct sortstring_options *copy)
+{
+	if (opts->size < sizeof(opts->size) || opts->size > sizeof(*copy))
+		return NULL;
+	memset(copy, 0, sizeof(*copy));
+	memcpy(copy, opts, opts->size);
+	return copy;
+}
+
+/* The input order is needed for recovering the permutation. */
+static void *
+copy_input(const void *strings, size_t bytes)
+{
+	void *copy = malloc(bytes ? bytes : 1);
+	if (!copy) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	memcpy(copy, strings, bytes);
+	return copy;
+}
+
+int
+sortstring_sort(const struct sortstring_routine *handle,
+		unsigned char **strings, size_t n,
+		const struct sortstring_options *opts)
+{
+	const struct routine *r = to_routine(handle);
+	struct sortstring_options copy;
+	int ret = 0;
+#ifdef _OPENMP
+	int threads = omp_get_max_threads();
+#endif
+	if (opts && !(opts = copy_options(opts, &copy))) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!r || (n && !strings)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (opts && opts->scratch && r->f_scratch
+			&& opts->scratch_size < n * r->scratch_per_string) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (opts && opts->collation && (!r->f_collate
+			|| !collation_valid(opts->collation))) {
+		errno = EINVAL;
+		return -1;
+	}
+#ifdef _OPENMP
+	if (opts && opts->threads)
+		omp_set_num_threads(opts->threads);
+#endif
+	/* The permutation variant carries the indexes through the sort,
+	 * otherwise the permutation is recovered from a copy of the input. */
+	const int perm_variant = opts && opts->permutation && r->f_perm
+		&& !opts->collation && !opts->lcp;
+	unsigned char **input = NULL;
+	if (opts && opts->permutation && !perm_variant
+			&& !(input = copy_input(strings,
+					n*sizeof(unsigned char *)))) {
+		ret = -1;
+		goto done;
+	}
+	if (perm_variant)
+		r->f_perm(strings, n, opts->permutation);
+	else if (opts && opts->collation)
+		r->f_collate(strings, n, opts->collation);
+	else if (opts && opts->lcp && r->f_lcp)
+		r->f_lcp(strings, n, opts->lcp);
+	else if (opts && opts->scratch && r->f_scratch)
+		r->f_scratch(strings, n, opts->scratch);
+	else
+		r->f(strings, n);
+	if (opts && opts->lcp && opts->collation)
+		routine_lcp_fallback_collate(strings, n, opts->lcp,
+				opts->collation);
+	else if (opts && opts->lcp && !r->f_lcp)
+		routine_lcp_fallback(strings, n, opts->lcp);
+	if (input) {
+		ret = permutation_recover(input, strings, n,
+				sizeof(unsigned char *), opts->permutation);
+		free(input);
+	}
+done:
+#ifdef _OPENMP
+	if (opts && opts->threads)
+		omp_set_num_threads(threads);
+#endif
+	return ret;
+}
+
+int
+sortstring_sort_binary(const struct sortstring_routine *handle,
+		struct sortstring_key *keys, size_t n,
+		const struct sortstring_options *opts)
+{
+	const struct routine *r = to_routine(handle);
+	/* struct sortstring_key has the layout of struct bstring. */
+	struct bstring *strings = (struct bstring *)keys;
+	struct sortstring_options copy;
+	int ret = 0;
+#ifdef _OPENMP
+	int threads = omp_get_max_threads();
+#endif
+	if (opts && !(opts = copy_options(opts, &copy))) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!r || !r->f_binary || (n && !keys)
+			|| (opts && opts->collation)) {
+		errno = EINVAL;
+		return -1;
+	}
+#ifdef _OPENMP
+	if (opts && opts->threads)
+		omp_set_num_threads(opts->threads);
+#endif
+	struct bstring *input = NULL;
+	if (opts && opts->permutation && !(input = copy_input(strings,
+			n*sizeof(struct bstring)))) {
+		ret = -1;
+		goto done;
+	}
+	r->f_binary(strings, n);
+	if (opts && opts->lcp && n) {
+		opts->lcp[0] = 0;
+#pragma omp parallel for schedule(static, 16384)
+		for (size_t i=1; i < n; ++i)
+			opts->lcp[i] = lcp_binary(&strings[i-1], &strings[i]);
+	}
+	if (input) {
+		ret = permutation_recover(input, strings, n,
+				sizeof(struct bstring), opts->permutation);
+		free(input);
+	}
+done:
+#ifdef _OPENMP
+	if (opts && opts->threads)
+		omp_set_num_threads(threads);
+#endif
+	return ret;
+}
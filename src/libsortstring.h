@@ -0,0 +1,151 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/*
+ * C API for embedding the sorting routines, provided by the libsortstring
+ * static and shared libraries.
+ *
+ * The routines register themselves from static constructors. When linking
+ * against the static library, wrap it in -Wl,--whole-archive so that the
+ * linker keeps all routines.
+ *
+ * Example:
+ *
+ *     const struct sortstring_routine *r =
+ *             sortstring_routine_lookup("mergesort_lcp_2way");
+ *     size_t bytes = sortstring_scratch_size(r, n);
+ *     struct sortstring_options opts = { sizeof(opts) };
+ *     opts.scratch = malloc(bytes);
+ *     opts.scratch_size = bytes;
+ *     ...
+ *     sortstring_sort(r, strings, n, &opts);
+ */
+
+#ifndef LIBSORTSTRING_H
+#define LIBSORTSTRING_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The library is built with hidden visibility, only the API is exported. */
+#if defined(__GNUC__)
+#pragma GCC visibility push(default)
+#endif
+
+#define SORTSTRING_API_VERSION 4
+
+/* Returned by sortstring_scratch_size() for routines that allocate their
+ * auxiliary memory internally. */
+#define SORTSTRING_SCRATCH_INTERNAL ((size_t)-1)
+
+struct sortstring_routine;
+
+/* A binary string of len bytes, which may include NUL bytes. */
+struct sortstring_key {
+	unsigned char *ptr;
+	size_t len;
+};
+
+struct sortstring_options {
+	/* Must be set to sizeof(struct sortstring_options). Options that an
+	 * older caller does not know of are zero. Fails with EINVAL if the
+	 * size is larger than that of the library, or smaller than this
+	 * field. */
+	size_t size;
+	/* Number of threads for multicore routines, 0 for the OpenMP
+	 * default. Only affects the calling thread. */
+	unsigned threads;
+	/* Preallocated scratch memory of at least sortstring_scratch_size()
+	 * bytes, or NULL to let the routine allocate. */
+	void *scratch;
+	size_t scratch_size;
+	/* If not NULL, receives n LCP values of the sorted strings: lcp[0] is
+	 * 0, and lcp[i] is the length of the longest common prefix of
+	 * strings[i-1] and strings[i]. Routines that have no native LCP
+	 * variant take an extra pass over the sorted strings for it. With a
+	 * collation table, the characters are compared through the table. */
+	size_t *lcp;
+	/* If not NULL, receives the permutation of the sort: permutation[i] is
+	 * the index in the input of the string at position i of the output,
+	 * so a parallel payload column can be reordered with it. Routines with
+	 * a permutation variant carry the indexes through the sort, without
+	 * lcp or collation. Otherwise the permutation is recovered from a copy
+	 * of the input. */
+	size_t *permutation;
+	/* If not NULL, a 256-entry table that the strings are sorted by:
+	 * every byte is compared as table[byte], e.g. table['A'] = 'a' sorts
+	 * case-insensitively. The table must map 0 to 0 and no other byte to
+	 * 0. Fails with EINVAL if the routine has no collate variant. The table
+	 * is only used for this call, so concurrent calls may use different
+	 * tables. */
+	const unsigned char *collation;
+};
+
+/* Returns the routine, or NULL if there is no routine with the name. */
+const struct sortstring_routine *sortstring_routine_lookup(const char *name);
+
+/* Enumerates the routines, single core routines first. */
+size_t sortstring_routine_count(void);
+const struct sortstring_routine *sortstring_routine_get(size_t index);
+
+const char *sortstring_routine_name(const struct sortstring_routine *);
+const char *sortstring_routine_description(const struct sortstring_routine *);
+int sortstring_routine_multicore(const struct sortstring_routine *);
+/* Returns nonzero if the routine can sort binary keys. */
+int sortstring_routine_binary(const struct sortstring_routine *);
+/* Returns nonzero if the routine can sort with a collation table. */
+int sortstring_routine_collate(const struct sortstring_routine *);
+
+/* Returns the number of bytes of scratch memory the routine needs to sort
+ * n strings without allocating memory, 0 if it needs none, or
+ * SORTSTRING_SCRATCH_INTERNAL if the routine always allocates its
+ * auxiliary memory internally. */
+size_t sortstring_scratch_size(const struct sortstring_routine *, size_t n);
+
+/* Sorts the strings with the routine. The options may be NULL. Returns 0 on
+ * success, or -1 with errno set to EINVAL if the arguments are invalid, for
+ * example if the scratch memory is too small, or to ENOMEM if the memory for
+ * the permutation could not be allocated. */
+int sortstring_sort(const struct sortstring_routine *, unsigned char **strings,
+		size_t n, const struct sortstring_options *);
+
+/* Sorts binary keys lexicographically, a proper prefix sorts before the
+ * longer key. Same as sortstring_sort(), except that the scratch memory
+ * option is not used. Fails with EINVAL if the routine cannot sort binary
+ * keys, or if a collation table is given. */
+int sortstring_sort_binary(const struct sortstring_routine *,
+		struct sortstring_key *keys, size_t n,
+		const struct sortstring_options *);
+
+#if defined(__GNUC__)
+#pragma GCC visibility pop
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBSORTSTRING_H */
@@ -164,6 +164,114 @@ struct loser_tree
 	}
 };
 
+/* Loser tree for merging sorted streams of strings, that uses the longest
+ * common prefix (LCP) of each string with its predecessor in the stream to
+ * avoid most character comparisons.
+ *
+ * Each node stores the loser of the comparison, and the LCP of the loser with
+ * the winner of that subtree. When the winner is removed, the next string of
+ * the same stream is compared against the losers on the path to the root.
+ * Both LCP values are then relative to the removed winner, and the larger
+ * LCP identifies the smaller string. Characters need to be compared only when
+ * the LCP values are equal, starting from that depth.
+ *
+ * See also:
+ *   Waihong Ng and Katsuhiko Kakehi:
+ *     "Merging String Sequences by Longest Common Prefixes",
+ *     IPSJ Digital Courier, Vol. 4, pp.69-78 (2008)
+ *
+ * Stream needs to provide:
+ *   bool empty() const;
+ *   unsigned char* head() const;  current string
+ *   size_t head_lcp() const;      LCP of current string with its predecessor
+ *   void next();                  advance to the next string
+ */
+template <typename Stream>
+struct lcp_loser_tree
+{
+	typedef struct { unsigned stream; size_t lcp; } Node;
+	Node* restrict _nodes;
+	Stream* const _streams;
+	const unsigned _k;
+	const unsigned _stream_offset;
+
+	lcp_loser_tree(Stream* streams, unsigned k)
+		: _nodes(0), _streams(streams), _k(k),
+		  _stream_offset(k > 1 ? 1 << (log2(k-1)+1) : 2)
+	{
+		assert(k > 0);
+		_nodes = static_cast<Node*>(malloc(_stream_offset*sizeof(Node)));
+		_nodes[0].stream = init_min(1);
+		_nodes[0].lcp = 0;
+	}
+
+	~lcp_loser_tree()
+	{
+		assert(_nodes);
+		free(static_cast<void*>(_nodes));
+	}
+
+	bool stream_empty(unsigned s) const
+	{ return s >= _k or _streams[s].empty(); }
+
+	/* Plays a match between the candidate and the loser stored in the node.
+	 * The LCP values of both are relative to the same string. The winner is
+	 * returned in (s, h), and the loser is stored in the node. */
+	void play(Node& node, unsigned& s, size_t& h)
+	{
+		if (stream_empty(node.stream))
+			return;
+		if (stream_empty(s) or node.lcp > h) {
+			std::swap(node.stream, s);
+			std::swap(node.lcp, h);
+			return;
+		}
+		if (node.lcp < h)
+			return;
+		const unsigned char* a = _streams[s].head();
+		const unsigned char* b = _streams[node.stream].head();
+		size_t i = h;
+		while (a[i] != 0 and a[i] == b[i])
+			++i;
+		if (a[i] <= b[i]) {
+			node.lcp = i;
+		} else {
+			std::swap(node.stream, s);
+			node.lcp = i;
+		}
+	}
+
+	unsigned init_min(unsigned root)
+	{
+		if (root >= _stream_offset) { return root-_stream_offset; }
+		unsigned l = init_min(root << 1);
+		const unsigned r = init_min((root << 1) + 1);
+		size_t h = 0;
+		_nodes[root].stream = r;
+		_nodes[root].lcp = 0;
+		play(_nodes[root], l, h);
+		return l;
+	}
+
+	bool empty() const { return stream_empty(_nodes[0].stream); }
+
+	/* The smallest string, and its LCP with the previous smallest string. */
+	unsigned char* top() const { return _streams[_nodes[0].stream].head(); }
+	size_t top_lcp() const { return _nodes[0].lcp; }
+
+	/* Removes the smallest string. */
+	void pop()
+	{
+		unsigned s = _nodes[0].stream;
+		_streams[s].next();
+		size_t h = stream_empty(s) ? 0 : _streams[s].head_lcp();
+		for (unsigned i=(_stream_offset+s) >> 1; i!=0; i >>= 1)
+			play(_nodes[i], s, h);
+		_nodes[0].stream = s;
+		_nodes[0].lcp = h;
+	}
+};
+
 #ifndef NDEBUG
 #include <ostream>
 template <typename T>
@@ -38,6 +38,7 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/debug.h"
 #include "util/insertion_sort.h"
 #include <cstdlib>
@@ -111,14 +112,20 @@ mergesort_2way(unsigned char** strings, size_t n, unsigned char** tmp)
 	           tmp);
 	(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
 }
+void mergesort_2way_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_2way(strings, n, static_cast<unsigned char**>(scratch));
+}
 void mergesort_2way(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_2way(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
-ROUTINE_REGISTER_SINGLECORE(mergesort_2way, "mergesort_2way")
+ROUTINE_REGISTER_FULL(mergesort_2way,
+		"mergesort_2way", 0,
+		ROUTINE_SCRATCH(mergesort_2way_scratch, sizeof(unsigned char*)))
 
 static void
 mergesort_2way_parallel(unsigned char** strings, size_t n, unsigned char** tmp)
@@ -140,15 +147,21 @@ mergesort_2way_parallel(unsigned char** strings, size_t n, unsigned char** tmp)
 	           tmp);
 	(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
 }
+void mergesort_2way_parallel_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_2way_parallel(strings, n, static_cast<unsigned char**>(scratch));
+}
 void mergesort_2way_parallel(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_2way_parallel(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
-ROUTINE_REGISTER_MULTICORE(mergesort_2way_parallel,
-		"Parallel mergesort with 2way merger")
+ROUTINE_REGISTER_FULL(mergesort_2way_parallel,
+		"Parallel mergesort with 2way merger", 1,
+		ROUTINE_SCRATCH(mergesort_2way_parallel_scratch,
+			sizeof(unsigned char*)))
 
 /*******************************************************************************
  *
@@ -313,14 +326,20 @@ mergesort_3way(unsigned char** strings, size_t n, unsigned char** tmp)
 	           tmp);
 	(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
 }
+void mergesort_3way_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_3way(strings, n, static_cast<unsigned char**>(scratch));
+}
 void mergesort_3way(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_3way(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
-ROUTINE_REGISTER_SINGLECORE(mergesort_3way, "mergesort_3way")
+ROUTINE_REGISTER_FULL(mergesort_3way,
+		"mergesort_3way", 0,
+		ROUTINE_SCRATCH(mergesort_3way_scratch, sizeof(unsigned char*)))
 
 static void
 mergesort_3way_parallel(unsigned char** strings, size_t n, unsigned char** tmp)
@@ -346,15 +365,21 @@ mergesort_3way_parallel(unsigned char** strings, size_t n, unsigned char** tmp)
 	           tmp);
 	(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
 }
+void mergesort_3way_parallel_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_3way_parallel(strings, n, static_cast<unsigned char**>(scratch));
+}
 void mergesort_3way_parallel(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_3way_parallel(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
-ROUTINE_REGISTER_MULTICORE(mergesort_3way_parallel,
-		"Parallel mergesort with 3way merger")
+ROUTINE_REGISTER_FULL(mergesort_3way_parallel,
+		"Parallel mergesort with 3way merger", 1,
+		ROUTINE_SCRATCH(mergesort_3way_parallel_scratch,
+			sizeof(unsigned char*)))
 
 /*******************************************************************************
  *
@@ -476,14 +501,20 @@ mergesort_4way(unsigned char** strings, size_t n, unsigned char** tmp)
 	           tmp);
 	(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
 }
+void mergesort_4way_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_4way(strings, n, static_cast<unsigned char**>(scratch));
+}
 void mergesort_4way(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_4way(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
-ROUTINE_REGISTER_SINGLECORE(mergesort_4way, "mergesort_4way")
+ROUTINE_REGISTER_FULL(mergesort_4way,
+		"mergesort_4way", 0,
+		ROUTINE_SCRATCH(mergesort_4way_scratch, sizeof(unsigned char*)))
 
 void
 mergesort_4way_parallel(unsigned char** strings, size_t n, unsigned char** tmp)
@@ -514,12 +545,18 @@ mergesort_4way_parallel(unsigned char** strings, size_t n, unsigned char** tmp)
 	           tmp);
 	(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
 }
+void mergesort_4way_parallel_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_4way_parallel(strings, n, static_cast<unsigned char**>(scratch));
+}
 void mergesort_4way_parallel(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_4way_parallel(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
-ROUTINE_REGISTER_MULTICORE(mergesort_4way_parallel,
-		"Parallel mergesort with 4way merger")
+ROUTINE_REGISTER_FULL(mergesort_4way_parallel,
+		"Parallel mergesort with 4way merger", 1,
+		ROUTINE_SCRATCH(mergesort_4way_parallel_scratch,
+			sizeof(unsigned char*)))
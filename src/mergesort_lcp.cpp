@@ -59,8 +59,10 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/debug.h"
 #include "util/insertion_sort.h"
+#include "util/index_array.h"
 #include <algorithm>
 #include <iostream>
 #include <iterator>
@@ -69,6 +71,7 @@
 #include <cstring>
 #include <cstdlib>
 #include <sstream>
+#include <vector>
 
 // Handle very long strings. I guess in most cases we could choose smaller type
 // to save some memory.
@@ -83,6 +86,12 @@ cmp(const unsigned char* a, const unsigned char* b)
 	return strcmp(reinterpret_cast<const char*>(a),
 	              reinterpret_cast<const char*>(b));
 }
+
+static inline int
+cmp(const bstring& a, const bstring& b)
+{
+	return bstring_cmp(&a, &b);
+}
 #endif
 
 static lcp_t
@@ -99,6 +108,15 @@ lcp(unsigned char* a, unsigned char* b)
 	return lcp_t(-1);
 }
 
+static lcp_t
+lcp(const bstring& a, const bstring& b)
+{
+	const size_t len = std::min(a.len, b.len);
+	size_t i=0;
+	while (i < len and a.ptr[i] == b.ptr[i]) ++i;
+	return i;
+}
+
 std::tuple<int, lcp_t>
 compare(unsigned char* a, unsigned char* b, size_t depth=0)
 {
@@ -114,6 +132,20 @@ compare(unsigned char* a, unsigned char* b, size_t depth=0)
 	return std::make_tuple(int(-1), lcp_t(-1));
 }
 
+static std::tuple<int, lcp_t>
+compare(const bstring& a, const bstring& b, size_t depth=0)
+{
+	const size_t len = std::min(a.len, b.len);
+	for (size_t i=depth; i < len; ++i) {
+		const unsigned char A = a.ptr[i];
+		const unsigned char B = b.ptr[i];
+		if (A != B) {
+			return std::make_tuple(int(A)-int(B), i);
+		}
+	}
+	return std::make_tuple(int(a.len > b.len)-int(a.len < b.len), len);
+}
+
 enum MergeResult {
 	SortedInPlace,
 	SortedInTemp,
@@ -128,13 +160,18 @@ enum MergeResult {
 /* If the template parameter OutputLCP is true, write LCP values to lcp_result.
  * It is set to false when performing the final merge step -- at that point we
  * dont need the LCP results anymore.
+ *
+ * The input indexes of mergesort_lcp_2way_perm() are merged from idx0 and idx1
+ * to idx_result along with the strings, see util/index_array.h.
  */
 
-template <bool OutputLCP>
+template <bool OutputLCP, typename StringT, typename IndexT=no_index>
 static void
-merge_lcp_2way(unsigned char** from0,  lcp_t* restrict lcp_input0, size_t n0,
-               unsigned char** from1,  lcp_t* restrict lcp_input1, size_t n1,
-               unsigned char** result, lcp_t* restrict lcp_result)
+merge_lcp_2way(StringT* from0,  lcp_t* restrict lcp_input0, size_t n0,
+               StringT* from1,  lcp_t* restrict lcp_input1, size_t n1,
+               StringT* result, lcp_t* restrict lcp_result,
+               IndexT idx0=IndexT(), IndexT idx1=IndexT(),
+               IndexT idx_result=IndexT())
 {
 	debug() << __func__ << "(): n0=" << n0 << ", n1=" << n1 << '\n';
 	lcp_t lcp0=0, lcp1=0;
@@ -143,11 +180,13 @@ merge_lcp_2way(unsigned char** from0,  lcp_t* restrict lcp_input0, size_t n0,
 		std::tie(cmp01, lcp01) = compare(*from0, *from1);
 		if (cmp01 <= 0) {
 			*result++ = *from0++;
+			*idx_result++ = *idx0++;
 			lcp0 = *lcp_input0++;
 			lcp1 = lcp01;
 			if (--n0 == 0) goto finish0;
 		} else {
 			*result++ = *from1++;
+			*idx_result++ = *idx1++;
 			lcp1 = *lcp_input1++;
 			lcp0 = lcp01;
 			if (--n1 == 0) goto finish1;
@@ -166,12 +205,14 @@ merge_lcp_2way(unsigned char** from0,  lcp_t* restrict lcp_input0, size_t n0,
 		if (lcp0 > lcp1) {
 			assert(cmp(*from0, *from1) < 0);
 			*result++ = *from0++;
+			*idx_result++ = *idx0++;
 			if (OutputLCP) *lcp_result++ = lcp0;
 			lcp0 = *lcp_input0++;
 			if (--n0 == 0) goto finish0;
 		} else if (lcp0 < lcp1) {
 			assert(cmp(*from0, *from1) > 0);
 			*result++ = *from1++;
+			*idx_result++ = *idx1++;
 			if (OutputLCP) *lcp_result++ = lcp1;
 			lcp1 = *lcp_input1++;
 			if (--n1 == 0) goto finish1;
@@ -181,11 +222,13 @@ merge_lcp_2way(unsigned char** from0,  lcp_t* restrict lcp_input0, size_t n0,
 			if (OutputLCP) *lcp_result++ = lcp0;
 			if (cmp01 <= 0) {
 				*result++ = *from0++;
+				*idx_result++ = *idx0++;
 				lcp1 = lcp01;
 				if (--n0 == 0) goto finish0;
 				lcp0 = *lcp_input0++;
 			} else {
 				*result++ = *from1++;
+				*idx_result++ = *idx1++;
 				lcp0 = lcp01;
 				if (--n1 == 0) goto finish1;
 				lcp1 = *lcp_input1++;
@@ -197,6 +240,7 @@ finish0:
 	assert(not n0);
 	assert(n1);
 	std::copy(from1, from1+n1, result);
+	copy_index(idx1, n1, idx_result);
 	if (OutputLCP) *lcp_result++ = lcp1;
 	if (OutputLCP) std::copy(lcp_input1, lcp_input1+n1, lcp_result);
 	return;
@@ -205,22 +249,24 @@ finish1:
 	assert(not n1);
 	assert(n0);
 	std::copy(from0, from0+n0, result);
+	copy_index(idx0, n0, idx_result);
 	if (OutputLCP) *lcp_result++ = lcp0;
 	if (OutputLCP) std::copy(lcp_input0, lcp_input0+n0, lcp_result);
 	return;
 }
 
-template <bool OutputLCP>
+template <bool OutputLCP, typename StringT, typename IndexT=no_index>
 MergeResult
-mergesort_lcp_2way(unsigned char** restrict strings_input,
-                   unsigned char** restrict strings_output,
+mergesort_lcp_2way(StringT* restrict strings_input,
+                   StringT* restrict strings_output,
                    lcp_t* restrict lcp_input, lcp_t* restrict lcp_output,
-                   size_t n)
+                   size_t n,
+                   IndexT idx_input=IndexT(), IndexT idx_output=IndexT())
 {
 	assert(n > 0);
 	debug() << __func__ << "(): n=" << n << '\n';
 	if (n < 32) {
-		insertion_sort(strings_input, n, 0);
+		insertion_sort(strings_input, idx_input, n, 0);
 		for (unsigned i=0; i < n-1; ++i)
 			lcp_input[i] = lcp(strings_input[i], strings_input[i+1]);
 		return SortedInPlace;
@@ -229,60 +275,149 @@ mergesort_lcp_2way(unsigned char** restrict strings_input,
 	MergeResult ml = mergesort_lcp_2way<true>(
 			strings_input, strings_output,
 			lcp_input,     lcp_output,
-			split0);
+			split0,
+			idx_input,     idx_output);
 	MergeResult mr = mergesort_lcp_2way<true>(
 			strings_input+split0, strings_output+split0,
 			lcp_input+split0,     lcp_output+split0,
-			n-split0);
+			n-split0,
+			idx_input+split0,     idx_output+split0);
 	if (ml != mr) {
 		if (ml == SortedInPlace) {
 			std::copy(strings_output+split0, strings_output+n,
 					strings_input+split0);
 			std::copy(lcp_output+split0, lcp_output+n,
 					lcp_input+split0);
+			copy_index(idx_output+split0, n-split0,
+					idx_input+split0);
 			mr = SortedInPlace;
 		} else {
-			assert(0);
-			abort();
+			std::copy(strings_output, strings_output+split0,
+					strings_input);
+			std::copy(lcp_output, lcp_output+split0, lcp_input);
+			copy_index(idx_output, split0, idx_input);
+			ml = SortedInPlace;
 		}
 	}
 	if (ml == SortedInPlace) {
 		merge_lcp_2way<OutputLCP>(
 		           strings_input,        lcp_input,        split0,
 		           strings_input+split0, lcp_input+split0, n-split0,
-		           strings_output, lcp_output);
+		           strings_output, lcp_output,
+		           idx_input, idx_input+split0, idx_output);
 		return SortedInTemp;
 	} else {
 		merge_lcp_2way<OutputLCP>(
 		           strings_output,        lcp_output,        split0,
 		           strings_output+split0, lcp_output+split0, n-split0,
-		           strings_input, lcp_input);
+		           strings_input, lcp_input,
+		           idx_output, idx_output+split0, idx_input);
 		return SortedInPlace;
 	}
 }
+// Scratch memory layout: n string pointers, followed by two LCP arrays.
+static const size_t scratch_per_string =
+	sizeof(unsigned char*) + 2*sizeof(lcp_t);
+
+void
+mergesort_lcp_2way_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	unsigned char** tmp = static_cast<unsigned char**>(scratch);
+	lcp_t* lcp_input  = reinterpret_cast<lcp_t*>(tmp+n);
+	lcp_t* lcp_output = lcp_input+n;
+	if (n == 0) return;
+	const MergeResult m = mergesort_lcp_2way<false>(strings, tmp,
+			lcp_input, lcp_output, n);
+	if (m == SortedInTemp) {
+		(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
+	}
+}
 void
 mergesort_lcp_2way(unsigned char** strings, size_t n)
 {
-	lcp_t* lcp_input  = static_cast<lcp_t*>(malloc(n*sizeof(lcp_t)));
-	lcp_t* lcp_output = static_cast<lcp_t*>(malloc(n*sizeof(lcp_t)));
-	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+	void* scratch = big_malloc(n*scratch_per_string);
+	mergesort_lcp_2way_scratch(strings, n, scratch);
+	big_free(scratch);
+}
+void
+mergesort_lcp_2way_binary(bstring* strings, size_t n)
+{
+	if (n == 0) return;
+	bstring* tmp = static_cast<bstring*>(big_malloc(n*sizeof(bstring)));
+	lcp_t* lcp_input = static_cast<lcp_t*>(big_malloc(2*n*sizeof(lcp_t)));
+	lcp_t* lcp_output = lcp_input+n;
 	const MergeResult m = mergesort_lcp_2way<false>(strings, tmp,
 			lcp_input, lcp_output, n);
+	if (m == SortedInTemp) {
+		(void) memcpy(strings, tmp, n*sizeof(bstring));
+	}
+	big_free(lcp_input);
+	big_free(tmp);
+}
+// The merge leaves lcp(strings[i], strings[i+1]) at index i of either LCP
+// array, shift it to the lcp[i] = lcp(strings[i-1], strings[i]) convention of
+// the routine interface. The caller provided lcp array doubles as the second
+// internal LCP array, so only one extra array is needed.
+static void
+output_lcp(lcp_t* restrict lcp, const lcp_t* restrict lcp_tmp,
+		bool in_tmp, size_t n)
+{
+	if (in_tmp)
+		(void) memcpy(lcp+1, lcp_tmp, (n-1)*sizeof(lcp_t));
+	else
+		(void) memmove(lcp+1, lcp, (n-1)*sizeof(lcp_t));
+	lcp[0] = 0;
+}
+void
+mergesort_lcp_2way_lcp(unsigned char** strings, size_t n, size_t* lcp)
+{
+	if (n == 0) return;
+	unsigned char** tmp = static_cast<unsigned char**>(
+			big_malloc(n*sizeof(unsigned char*)));
+	lcp_t* lcp_tmp = static_cast<lcp_t*>(big_malloc(n*sizeof(lcp_t)));
+	const MergeResult m = mergesort_lcp_2way<true>(strings, tmp,
+			lcp, lcp_tmp, n);
 	if (m == SortedInTemp) {
 		(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
 	}
-	free(lcp_input);
-	free(lcp_output);
-	free(tmp);
+	output_lcp(lcp, lcp_tmp, m == SortedInTemp, n);
+	big_free(lcp_tmp);
+	big_free(tmp);
 }
-ROUTINE_REGISTER_SINGLECORE(mergesort_lcp_2way, "LCP mergesort with 2way merger")
+// The input indexes are merged between perm and a temporary array, the same way
+// as the strings.
+void
+mergesort_lcp_2way_perm(unsigned char** strings, size_t n, size_t* perm)
+{
+	if (n == 0) return;
+	identity_index(perm, n);
+	unsigned char** tmp = static_cast<unsigned char**>(
+			big_malloc(n*sizeof(unsigned char*)));
+	size_t* perm_tmp = alloc_index(perm, n);
+	lcp_t* lcp_input = static_cast<lcp_t*>(big_malloc(2*n*sizeof(lcp_t)));
+	lcp_t* lcp_output = lcp_input+n;
+	const MergeResult m = mergesort_lcp_2way<false>(strings, tmp,
+			lcp_input, lcp_output, n, perm, perm_tmp);
+	if (m == SortedInTemp) {
+		(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
+		copy_index(perm_tmp, n, perm);
+	}
+	big_free(lcp_input);
+	free_index(perm_tmp);
+	big_free(tmp);
+}
+ROUTINE_REGISTER_FULL(mergesort_lcp_2way,
+		"LCP mergesort with 2way merger", 0,
+		ROUTINE_SCRATCH(mergesort_lcp_2way_scratch, scratch_per_string),
+		ROUTINE_BINARY(mergesort_lcp_2way_binary),
+		ROUTINE_LCP(mergesort_lcp_2way_lcp),
+		ROUTINE_PERM(mergesort_lcp_2way_perm))
 
-template <bool OutputLCP>
+template <bool OutputLCP, typename StringT>
 MergeResult
 mergesort_lcp_2way_parallel(
-		unsigned char** restrict strings_input,
-		unsigned char** restrict strings_output,
+		StringT* restrict strings_input,
+		StringT* restrict strings_output,
 		lcp_t* restrict lcp_input, lcp_t* restrict lcp_output,
 		size_t n)
 {
@@ -313,8 +448,10 @@ mergesort_lcp_2way_parallel(
 					lcp_input+split0);
 			mr = SortedInPlace;
 		} else {
-			assert(0);
-			abort();
+			std::copy(strings_output, strings_output+split0,
+					strings_input);
+			std::copy(lcp_output, lcp_output+split0, lcp_input);
+			ml = SortedInPlace;
 		}
 	}
 	if (ml == SortedInPlace) {
@@ -332,12 +469,13 @@ mergesort_lcp_2way_parallel(
 	}
 }
 void
-mergesort_lcp_2way_parallel(unsigned char** strings, size_t n)
+mergesort_lcp_2way_parallel_scratch(unsigned char** strings, size_t n,
+		void* scratch)
 {
-	lcp_t* lcp_input  = static_cast<lcp_t*>(malloc(n*sizeof(lcp_t)));
-	lcp_t* lcp_output = static_cast<lcp_t*>(malloc(n*sizeof(lcp_t)));
-	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+	unsigned char** tmp = static_cast<unsigned char**>(scratch);
+	lcp_t* lcp_input  = reinterpret_cast<lcp_t*>(tmp+n);
+	lcp_t* lcp_output = lcp_input+n;
+	if (n == 0) return;
 #pragma omp parallel
 	{
 #pragma omp single
@@ -349,12 +487,200 @@ mergesort_lcp_2way_parallel(unsigned char** strings, size_t n)
 			}
 		}
 	}
-	free(lcp_input);
-	free(lcp_output);
-	free(tmp);
 }
-ROUTINE_REGISTER_MULTICORE(mergesort_lcp_2way_parallel,
-		"Parallel LCP mergesort with 2way merger")
+void
+mergesort_lcp_2way_parallel(unsigned char** strings, size_t n)
+{
+	void* scratch = big_malloc(n*scratch_per_string);
+	mergesort_lcp_2way_parallel_scratch(strings, n, scratch);
+	big_free(scratch);
+}
+void
+mergesort_lcp_2way_parallel_binary(bstring* strings, size_t n)
+{
+	if (n == 0) return;
+	bstring* tmp = static_cast<bstring*>(big_malloc(n*sizeof(bstring)));
+	lcp_t* lcp_input = static_cast<lcp_t*>(big_malloc(2*n*sizeof(lcp_t)));
+	lcp_t* lcp_output = lcp_input+n;
+#pragma omp parallel
+	{
+#pragma omp single
+		{
+			const MergeResult m = mergesort_lcp_2way_parallel<false>(
+					strings, tmp, lcp_input, lcp_output, n);
+			if (m == SortedInTemp) {
+				(void) memcpy(strings, tmp, n*sizeof(bstring));
+			}
+		}
+	}
+	big_free(lcp_input);
+	big_free(tmp);
+}
+void
+mergesort_lcp_2way_parallel_lcp(unsigned char** strings, size_t n, size_t* lcp)
+{
+	if (n == 0) return;
+	unsigned char** tmp = static_cast<unsigned char**>(
+			big_malloc(n*sizeof(unsigned char*)));
+	lcp_t* lcp_tmp = static_cast<lcp_t*>(big_malloc(n*sizeof(lcp_t)));
+	MergeResult m;
+#pragma omp parallel
+	{
+#pragma omp single
+		{
+			m = mergesort_lcp_2way_parallel<true>(
+					strings, tmp, lcp, lcp_tmp, n);
+		}
+	}
+	if (m == SortedInTemp) {
+		(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
+	}
+	output_lcp(lcp, lcp_tmp, m == SortedInTemp, n);
+	big_free(lcp_tmp);
+	big_free(tmp);
+}
+ROUTINE_REGISTER_FULL(mergesort_lcp_2way_parallel,
+		"Parallel LCP mergesort with 2way merger", 1,
+		ROUTINE_SCRATCH(mergesort_lcp_2way_parallel_scratch,
+				scratch_per_string),
+		ROUTINE_BINARY(mergesort_lcp_2way_parallel_binary),
+		ROUTINE_LCP(mergesort_lcp_2way_parallel_lcp))
+
+/*******************************************************************************
+ *
+ * mergesort_lcp_natural
+ *
+ ******************************************************************************/
+
+/* Adaptive variant for nearly sorted input, for example yesterday's sorted
+ * output with new lines appended. One pass over the input finds the natural
+ * ascending runs, and computes the LCP values within them as a side product
+ * of the comparisons. Runs of at least natural_min_run strings are kept, and
+ * compacted to the front of the array. The strings of shorter runs are
+ * collected to the end, and sorted with mergesort_lcp_2way. Finally the runs
+ * are merged pairwise with merge_lcp_2way, until one run is left. A sorted
+ * input costs one pass, and sorted input with an unsorted tail costs the
+ * pass, the sort of the tail and one merge.
+ */
+
+static const size_t natural_min_run = 64;
+
+template <bool OutputLCP>
+static MergeResult
+mergesort_lcp_natural(unsigned char** restrict strings,
+                      unsigned char** restrict tmp,
+                      lcp_t* restrict lcp, lcp_t* restrict lcp_tmp,
+                      size_t n)
+{
+	assert(n > 0);
+	debug() << __func__ << "(): n=" << n << '\n';
+	// bounds[r] is the end of the r'th run.
+	std::vector<size_t> bounds;
+	size_t out = 0, rest = 0;
+	for (size_t begin=0; begin < n; ) {
+		size_t end = begin+1;
+		for (; end < n; ++end) {
+			int c; lcp_t h;
+			std::tie(c, h) = compare(strings[end-1], strings[end]);
+			if (c > 0) break;
+			lcp[end-1] = h;
+		}
+		if (end-begin >= natural_min_run) {
+			std::copy(strings+begin, strings+end, strings+out);
+			std::copy(lcp+begin, lcp+end-1, lcp+out);
+			out += end-begin;
+			bounds.push_back(out);
+		} else {
+			std::copy(strings+begin, strings+end, tmp+rest);
+			rest += end-begin;
+		}
+		begin = end;
+	}
+	debug() << __func__ << "(): " << bounds.size() << " runs, "
+	        << rest << " strings to sort\n";
+	if (rest) {
+		const MergeResult m = mergesort_lcp_2way<true>(tmp, strings+out,
+				lcp_tmp, lcp+out, rest);
+		if (m == SortedInPlace) {
+			std::copy(tmp, tmp+rest, strings+out);
+			std::copy(lcp_tmp, lcp_tmp+rest, lcp+out);
+		}
+		bounds.push_back(n);
+	}
+	unsigned char** from = strings;
+	unsigned char** to   = tmp;
+	lcp_t* lcp_from = lcp;
+	lcp_t* lcp_to   = lcp_tmp;
+	while (bounds.size() > 1) {
+		std::vector<size_t> merged;
+		size_t begin = 0;
+		for (size_t r=0; r+1 < bounds.size(); r += 2) {
+			const size_t mid = bounds[r], end = bounds[r+1];
+			if (bounds.size() == 2)
+				merge_lcp_2way<OutputLCP>(
+					from+begin, lcp_from+begin, mid-begin,
+					from+mid,   lcp_from+mid,   end-mid,
+					to+begin,   lcp_to+begin);
+			else
+				merge_lcp_2way<true>(
+					from+begin, lcp_from+begin, mid-begin,
+					from+mid,   lcp_from+mid,   end-mid,
+					to+begin,   lcp_to+begin);
+			merged.push_back(end);
+			begin = end;
+		}
+		if (bounds.size() % 2) {
+			std::copy(from+begin, from+n, to+begin);
+			std::copy(lcp_from+begin, lcp_from+n, lcp_to+begin);
+			merged.push_back(n);
+		}
+		bounds.swap(merged);
+		std::swap(from, to);
+		std::swap(lcp_from, lcp_to);
+	}
+	return from == strings ? SortedInPlace : SortedInTemp;
+}
+void
+mergesort_lcp_natural_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	unsigned char** tmp = static_cast<unsigned char**>(scratch);
+	lcp_t* lcp_input  = reinterpret_cast<lcp_t*>(tmp+n);
+	lcp_t* lcp_output = lcp_input+n;
+	if (n == 0) return;
+	const MergeResult m = mergesort_lcp_natural<false>(strings, tmp,
+			lcp_input, lcp_output, n);
+	if (m == SortedInTemp) {
+		(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
+	}
+}
+void
+mergesort_lcp_natural(unsigned char** strings, size_t n)
+{
+	void* scratch = big_malloc(n*scratch_per_string);
+	mergesort_lcp_natural_scratch(strings, n, scratch);
+	big_free(scratch);
+}
+void
+mergesort_lcp_natural_lcp(unsigned char** strings, size_t n, size_t* lcp)
+{
+	if (n == 0) return;
+	unsigned char** tmp = static_cast<unsigned char**>(
+			big_malloc(n*sizeof(unsigned char*)));
+	lcp_t* lcp_tmp = static_cast<lcp_t*>(big_malloc(n*sizeof(lcp_t)));
+	const MergeResult m = mergesort_lcp_natural<true>(strings, tmp,
+			lcp, lcp_tmp, n);
+	if (m == SortedInTemp) {
+		(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
+	}
+	output_lcp(lcp, lcp_tmp, m == SortedInTemp, n);
+	big_free(lcp_tmp);
+	big_free(tmp);
+}
+ROUTINE_REGISTER_FULL(mergesort_lcp_natural,
+		"Adaptive LCP mergesort of natural runs with 2way merger", 0,
+		ROUTINE_SCRATCH(mergesort_lcp_natural_scratch,
+				scratch_per_string),
+		ROUTINE_LCP(mergesort_lcp_natural_lcp))
 
 /*******************************************************************************
  *
@@ -432,11 +758,18 @@ merge_lcp_3way(unsigned char** from0, lcp_t* lcp_input0, size_t n0,
 			lcp1 = lcp01;                                          \
 			lcp2 = lcp02;                                          \
 			if (--n0 == 0) goto finish0;                           \
-			if (lcp0 > lcp1)  goto lcp_0gt1gt2;                    \
-			if (lcp0 == lcp1) goto lcp_0eq1gt2;                    \
-			if (lcp0 > lcp2)  goto lcp_1gt0gt2;                    \
-			if (lcp0 == lcp2) goto lcp_1gt0eq2;                    \
-			goto lcp_1gt2gt0;                                      \
+			if (lcp1 > lcp2) {                                     \
+				if (lcp0 > lcp1)  goto lcp_0gt1gt2;            \
+				if (lcp0 == lcp1) goto lcp_0eq1gt2;            \
+				if (lcp0 > lcp2)  goto lcp_1gt0gt2;            \
+				if (lcp0 == lcp2) goto lcp_1gt0eq2;            \
+				goto lcp_1gt2gt0;                              \
+			} else {                                               \
+				/* 0 is a prefix of 2 */                       \
+				if (lcp0 > lcp1)  goto lcp_0gt1eq2;            \
+				if (lcp0 == lcp1) goto lcp_0eq1eq2;            \
+				goto lcp_1eq2gt0;                              \
+			}                                                      \
 		} else if (cmp02 == 0) {                                       \
 			debug()<<"\t0 = 1 = 2\n";                              \
 			assert(lcp01 == lcp02);                                \
@@ -819,18 +1152,18 @@ void
 mergesort_lcp_3way(unsigned char** strings, size_t n)
 {
 	debug() << __func__ << '\n';
-	lcp_t* lcp_input = (lcp_t*) malloc(n*sizeof(lcp_t));
-	lcp_t* lcp_tmp   = (lcp_t*) malloc(n*sizeof(lcp_t));
+	lcp_t* lcp_input = (lcp_t*) big_malloc(n*sizeof(lcp_t));
+	lcp_t* lcp_tmp   = (lcp_t*) big_malloc(n*sizeof(lcp_t));
 	unsigned char** input_tmp = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 	const MergeResult m = mergesort_lcp_3way<false>(strings, input_tmp,
 			lcp_input, lcp_tmp, n);
 	if (m == SortedInTemp) {
 		(void) memcpy(strings, input_tmp, n*sizeof(unsigned char*));
 	}
-	free(lcp_input);
-	free(lcp_tmp);
-	free(input_tmp);
+	big_free(lcp_input);
+	big_free(lcp_tmp);
+	big_free(input_tmp);
 }
 ROUTINE_REGISTER_SINGLECORE(mergesort_lcp_3way, "LCP mergesort with 3way merger")
 
@@ -941,10 +1274,10 @@ void
 mergesort_lcp_3way_parallel(unsigned char** strings, size_t n)
 {
 	debug() << __func__ << '\n';
-	lcp_t* lcp_input = (lcp_t*) malloc(n*sizeof(lcp_t));
-	lcp_t* lcp_tmp   = (lcp_t*) malloc(n*sizeof(lcp_t));
+	lcp_t* lcp_input = (lcp_t*) big_malloc(n*sizeof(lcp_t));
+	lcp_t* lcp_tmp   = (lcp_t*) big_malloc(n*sizeof(lcp_t));
 	unsigned char** input_tmp = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 #pragma omp parallel
 	{
 #pragma omp single
@@ -956,9 +1289,9 @@ mergesort_lcp_3way_parallel(unsigned char** strings, size_t n)
 			}
 		}
 	}
-	free(lcp_input);
-	free(lcp_tmp);
-	free(input_tmp);
+	big_free(lcp_input);
+	big_free(lcp_tmp);
+	big_free(input_tmp);
 }
 ROUTINE_REGISTER_MULTICORE(mergesort_lcp_3way_parallel,
 		"Parallel LCP mergesort with 3way merger")
@@ -1407,21 +1740,21 @@ template <typename CharT>
 static void
 mergesort_cache_lcp_2way(unsigned char** strings, size_t n)
 {
-	lcp_t* lcp_input = (lcp_t*) malloc(n*sizeof(lcp_t));
-	lcp_t* lcp_tmp   = (lcp_t*) malloc(n*sizeof(lcp_t));
-	unsigned char** input_tmp = (unsigned char**) malloc(n*sizeof(unsigned char*));
-	CharT* cache     = (CharT*) malloc(n*sizeof(CharT));
-	CharT* cache_tmp = (CharT*) malloc(n*sizeof(CharT));
+	lcp_t* lcp_input = (lcp_t*) big_malloc(n*sizeof(lcp_t));
+	lcp_t* lcp_tmp   = (lcp_t*) big_malloc(n*sizeof(lcp_t));
+	unsigned char** input_tmp = (unsigned char**) big_malloc(n*sizeof(unsigned char*));
+	CharT* cache     = (CharT*) big_malloc(n*sizeof(CharT));
+	CharT* cache_tmp = (CharT*) big_malloc(n*sizeof(CharT));
 	MergeResult m = mergesort_cache_lcp_2way<false>(strings, input_tmp,
 			lcp_input, lcp_tmp, cache, cache_tmp, n);
 	if (m == SortedInTemp) {
 		memcpy(strings, input_tmp, n*sizeof(unsigned char*));
 	}
-	free(lcp_input);
-	free(lcp_tmp);
-	free(input_tmp);
-	free(cache);
-	free(cache_tmp);
+	big_free(lcp_input);
+	big_free(lcp_tmp);
+	big_free(input_tmp);
+	big_free(cache);
+	big_free(cache_tmp);
 	stat_print();
 }
 
@@ -1523,21 +1856,21 @@ template <typename CharT>
 static void
 mergesort_cache_lcp_2way_parallel(unsigned char** strings, size_t n)
 {
-	lcp_t* lcp_input = (lcp_t*) malloc(n*sizeof(lcp_t));
-	lcp_t* lcp_tmp   = (lcp_t*) malloc(n*sizeof(lcp_t));
-	unsigned char** input_tmp = (unsigned char**) malloc(n*sizeof(unsigned char*));
-	CharT* cache     = (CharT*) malloc(n*sizeof(CharT));
-	CharT* cache_tmp = (CharT*) malloc(n*sizeof(CharT));
+	lcp_t* lcp_input = (lcp_t*) big_malloc(n*sizeof(lcp_t));
+	lcp_t* lcp_tmp   = (lcp_t*) big_malloc(n*sizeof(lcp_t));
+	unsigned char** input_tmp = (unsigned char**) big_malloc(n*sizeof(unsigned char*));
+	CharT* cache     = (CharT*) big_malloc(n*sizeof(CharT));
+	CharT* cache_tmp = (CharT*) big_malloc(n*sizeof(CharT));
 	MergeResult m = mergesort_cache_lcp_2way_parallel<false>(strings, input_tmp,
 			lcp_input, lcp_tmp, cache, cache_tmp, n);
 	if (m == SortedInTemp) {
 		memcpy(strings, input_tmp, n*sizeof(unsigned char*));
 	}
-	free(lcp_input);
-	free(lcp_tmp);
-	free(input_tmp);
-	free(cache);
-	free(cache_tmp);
+	big_free(lcp_input);
+	big_free(lcp_tmp);
+	big_free(input_tmp);
+	big_free(cache);
+	big_free(cache_tmp);
 	stat_print();
 }
 
@@ -1716,8 +2049,10 @@ mergesort_lcp_2way_unstable(unsigned char** restrict strings_input,
 					lcp_input+split0);
 			mr = SortedInPlace;
 		} else {
-			assert(0);
-			abort();
+			std::copy(strings_output, strings_output+split0,
+					strings_input);
+			std::copy(lcp_output, lcp_output+split0, lcp_input);
+			ml = SortedInPlace;
 		}
 	}
 	if (ml == SortedInPlace) {
@@ -1737,18 +2072,18 @@ mergesort_lcp_2way_unstable(unsigned char** restrict strings_input,
 void
 mergesort_lcp_2way_unstable(unsigned char** strings, size_t n)
 {
-	lcp_t* lcp_input  = static_cast<lcp_t*>(malloc(n*sizeof(lcp_t)));
-	lcp_t* lcp_output = static_cast<lcp_t*>(malloc(n*sizeof(lcp_t)));
+	lcp_t* lcp_input  = static_cast<lcp_t*>(big_malloc(n*sizeof(lcp_t)));
+	lcp_t* lcp_output = static_cast<lcp_t*>(big_malloc(n*sizeof(lcp_t)));
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	const MergeResult m = mergesort_lcp_2way_unstable<false>(strings, tmp,
 			lcp_input, lcp_output, n);
 	if (m == SortedInTemp) {
 		(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
 	}
-	free(lcp_input);
-	free(lcp_output);
-	free(tmp);
+	big_free(lcp_input);
+	big_free(lcp_output);
+	big_free(tmp);
 }
 ROUTINE_REGISTER_SINGLECORE(mergesort_lcp_2way_unstable,
 		"Unstable LCP mergesort with 2way merger")
@@ -1789,8 +2124,10 @@ mergesort_lcp_2way_unstable_parallel(unsigned char** restrict strings_input,
 					lcp_input+split0);
 			mr = SortedInPlace;
 		} else {
-			assert(0);
-			abort();
+			std::copy(strings_output, strings_output+split0,
+					strings_input);
+			std::copy(lcp_output, lcp_output+split0, lcp_input);
+			ml = SortedInPlace;
 		}
 	}
 	if (ml == SortedInPlace) {
@@ -1810,10 +2147,10 @@ mergesort_lcp_2way_unstable_parallel(unsigned char** restrict strings_input,
 void
 mergesort_lcp_2way_unstable_parallel(unsigned char** strings, size_t n)
 {
-	lcp_t* lcp_input  = static_cast<lcp_t*>(malloc(n*sizeof(lcp_t)));
-	lcp_t* lcp_output = static_cast<lcp_t*>(malloc(n*sizeof(lcp_t)));
+	lcp_t* lcp_input  = static_cast<lcp_t*>(big_malloc(n*sizeof(lcp_t)));
+	lcp_t* lcp_output = static_cast<lcp_t*>(big_malloc(n*sizeof(lcp_t)));
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 #pragma omp parallel
 	{
 #pragma omp single
@@ -1825,9 +2162,9 @@ mergesort_lcp_2way_unstable_parallel(unsigned char** strings, size_t n)
 			}
 		}
 	}
-	free(lcp_input);
-	free(lcp_output);
-	free(tmp);
+	big_free(lcp_input);
+	big_free(lcp_output);
+	big_free(tmp);
 }
 ROUTINE_REGISTER_MULTICORE(mergesort_lcp_2way_unstable_parallel,
 		"Parallel unstable LCP mergesort with 2way merger")
@@ -24,6 +24,7 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/debug.h"
 #include <cassert>
 #include <cstring>
@@ -67,52 +68,82 @@ mergesort_losertree(unsigned char** strings, size_t n, unsigned char** tmp)
 	(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
 }
 
+void mergesort_losertree_64way_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_losertree<64>(strings, n, static_cast<unsigned char**>(scratch));
+}
 void mergesort_losertree_64way(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_losertree<64>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
+}
+void mergesort_losertree_128way_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_losertree<128>(strings, n, static_cast<unsigned char**>(scratch));
 }
 void mergesort_losertree_128way(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_losertree<128>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
+}
+void mergesort_losertree_256way_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_losertree<256>(strings, n, static_cast<unsigned char**>(scratch));
 }
 void mergesort_losertree_256way(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_losertree<256>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
+}
+void mergesort_losertree_512way_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_losertree<512>(strings, n, static_cast<unsigned char**>(scratch));
 }
 void mergesort_losertree_512way(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_losertree<512>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
+}
+void mergesort_losertree_1024way_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_losertree<1024>(strings, n, static_cast<unsigned char**>(scratch));
 }
 void mergesort_losertree_1024way(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_losertree<1024>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
 
-ROUTINE_REGISTER_SINGLECORE(mergesort_losertree_64way,
-		"64way loser tree based mergesort")
-ROUTINE_REGISTER_SINGLECORE(mergesort_losertree_128way,
-		"128way loser tree based mergesort")
-ROUTINE_REGISTER_SINGLECORE(mergesort_losertree_256way,
-		"256way loser tree based mergesort")
-ROUTINE_REGISTER_SINGLECORE(mergesort_losertree_512way,
-		"512way loser tree based mergesort")
-ROUTINE_REGISTER_SINGLECORE(mergesort_losertree_1024way,
-		"1024way loser tree based mergesort")
+ROUTINE_REGISTER_FULL(mergesort_losertree_64way,
+		"64way loser tree based mergesort", 0,
+		ROUTINE_SCRATCH(mergesort_losertree_64way_scratch,
+			sizeof(unsigned char*)))
+ROUTINE_REGISTER_FULL(mergesort_losertree_128way,
+		"128way loser tree based mergesort", 0,
+		ROUTINE_SCRATCH(mergesort_losertree_128way_scratch,
+			sizeof(unsigned char*)))
+ROUTINE_REGISTER_FULL(mergesort_losertree_256way,
+		"256way loser tree based mergesort", 0,
+		ROUTINE_SCRATCH(mergesort_losertree_256way_scratch,
+			sizeof(unsigned char*)))
+ROUTINE_REGISTER_FULL(mergesort_losertree_512way,
+		"512way loser tree based mergesort", 0,
+		ROUTINE_SCRATCH(mergesort_losertree_512way_scratch,
+			sizeof(unsigned char*)))
+ROUTINE_REGISTER_FULL(mergesort_losertree_1024way,
+		"1024way loser tree based mergesort", 0,
+		ROUTINE_SCRATCH(mergesort_losertree_1024way_scratch,
+			sizeof(unsigned char*)))
 
 void mergesort_4way_parallel(unsigned char**, size_t, unsigned char**);
 
@@ -142,49 +173,79 @@ mergesort_losertree_parallel(unsigned char** strings, size_t n, unsigned char**
 	(void) memcpy(strings, tmp, n*sizeof(unsigned char*));
 }
 
+void mergesort_losertree_64way_parallel_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_losertree_parallel<64>(strings, n, static_cast<unsigned char**>(scratch));
+}
 void mergesort_losertree_64way_parallel(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_losertree_parallel<64>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
+}
+void mergesort_losertree_128way_parallel_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_losertree_parallel<128>(strings, n, static_cast<unsigned char**>(scratch));
 }
 void mergesort_losertree_128way_parallel(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_losertree_parallel<128>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
+}
+void mergesort_losertree_256way_parallel_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_losertree_parallel<256>(strings, n, static_cast<unsigned char**>(scratch));
 }
 void mergesort_losertree_256way_parallel(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_losertree_parallel<256>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
+}
+void mergesort_losertree_512way_parallel_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_losertree_parallel<512>(strings, n, static_cast<unsigned char**>(scratch));
 }
 void mergesort_losertree_512way_parallel(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_losertree_parallel<512>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
+}
+void mergesort_losertree_1024way_parallel_scratch(unsigned char** strings, size_t n, void* scratch)
+{
+	mergesort_losertree_parallel<1024>(strings, n, static_cast<unsigned char**>(scratch));
 }
 void mergesort_losertree_1024way_parallel(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_losertree_parallel<1024>(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
 
-ROUTINE_REGISTER_MULTICORE(mergesort_losertree_64way_parallel,
-		"Parallel 64way loser tree based mergesort")
-ROUTINE_REGISTER_MULTICORE(mergesort_losertree_128way_parallel,
-		"Parallel 128way loser tree based mergesort")
-ROUTINE_REGISTER_MULTICORE(mergesort_losertree_256way_parallel,
-		"Parallel 256way loser tree based mergesort")
-ROUTINE_REGISTER_MULTICORE(mergesort_losertree_512way_parallel,
-		"Parallel 512way loser tree based mergesort")
-ROUTINE_REGISTER_MULTICORE(mergesort_losertree_1024way_parallel,
-		"Parallel 1024way loser tree based mergesort")
+ROUTINE_REGISTER_FULL(mergesort_losertree_64way_parallel,
+		"Parallel 64way loser tree based mergesort", 1,
+		ROUTINE_SCRATCH(mergesort_losertree_64way_parallel_scratch,
+			sizeof(unsigned char*)))
+ROUTINE_REGISTER_FULL(mergesort_losertree_128way_parallel,
+		"Parallel 128way loser tree based mergesort", 1,
+		ROUTINE_SCRATCH(mergesort_losertree_128way_parallel_scratch,
+			sizeof(unsigned char*)))
+ROUTINE_REGISTER_FULL(mergesort_losertree_256way_parallel,
+		"Parallel 256way loser tree based mergesort", 1,
+		ROUTINE_SCRATCH(mergesort_losertree_256way_parallel_scratch,
+			sizeof(unsigned char*)))
+ROUTINE_REGISTER_FULL(mergesort_losertree_512way_parallel,
+		"Parallel 512way loser tree based mergesort", 1,
+		ROUTINE_SCRATCH(mergesort_losertree_512way_parallel_scratch,
+			sizeof(unsigned char*)))
+ROUTINE_REGISTER_FULL(mergesort_losertree_1024way_parallel,
+		"Parallel 1024way loser tree based mergesort", 1,
+		ROUTINE_SCRATCH(mergesort_losertree_1024way_parallel_scratch,
+			sizeof(unsigned char*)))
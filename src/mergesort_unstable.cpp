@@ -41,6 +41,7 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/debug.h"
 #include "util/insertion_sort.h"
 #include <vector>
@@ -148,9 +149,9 @@ mergesort_2way_unstable(unsigned char** strings, size_t n, unsigned char** tmp)
 void mergesort_2way_unstable(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_2way_unstable(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
 ROUTINE_REGISTER_SINGLECORE(mergesort_2way_unstable, "2way unstable mergesort")
 
@@ -329,9 +330,9 @@ mergesort_3way_unstable(unsigned char** strings, size_t n, unsigned char** tmp)
 void mergesort_3way_unstable(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_3way_unstable(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
 ROUTINE_REGISTER_SINGLECORE(mergesort_3way_unstable, "3way unstable mergesort")
 
@@ -1872,8 +1873,8 @@ mergesort_4way_unstable(unsigned char** strings, size_t n, unsigned char** tmp)
 void mergesort_4way_unstable(unsigned char** strings, size_t n)
 {
 	unsigned char** tmp = static_cast<unsigned char**>(
-			malloc(n*sizeof(unsigned char*)));
+			big_malloc(n*sizeof(unsigned char*)));
 	mergesort_4way_unstable(strings, n, tmp);
-	free(tmp);
+	big_free(tmp);
 }
 ROUTINE_REGISTER_SINGLECORE(mergesort_4way_unstable, "4way unstable mergesort")
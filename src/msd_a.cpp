@@ -30,6 +30,8 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
+#include "util/get_char.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -43,8 +45,9 @@ typedef struct {
 	unsigned char* ptr;
 } cacheblock_t;
 
+template <typename ByteMap>
 static inline void
-inssort_cache(cacheblock_t* cache, int n, size_t depth)
+inssort_cache(cacheblock_t* cache, int n, size_t depth, const ByteMap& bm)
 {
 	cacheblock_t *pi, *pj;
 	unsigned char *s, *t;
@@ -52,9 +55,11 @@ inssort_cache(cacheblock_t* cache, int n, size_t depth)
 		unsigned char* tmp = pi->ptr;
 		for (pj = pi; pj > cache; --pj) {
 			t = tmp + depth;
-			for (s=(pj-1)->ptr+depth; *s==*t && *s!=0; ++s, ++t)
+			for (s=(pj-1)->ptr+depth;
+			     bm.map(*s)==bm.map(*t) && *s!=0;
+			     ++s, ++t)
 				;
-			if (*s <= *t)
+			if (bm.map(*s) <= bm.map(*t))
 				break;
 			pj->ptr = (pj-1)->ptr;
 		}
@@ -62,13 +67,14 @@ inssort_cache(cacheblock_t* cache, int n, size_t depth)
 	}
 }
 
+template <typename ByteMap>
 static void
-fill_cache(cacheblock_t* cache, size_t N, size_t depth)
+fill_cache(cacheblock_t* cache, size_t N, size_t depth, const ByteMap& bm)
 {
 	for (size_t i=0; i < N; ++i) {
 		unsigned int j=0;
 		while (j < CACHED_BYTES && cache[i].ptr[depth+j]) {
-			cache[i].bytes[j] = cache[i].ptr[depth+j];
+			cache[i].bytes[j] = bm.map(cache[i].ptr[depth+j]);
 			++j;
 		}
 		while (j < CACHED_BYTES) {
@@ -78,23 +84,25 @@ fill_cache(cacheblock_t* cache, size_t N, size_t depth)
 	}
 }
 
+template <typename ByteMap>
 static void
-msd_A(cacheblock_t* cache, size_t N, size_t cache_depth, size_t true_depth)
+msd_A(cacheblock_t* cache, size_t N, size_t cache_depth, size_t true_depth,
+		const ByteMap& bm)
 {
 	if (N < 32) {
-		inssort_cache(cache, N, true_depth);
+		inssort_cache(cache, N, true_depth, bm);
 		return;
 	}
 	if (cache_depth >= CACHED_BYTES) {
-		fill_cache(cache, N, true_depth);
+		fill_cache(cache, N, true_depth, bm);
 		cache_depth = 0;
 	}
 	size_t bucketsize[256] = {0};
 	for (size_t i=0; i < N; ++i)
 		++bucketsize[cache[i].bytes[cache_depth]];
 	cacheblock_t* sorted = (cacheblock_t*)
-		malloc(N*sizeof(cacheblock_t));
-	static size_t bucketindex[256];
+		big_malloc(N*sizeof(cacheblock_t));
+	size_t bucketindex[256];
 	bucketindex[0] = 0;
 	for (unsigned i=1; i < 256; ++i)
 		bucketindex[i] = bucketindex[i-1] + bucketsize[i-1];
@@ -102,28 +110,31 @@ msd_A(cacheblock_t* cache, size_t N, size_t cache_depth, size_t true_depth)
 		memcpy(&sorted[bucketindex[cache[i].bytes[cache_depth]]++],
 				cache+i, sizeof(cacheblock_t));
 	memcpy(cache, sorted, N*sizeof(cacheblock_t));
-	free(sorted);
+	big_free(sorted);
 	size_t bsum = bucketsize[0];
 	for (unsigned i=1; i < 256; ++i) {
 		if (bucketsize[i] == 0) continue;
-		msd_A(cache+bsum, bucketsize[i],
-			  cache_depth+1, true_depth+1);
+		msd_A(cache+bsum, bucketsize[i], cache_depth+1, true_depth+1,
+				bm);
 		bsum += bucketsize[i];
 	}
 }
 
+template <typename ByteMap>
 static void
 msd_A_adaptive(cacheblock_t* cache,
                size_t N,
                size_t cache_depth,
-               size_t true_depth)
+               size_t true_depth,
+               const ByteMap& bm,
+               size_t* bucketindex)
 {
 	if (N < 0x10000) {
-		msd_A(cache, N, cache_depth, true_depth);
+		msd_A(cache, N, cache_depth, true_depth, bm);
 		return;
 	}
 	if (cache_depth >= CACHED_BYTES) {
-		fill_cache(cache, N, true_depth);
+		fill_cache(cache, N, true_depth, bm);
 		cache_depth = 0;
 	}
 	size_t* bucketsize = (size_t*) calloc(0x10000, sizeof(size_t));
@@ -134,8 +145,7 @@ msd_A_adaptive(cacheblock_t* cache,
 		++bucketsize[bucket];
 	}
 	cacheblock_t* sorted = (cacheblock_t*)
-		malloc(N*sizeof(cacheblock_t));
-	static size_t bucketindex[0x10000];
+		big_malloc(N*sizeof(cacheblock_t));
 	bucketindex[0] = 0;
 	for (unsigned i=1; i < 0x10000; ++i)
 		bucketindex[i] = bucketindex[i-1] + bucketsize[i-1];
@@ -146,37 +156,67 @@ msd_A_adaptive(cacheblock_t* cache,
 				cache+i, sizeof(cacheblock_t));
 	}
 	memcpy(cache, sorted, N*sizeof(cacheblock_t));
-	free(sorted);
+	big_free(sorted);
 	size_t bsum = bucketsize[0];
 	for (unsigned i=1; i < 0x10000; ++i) {
 		if (bucketsize[i] == 0) continue;
 		if (i & 0xFF) msd_A_adaptive(cache+bsum, bucketsize[i],
-				cache_depth+2, true_depth+2);
+				cache_depth+2, true_depth+2, bm, bucketindex);
 		bsum += bucketsize[i];
 	}
 	free(bucketsize);
 }
 
-void
-msd_A(unsigned char** strings, size_t N)
+template <typename ByteMap>
+static void
+msd_A(unsigned char** strings, size_t N, bool adaptive, const ByteMap& bm)
 {
-	cacheblock_t* cache = (cacheblock_t*) malloc(N*sizeof(cacheblock_t));
+	cacheblock_t* cache = (cacheblock_t*) big_malloc(N*sizeof(cacheblock_t));
 	for (size_t i=0; i < N; ++i) cache[i].ptr = strings[i];
-	fill_cache(cache, N, 0);
-	msd_A(cache, N, 0, 0);
+	fill_cache(cache, N, 0, bm);
+	if (adaptive and N >= 0x10000) {
+		// Only needed until the strings are in their buckets, so the
+		// whole recursion shares one array.
+		size_t* bucketindex = (size_t*) malloc(0x10000*sizeof(size_t));
+		if (not bucketindex) {
+			fprintf(stderr, "ERROR: msd_A_adaptive(): unable to "
+				"allocate memory for the bucket index\n");
+			abort();
+		}
+		msd_A_adaptive(cache, N, 0, 0, bm, bucketindex);
+		free(bucketindex);
+	} else {
+		msd_A(cache, N, 0, 0, bm);
+	}
 	for (size_t i=0; i < N; ++i) strings[i] = cache[i].ptr;
-	free(cache);
+	big_free(cache);
+}
+
+void
+msd_A(unsigned char** strings, size_t N)
+{
+	msd_A(strings, N, false, identity_map());
 }
-ROUTINE_REGISTER_SINGLECORE(msd_A, "msd_A")
+void
+msd_A_collate(unsigned char** strings, size_t N, const unsigned char* table)
+{
+	msd_A(strings, N, false, table_map{table});
+}
+ROUTINE_REGISTER_FULL(msd_A,
+		"msd_A", 0,
+		ROUTINE_COLLATE(msd_A_collate))
 
 void
 msd_A_adaptive(unsigned char** strings, size_t N)
 {
-	cacheblock_t* cache = (cacheblock_t*) malloc(N*sizeof(cacheblock_t));
-	for (size_t i=0; i < N; ++i) cache[i].ptr = strings[i];
-	fill_cache(cache, N, 0);
-	msd_A_adaptive(cache, N, 0, 0);
-	for (size_t i=0; i < N; ++i) strings[i] = cache[i].ptr;
-	free(cache);
+	msd_A(strings, N, true, identity_map());
+}
+void
+msd_A_adaptive_collate(unsigned char** strings, size_t N,
+		const unsigned char* table)
+{
+	msd_A(strings, N, true, table_map{table});
 }
-ROUTINE_REGISTER_SINGLECORE(msd_A_adaptive, "msd_A_adaptive")
+ROUTINE_REGISTER_FULL(msd_A_adaptive,
+		"msd_A_adaptive", 0,
+		ROUTINE_COLLATE(msd_A_adaptive_collate))
@@ -27,6 +27,7 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/debug.h"
 #include <cassert>
 #include <cstdlib>
@@ -115,14 +116,14 @@ struct TempSpace
 		assert(allocated==0);
 		if (elems > elements_in_strings) {
 			allocated = static_cast<cacheblock_t*>(
-					malloc((elems-elements_in_strings) *
+					big_malloc((elems-elements_in_strings) *
 						sizeof(cacheblock_t)));
 		}
 	}
 	void deallocate()
 	{
 		if (allocated) {
-			::free(allocated);
+			big_free(allocated);
 			allocated = 0;
 		}
 	}
@@ -227,13 +228,13 @@ void
 msd_A2(unsigned char** strings, size_t N)
 {
 	cacheblock_t* cache =
-		static_cast<cacheblock_t*>(malloc(N*sizeof(cacheblock_t)));
+		static_cast<cacheblock_t*>(big_malloc(N*sizeof(cacheblock_t)));
 	for (size_t i=0; i < N; ++i) cache[i].ptr = strings[i];
 	TempSpace tmp(strings, N);
 	fill_cache(cache, N, 0);
 	msd_A2(cache, N, 0, 0, tmp);
 	for (size_t i=0; i < N; ++i) strings[i] = cache[i].ptr;
-	free(cache);
+	big_free(cache);
 }
 ROUTINE_REGISTER_SINGLECORE(msd_A2, "msd_A2")
 
@@ -241,12 +242,12 @@ void
 msd_A2_adaptive(unsigned char** strings, size_t N)
 {
 	cacheblock_t* cache =
-		static_cast<cacheblock_t*>(malloc(N*sizeof(cacheblock_t)));
+		static_cast<cacheblock_t*>(big_malloc(N*sizeof(cacheblock_t)));
 	for (size_t i=0; i < N; ++i) cache[i].ptr = strings[i];
 	TempSpace tmp(strings, N);
 	fill_cache(cache, N, 0);
 	msd_A2_adaptive(cache, N, 0, 0, tmp);
 	for (size_t i=0; i < N; ++i) strings[i] = cache[i].ptr;
-	free(cache);
+	big_free(cache);
 }
 ROUTINE_REGISTER_SINGLECORE(msd_A2_adaptive, "msd_A2_adaptive")
@@ -67,11 +67,14 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/insertion_sort.h"
+#include "util/index_array.h"
 #include "util/get_char.h"
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
+#include <type_traits>
 
 void
 msd_CE0(unsigned char** strings, size_t n, size_t depth)
@@ -84,7 +87,7 @@ msd_CE0(unsigned char** strings, size_t n, size_t depth)
 	for (size_t i=0; i < n; ++i)
 		++bucketsize[strings[i][depth]];
 	unsigned char** sorted = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 	static size_t bucketindex[256];
 	bucketindex[0] = 0;
 	for (size_t i=1; i < 256; ++i)
@@ -92,7 +95,7 @@ msd_CE0(unsigned char** strings, size_t n, size_t depth)
 	for (size_t i=0; i < n; ++i)
 		sorted[bucketindex[strings[i][depth]]++] = strings[i];
 	memcpy(strings, sorted, n*sizeof(unsigned char*));
-	free(sorted);
+	big_free(sorted);
 	size_t bsum = bucketsize[0];
 	for (size_t i=1; i < 256; ++i) {
 		if (bucketsize[i] == 0) continue;
@@ -114,11 +117,11 @@ msd_CE1(unsigned char** strings, size_t n, size_t depth)
 	}
 	size_t bucketsize[256] = {0};
 	unsigned char* restrict oracle =
-		(unsigned char*) malloc(n);
+		(unsigned char*) big_malloc(n);
 	for (size_t i=0; i < n; ++i)
 		++bucketsize[oracle[i] = strings[i][depth]];
 	unsigned char** restrict sorted = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 	size_t bucketindex[256];
 	bucketindex[0] = 0;
 	for (size_t i=1; i < 256; ++i)
@@ -126,8 +129,8 @@ msd_CE1(unsigned char** strings, size_t n, size_t depth)
 	for (size_t i=0; i < n; ++i)
 		sorted[bucketindex[oracle[i]]++] = strings[i];
 	memcpy(strings, sorted, n*sizeof(unsigned char*));
-	free(sorted);
-	free(oracle);
+	big_free(sorted);
+	big_free(oracle);
 	size_t bsum = bucketsize[0];
 	for (unsigned short i=1; i < 256; ++i) {
 		if (bucketsize[i] == 0) continue;
@@ -140,6 +143,44 @@ void msd_CE1(unsigned char** strings, size_t n)
 { msd_CE1(strings, n, 0); }
 ROUTINE_REGISTER_SINGLECORE(msd_CE1, "CE1: oracle")
 
+// The distribution step of the msd_CE2 variants: stores the bucket of every
+// string in the oracle, counts the bucket sizes into the zeroed bucketsize,
+// and moves the strings to the order of their buckets. The variants differ
+// only in how they recurse into the buckets. The input indexes of
+// msd_CE2_perm() are moved along with the strings.
+template <unsigned Buckets, typename StringT, typename BucketFn,
+	typename IndexT=no_index>
+static inline void
+msd_CE2_distribute(StringT* strings, size_t n, size_t* bucketsize,
+		BucketFn bucket, IndexT idx=IndexT())
+{
+	typedef typename std::conditional<(Buckets > 256),
+		uint16_t, unsigned char>::type oracle_t;
+	oracle_t* restrict oracle =
+		(oracle_t*) big_malloc(n*sizeof(oracle_t));
+	for (size_t i=0; i < n; ++i)
+		oracle[i] = bucket(strings[i]);
+	for (size_t i=0; i < n; ++i)
+		++bucketsize[oracle[i]];
+	StringT* restrict sorted = (StringT*)
+		big_malloc(n*sizeof(StringT));
+	size_t bucketindex[Buckets];
+	bucketindex[0] = 0;
+	for (size_t i=1; i < Buckets; ++i)
+		bucketindex[i] = bucketindex[i-1]+bucketsize[i-1];
+	IndexT sorted_idx = alloc_index(idx, n);
+	for (size_t i=0; i < n; ++i) {
+		const size_t j = bucketindex[oracle[i]]++;
+		sorted[j] = strings[i];
+		sorted_idx[j] = idx[i];
+	}
+	memcpy(strings, sorted, n*sizeof(StringT));
+	copy_index(sorted_idx, n, idx);
+	free_index(sorted_idx);
+	big_free(sorted);
+	big_free(oracle);
+}
+
 void
 msd_CE2(unsigned char** strings, size_t n, size_t depth)
 {
@@ -148,34 +189,190 @@ msd_CE2(unsigned char** strings, size_t n, size_t depth)
 		return;
 	}
 	size_t bucketsize[256] = {0};
-	unsigned char* restrict oracle =
-		(unsigned char*) malloc(n);
-	for (size_t i=0; i < n; ++i)
-		oracle[i] = strings[i][depth];
-	for (size_t i=0; i < n; ++i)
-		++bucketsize[oracle[i]];
-	unsigned char** restrict sorted = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
-	size_t bucketindex[256];
-	bucketindex[0] = 0;
-	for (size_t i=1; i < 256; ++i)
-		bucketindex[i] = bucketindex[i-1]+bucketsize[i-1];
-	for (size_t i=0; i < n; ++i)
-		sorted[bucketindex[oracle[i]]++] = strings[i];
-	memcpy(strings, sorted, n*sizeof(unsigned char*));
-	free(sorted);
-	free(oracle);
+	msd_CE2_distribute<256>(strings, n, bucketsize,
+		[depth](unsigned char* s) { return s[depth]; });
+	size_t bsum = bucketsize[0];
+	for (size_t i=1; i < 256; ++i) {
+		if (bucketsize[i] == 0) continue;
+		msd_CE2(strings+bsum, bucketsize[i], depth+1);
+		bsum += bucketsize[i];
+	}
+}
+
+// Same as msd_CE2(), but only recurses into the buckets that overlap the
+// first k positions.
+static void
+msd_CE2_top(unsigned char** strings, size_t n, size_t depth, size_t k)
+{
+	if (n < 32) {
+		insertion_sort(strings, n, depth);
+		return;
+	}
+	size_t bucketsize[256] = {0};
+	msd_CE2_distribute<256>(strings, n, bucketsize,
+		[depth](unsigned char* s) { return s[depth]; });
+	size_t bsum = bucketsize[0];
+	for (size_t i=1; i < 256 and bsum < k; ++i) {
+		if (bucketsize[i] == 0) continue;
+		if (bsum + bucketsize[i] <= k)
+			msd_CE2(strings+bsum, bucketsize[i], depth+1);
+		else
+			msd_CE2_top(strings+bsum, bucketsize[i], depth+1,
+					k-bsum);
+		bsum += bucketsize[i];
+	}
+}
+
+// Same as msd_CE2(), but collapses the equal strings while sorting. The
+// strings that end at `depth' are all equal, and the distinct strings of
+// each bucket are moved down next to the previous bucket.
+static size_t
+msd_CE2_unique(unsigned char** strings, size_t n, size_t depth,
+		size_t* counts)
+{
+	if (n < 32) {
+		insertion_sort(strings, n, depth);
+		return collapse_sorted(strings, n, depth, counts);
+	}
+	size_t bucketsize[256] = {0};
+	msd_CE2_distribute<256>(strings, n, bucketsize,
+		[depth](unsigned char* s) { return s[depth]; });
+	size_t m = 0;
+	if (bucketsize[0]) {
+		if (counts) counts[0] = bucketsize[0];
+		m = 1;
+	}
+	size_t bsum = bucketsize[0];
+	for (size_t i=1; i < 256; ++i) {
+		if (bucketsize[i] == 0) continue;
+		size_t distinct = msd_CE2_unique(strings+bsum, bucketsize[i],
+				depth+1, counts ? counts+bsum : 0);
+		memmove(strings+m, strings+bsum,
+				distinct*sizeof(unsigned char*));
+		if (counts)
+			memmove(counts+m, counts+bsum, distinct*sizeof(size_t));
+		m += distinct;
+		bsum += bucketsize[i];
+	}
+	return m;
+}
+
+// Same as msd_CE2(), and stores lcp[i] = lcp(strings[i-1], strings[i]) for
+// 0 < i < n. The strings that end at `depth' are equal, and the first string of
+// each bucket shares exactly `depth' characters with its predecessor.
+static void
+msd_CE2_lcp(unsigned char** strings, size_t n, size_t depth, size_t* lcp)
+{
+	if (n < 32) {
+		insertion_sort(strings, n, depth);
+		lcp_sorted(strings, n, depth, lcp);
+		return;
+	}
+	size_t bucketsize[256] = {0};
+	msd_CE2_distribute<256>(strings, n, bucketsize,
+		[depth](unsigned char* s) { return s[depth]; });
+	for (size_t i=1; i < bucketsize[0]; ++i)
+		lcp[i] = depth;
 	size_t bsum = bucketsize[0];
 	for (size_t i=1; i < 256; ++i) {
+		if (bucketsize[i] == 0) continue;
+		msd_CE2_lcp(strings+bsum, bucketsize[i], depth+1, lcp+bsum);
+		if (bsum) lcp[bsum] = depth;
+		bsum += bucketsize[i];
+	}
+}
+
+// Binary strings need one more bucket for the strings that end at `depth':
+// bucket 0 holds them, and byte value b goes to bucket b+1.
+static inline uint16_t
+binary_bucket(const bstring& s, size_t depth)
+{
+	const uint16_t c = get_char<uint16_t>(s, depth);
+	return (c >> 8) + (c & 1);
+}
+
+void
+msd_CE2(bstring* strings, size_t n, size_t depth)
+{
+	if (n < 32) {
+		insertion_sort(strings, n, depth);
+		return;
+	}
+	size_t bucketsize[257] = {0};
+	msd_CE2_distribute<257>(strings, n, bucketsize,
+		[depth](const bstring& s) { return binary_bucket(s, depth); });
+	size_t bsum = bucketsize[0];
+	for (size_t i=1; i < 257; ++i) {
 		if (bucketsize[i] == 0) continue;
 		msd_CE2(strings+bsum, bucketsize[i], depth+1);
 		bsum += bucketsize[i];
 	}
 }
 
+static void
+msd_CE2(unsigned char** strings, size_t* idx, size_t n, size_t depth)
+{
+	if (n < 32) {
+		insertion_sort(strings, idx, n, depth);
+		return;
+	}
+	size_t bucketsize[256] = {0};
+	msd_CE2_distribute<256>(strings, n, bucketsize,
+		[depth](unsigned char* s) { return s[depth]; }, idx);
+	size_t bsum = bucketsize[0];
+	for (size_t i=1; i < 256; ++i) {
+		if (bucketsize[i] == 0) continue;
+		msd_CE2(strings+bsum, idx+bsum, bucketsize[i], depth+1);
+		bsum += bucketsize[i];
+	}
+}
+
+static void
+msd_CE2(text_offset* strings, size_t n, size_t depth, unsigned char* text)
+{
+	if (n < 32) {
+		insertion_sort(strings, n, depth, offset_access{text});
+		return;
+	}
+	const unsigned char* chars = text + depth;
+	size_t bucketsize[256] = {0};
+	msd_CE2_distribute<256>(strings, n, bucketsize,
+		[chars](text_offset s) { return chars[s.offset]; });
+	size_t bsum = bucketsize[0];
+	for (size_t i=1; i < 256; ++i) {
+		if (bucketsize[i] == 0) continue;
+		msd_CE2(strings+bsum, bucketsize[i], depth+1, text);
+		bsum += bucketsize[i];
+	}
+}
+
 void msd_CE2(unsigned char** strings, size_t n)
 { msd_CE2(strings, n, 0); }
-ROUTINE_REGISTER_SINGLECORE(msd_CE2, "CE2: oracle+loop fission")
+void msd_CE2_binary(bstring* strings, size_t n)
+{ msd_CE2(strings, n, 0); }
+void msd_CE2_offset(uint32_t* strings, size_t n, unsigned char* text)
+{
+	msd_CE2(reinterpret_cast<text_offset*>(strings), n, 0, text);
+}
+void msd_CE2_top(unsigned char** strings, size_t n, size_t k)
+{ msd_CE2_top(strings, n, 0, k); }
+size_t msd_CE2_unique(unsigned char** strings, size_t n, size_t* counts)
+{ return msd_CE2_unique(strings, n, 0, counts); }
+void msd_CE2_lcp(unsigned char** strings, size_t n, size_t* lcp)
+{ if (n) lcp[0] = 0; msd_CE2_lcp(strings, n, 0, lcp); }
+void msd_CE2_perm(unsigned char** strings, size_t n, size_t* perm)
+{
+	identity_index(perm, n);
+	msd_CE2(strings, perm, n, 0);
+}
+ROUTINE_REGISTER_FULL(msd_CE2,
+		"CE2: oracle+loop fission", 0,
+		ROUTINE_BINARY(msd_CE2_binary),
+		ROUTINE_OFFSET(msd_CE2_offset),
+		ROUTINE_TOP(msd_CE2_top),
+		ROUTINE_UNIQUE(msd_CE2_unique),
+		ROUTINE_LCP(msd_CE2_lcp),
+		ROUTINE_PERM(msd_CE2_perm))
 
 void
 msd_CE2_16bit(unsigned char** strings, size_t n, size_t depth)
@@ -186,13 +383,13 @@ msd_CE2_16bit(unsigned char** strings, size_t n, size_t depth)
 	}
 	uint16_t bucketsize[256] = {0};
 	unsigned char* restrict oracle =
-		(unsigned char*) malloc(n);
+		(unsigned char*) big_malloc(n);
 	for (size_t i=0; i < n; ++i)
 		oracle[i] = strings[i][depth];
 	for (size_t i=0; i < n; ++i)
 		++bucketsize[oracle[i]];
 	unsigned char** restrict sorted = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 	uint16_t bucketindex[256];
 	bucketindex[0] = 0;
 	for (size_t i=1; i < 256; ++i)
@@ -200,8 +397,8 @@ msd_CE2_16bit(unsigned char** strings, size_t n, size_t depth)
 	for (size_t i=0; i < n; ++i)
 		sorted[bucketindex[oracle[i]]++] = strings[i];
 	memcpy(strings, sorted, n*sizeof(unsigned char*));
-	free(sorted);
-	free(oracle);
+	big_free(sorted);
+	big_free(oracle);
 	size_t bsum = bucketsize[0];
 	for (size_t i=1; i < 256; ++i) {
 		if (bucketsize[i] == 0) continue;
@@ -218,7 +415,7 @@ msd_CE3(unsigned char** strings, size_t n, size_t depth)
 		return;
 	}
 	uint16_t* restrict oracle =
-		(uint16_t*) malloc(n*sizeof(uint16_t));
+		(uint16_t*) big_malloc(n*sizeof(uint16_t));
 	for (size_t i=0; i < n; ++i)
 		oracle[i] = get_char<uint16_t>(strings[i], depth);
 	size_t* restrict bucketsize = (size_t*)
@@ -226,7 +423,7 @@ msd_CE3(unsigned char** strings, size_t n, size_t depth)
 	for (size_t i=0; i < n; ++i)
 		++bucketsize[oracle[i]];
 	unsigned char** sorted = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 	static size_t bucketindex[0x10000];
 	bucketindex[0] = 0;
 	for (size_t i=1; i < 0x10000; ++i)
@@ -234,8 +431,8 @@ msd_CE3(unsigned char** strings, size_t n, size_t depth)
 	for (size_t i=0; i < n; ++i)
 		sorted[bucketindex[oracle[i]]++] = strings[i];
 	memcpy(strings, sorted, n*sizeof(unsigned char*));
-	free(sorted);
-	free(oracle);
+	big_free(sorted);
+	big_free(oracle);
 	size_t bsum = bucketsize[0];
 	for (size_t i=1; i < 0x10000; ++i) {
 		if (bucketsize[i] == 0) continue;
@@ -258,7 +455,7 @@ msd_CE4(unsigned char** strings, size_t n, size_t depth)
 		return;
 	}
 	uint16_t* restrict oracle =
-		(uint16_t*) malloc(n*sizeof(uint16_t));
+		(uint16_t*) big_malloc(n*sizeof(uint16_t));
 	for (size_t i=0; i < n; ++i)
 		oracle[i] = get_char<uint16_t>(strings[i], depth);
 	size_t* restrict bucketsize = (size_t*)
@@ -266,7 +463,7 @@ msd_CE4(unsigned char** strings, size_t n, size_t depth)
 	for (size_t i=0; i < n; ++i)
 		++bucketsize[oracle[i]];
 	unsigned char** sorted = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 	static size_t bucketindex[0x10000];
 	bucketindex[0] = 0;
 	for (size_t i=1; i < 0x10000; ++i)
@@ -274,8 +471,8 @@ msd_CE4(unsigned char** strings, size_t n, size_t depth)
 	for (size_t i=0; i < n; ++i)
 		sorted[bucketindex[oracle[i]]++] = strings[i];
 	memcpy(strings, sorted, n*sizeof(unsigned char*));
-	free(sorted);
-	free(oracle);
+	big_free(sorted);
+	big_free(oracle);
 	size_t bsum = bucketsize[0];
 	for (size_t i=1; i < 0x10000; ++i) {
 		if (bucketsize[i] == 0) continue;
@@ -354,12 +551,12 @@ msd_CE5(unsigned char** strings, size_t n, size_t depth,
 void msd_CE5(unsigned char** strings, size_t n)
 {
 	uint16_t* restrict oracle = (uint16_t*)
-		malloc(n*sizeof(uint16_t));
+		big_malloc(n*sizeof(uint16_t));
 	unsigned char** sorted = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 	msd_CE5(strings, n, 0, oracle, sorted);
-	free(oracle);
-	free(sorted);
+	big_free(oracle);
+	big_free(sorted);
 }
 ROUTINE_REGISTER_SINGLECORE(msd_CE5,
 	"CE5: oracle+loop fission+adaptive+16bit counter+prealloc")
@@ -408,12 +605,12 @@ msd_CE6(unsigned char** strings, size_t n, size_t depth,
 void msd_CE6(unsigned char** strings, size_t n)
 {
 	uint16_t* restrict oracle = (uint16_t*)
-		malloc(n*sizeof(uint16_t));
+		big_malloc(n*sizeof(uint16_t));
 	unsigned char** sorted = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 	msd_CE6(strings, n, 0, oracle, sorted);
-	free(oracle);
-	free(sorted);
+	big_free(oracle);
+	big_free(sorted);
 }
 ROUTINE_REGISTER_SINGLECORE(msd_CE6,
 	"CE6: oracle+loop fission+adaptive+16bit counter+prealloc+unroll")
@@ -481,12 +678,12 @@ in_order:
 void msd_CE7(unsigned char** strings, size_t n)
 {
 	uint16_t* restrict oracle = (uint16_t*)
-		malloc(n*sizeof(uint16_t));
+		big_malloc(n*sizeof(uint16_t));
 	unsigned char** sorted = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 	msd_CE7_(strings, n, 0, oracle, sorted);
-	free(oracle);
-	free(sorted);
+	big_free(oracle);
+	big_free(sorted);
 }
 ROUTINE_REGISTER_SINGLECORE(msd_CE7,
 	"CE7: oracle+loop fission+adaptive+16bit counter+prealloc+unroll+sortedness")
@@ -565,12 +762,12 @@ in_order:
 void msd_CE8(unsigned char** strings, size_t n)
 {
 	uint16_t* restrict oracle = (uint16_t*)
-		malloc(n*sizeof(uint16_t));
+		big_malloc(n*sizeof(uint16_t));
 	unsigned char** sorted = (unsigned char**)
-		malloc(n*sizeof(unsigned char*));
+		big_malloc(n*sizeof(unsigned char*));
 	msd_CE8_(strings, n, 0, oracle, sorted);
-	free(oracle);
-	free(sorted);
+	big_free(oracle);
+	big_free(sorted);
 }
 ROUTINE_REGISTER_SINGLECORE(msd_CE8,
 	"CE8: oracle+loop fission+adaptive+16bit counter+prealloc+unroll+sortedness+prefetch")
@@ -31,6 +31,7 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/insertion_sort.h"
 #include "util/get_char.h"
 #include <cstddef>
@@ -45,22 +46,25 @@ struct distblock {
 	BucketType bucket;
 };
 
-template <typename BucketsizeType>
+// IndexT is no_index, or the side array of input indexes of msd_ci_perm() that
+// is moved along with the strings.
+template <typename BucketsizeType, typename ByteMap, typename IndexT=no_index>
 static void
-msd_ci(unsigned char** strings, size_t n, size_t depth)
+msd_ci(unsigned char** strings, size_t n, size_t depth, const ByteMap& bm,
+		IndexT idx=IndexT())
 {
 	if (n < 32) {
-		insertion_sort(strings, n, depth);
+		insertion_sort(strings, idx, n, depth, bm);
 		return;
 	}
 	BucketsizeType bucketsize[256] = {0};
 	unsigned char* restrict oracle =
-		(unsigned char*) malloc(n);
+		(unsigned char*) big_malloc(n);
 	for (size_t i=0; i < n; ++i)
-		oracle[i] = strings[i][depth];
+		oracle[i] = get_char<unsigned char>(strings[i], depth, bm);
 	for (size_t i=0; i < n; ++i)
 		++bucketsize[oracle[i]];
-	static ssize_t bucketindex[256];
+	ssize_t bucketindex[256];
 	bucketindex[0] = bucketsize[0];
 	BucketsizeType last_bucket_size = bucketsize[0];
 	for (unsigned i=1; i < 256; ++i) {
@@ -69,6 +73,7 @@ msd_ci(unsigned char** strings, size_t n, size_t depth)
 	}
 	for (size_t i=0; i < n-last_bucket_size; ) {
 		distblock<uint8_t> tmp = { strings[i], oracle[i] };
+		size_t tmp_idx = idx[i];
 		while (1) {
 			// Continue until the current bucket is completely in
 			// place
@@ -78,42 +83,51 @@ msd_ci(unsigned char** strings, size_t n, size_t depth)
 			// to overwrite
 			size_t backup_idx = bucketindex[tmp.bucket];
 			distblock<uint8_t> tmp2 = { strings[backup_idx], oracle[backup_idx] };
+			const size_t tmp2_idx = idx[backup_idx];
 			// overwrite everything, ie. move the string to correct
 			// position
 			strings[backup_idx] = tmp.ptr;
 			oracle[backup_idx]  = tmp.bucket;
+			idx[backup_idx]     = tmp_idx;
 			tmp = tmp2;
+			tmp_idx = tmp2_idx;
 		}
 		// Commit last pointer to place. We don't need to copy the
 		// oracle entry, it's not read after this.
 		strings[i] = tmp.ptr;
+		idx[i] = tmp_idx;
 		i += bucketsize[tmp.bucket];
 	}
-	free(oracle);
+	big_free(oracle);
 	size_t bsum = bucketsize[0];
 	for (size_t i=1; i < 256; ++i) {
 		if (bucketsize[i] == 0) continue;
-		msd_ci<BucketsizeType>(strings+bsum, bucketsize[i], depth+1);
+		msd_ci<BucketsizeType>(strings+bsum, bucketsize[i], depth+1,
+				bm, idx+bsum);
 		bsum += bucketsize[i];
 	}
 }
 
+// The bucket index array is only needed until the strings have been moved to
+// their buckets, so one array allocated by the caller serves every level of
+// the recursion.
+template <typename ByteMap, typename IndexT>
 static void
-msd_ci_adaptive(unsigned char** strings, size_t n, size_t depth)
+msd_ci_adaptive(unsigned char** strings, size_t n, size_t depth,
+		const ByteMap& bm, ssize_t* bucketindex, IndexT idx)
 {
 	if (n < 0x10000) {
-		msd_ci<uint16_t>(strings, n, depth);
+		msd_ci<uint16_t>(strings, n, depth, bm, idx);
 		return;
 	}
 	uint16_t* restrict oracle =
-		(uint16_t*) malloc(n*sizeof(uint16_t));
+		(uint16_t*) big_malloc(n*sizeof(uint16_t));
 	for (size_t i=0; i < n; ++i)
-		oracle[i] = get_char<uint16_t>(strings[i], depth);
+		oracle[i] = get_char<uint16_t>(strings[i], depth, bm);
 	size_t* restrict bucketsize = (size_t*)
 		calloc(0x10000, sizeof(size_t));
 	for (size_t i=0; i < n; ++i)
 		++bucketsize[oracle[i]];
-	static ssize_t bucketindex[0x10000];
 	bucketindex[0] = bucketsize[0];
 	size_t last_bucket_size = bucketsize[0];
 	for (unsigned i=1; i < 0x10000; ++i) {
@@ -122,6 +136,7 @@ msd_ci_adaptive(unsigned char** strings, size_t n, size_t depth)
 	}
 	for (size_t i=0; i < n-last_bucket_size; ) {
 		distblock<uint16_t> tmp = { strings[i], oracle[i] };
+		size_t tmp_idx = idx[i];
 		while (1) {
 			// Continue until the current bucket is completely in
 			// place
@@ -131,50 +146,103 @@ msd_ci_adaptive(unsigned char** strings, size_t n, size_t depth)
 			// to overwrite
 			size_t backup_idx = bucketindex[tmp.bucket];
 			distblock<uint16_t> tmp2 = { strings[backup_idx], oracle[backup_idx] };
+			const size_t tmp2_idx = idx[backup_idx];
 			// overwrite everything, ie. move the string to correct
 			// position
 			strings[backup_idx] = tmp.ptr;
 			oracle[backup_idx]  = tmp.bucket;
+			idx[backup_idx]     = tmp_idx;
 			tmp = tmp2;
+			tmp_idx = tmp2_idx;
 		}
 		// Commit last pointer to place. We don't need to copy the
 		// oracle entry, it's not read after this.
 		strings[i] = tmp.ptr;
+		idx[i] = tmp_idx;
 		i += bucketsize[tmp.bucket];
 	}
-	free(oracle);
+	big_free(oracle);
 	size_t bsum = bucketsize[0];
 	for (size_t i=1; i < 0x10000; ++i) {
 		if (bucketsize[i] == 0) continue;
 		if (i & 0xFF) msd_ci_adaptive(strings+bsum,
-				bucketsize[i], depth+2);
+				bucketsize[i], depth+2, bm, bucketindex,
+				idx+bsum);
 		bsum += bucketsize[i];
 	}
 	free(bucketsize);
 }
 
-void msd_ci(unsigned char** strings, size_t n)
+static void
+check_input_size(size_t n, const char* func)
 {
 	if (n > size_t(std::numeric_limits<ssize_t>::max())) {
 		std::cerr << "ERROR: "
-			<< __func__ << "(): too many input strings: "
+			<< func << "(): too many input strings: "
 			<< n << " > " << std::numeric_limits<ssize_t>::max()
 			<< std::endl;
 		abort();
 	}
-	msd_ci<size_t>(strings, n, 0);
 }
-void msd_ci_adaptive(unsigned char** strings, size_t n)
+
+template <typename ByteMap, typename IndexT=no_index>
+static void
+msd_ci_adaptive(unsigned char** strings, size_t n, const ByteMap& bm,
+		IndexT idx=IndexT())
 {
-	if (n > size_t(std::numeric_limits<ssize_t>::max())) {
-		std::cerr << "ERROR: "
-			<< __func__ << "(): too many input strings: "
-			<< n << " > " << std::numeric_limits<ssize_t>::max()
-			<< std::endl;
+	if (n < 0x10000) {
+		msd_ci<uint16_t>(strings, n, 0, bm, idx);
+		return;
+	}
+	ssize_t* bucketindex = (ssize_t*) malloc(0x10000*sizeof(ssize_t));
+	if (not bucketindex) {
+		std::cerr << "ERROR: msd_ci_adaptive(): unable to allocate "
+			"memory for the bucket index" << std::endl;
 		abort();
 	}
-	msd_ci_adaptive(strings, n, 0);
+	msd_ci_adaptive(strings, n, 0, bm, bucketindex, idx);
+	free(bucketindex);
+}
+
+void msd_ci(unsigned char** strings, size_t n)
+{
+	check_input_size(n, __func__);
+	msd_ci<size_t>(strings, n, 0, identity_map());
+}
+void msd_ci_adaptive(unsigned char** strings, size_t n)
+{
+	check_input_size(n, __func__);
+	msd_ci_adaptive(strings, n, identity_map());
+}
+void msd_ci_collate(unsigned char** strings, size_t n,
+		const unsigned char* table)
+{
+	check_input_size(n, __func__);
+	msd_ci<size_t>(strings, n, 0, table_map{table});
+}
+void msd_ci_adaptive_collate(unsigned char** strings, size_t n,
+		const unsigned char* table)
+{
+	check_input_size(n, __func__);
+	msd_ci_adaptive(strings, n, table_map{table});
+}
+
+void msd_ci_perm(unsigned char** strings, size_t n, size_t* perm)
+{
+	check_input_size(n, __func__);
+	identity_index(perm, n);
+	msd_ci<size_t>(strings, n, 0, identity_map(), perm);
+}
+void msd_ci_adaptive_perm(unsigned char** strings, size_t n, size_t* perm)
+{
+	check_input_size(n, __func__);
+	identity_index(perm, n);
+	msd_ci_adaptive(strings, n, identity_map(), perm);
 }
 
-ROUTINE_REGISTER_SINGLECORE(msd_ci, "msd_CI")
-ROUTINE_REGISTER_SINGLECORE(msd_ci_adaptive, "msd_CI: adaptive")
+ROUTINE_REGISTER_FULL(msd_ci, "msd_CI", 0,
+		ROUTINE_COLLATE(msd_ci_collate),
+		ROUTINE_PERM(msd_ci_perm))
+ROUTINE_REGISTER_FULL(msd_ci_adaptive, "msd_CI: adaptive", 0,
+		ROUTINE_COLLATE(msd_ci_adaptive_collate),
+		ROUTINE_PERM(msd_ci_adaptive_perm))
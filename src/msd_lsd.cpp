@@ -25,6 +25,7 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -92,7 +93,7 @@ msd_lsd(Cacheblock<CachedChars>* cache, size_t N, size_t depth)
 		for (size_t i=0; i < N; ++i)
 			++bucketsize[cache[i].chars[byte]];
 		Cacheblock<CachedChars>* sorted = (Cacheblock<CachedChars>*)
-			malloc(N*sizeof(Cacheblock<CachedChars>));
+			big_malloc(N*sizeof(Cacheblock<CachedChars>));
 		size_t bucketindex[256];
 		bucketindex[0] = 0;
 		for (size_t i=1; i < 256; ++i)
@@ -102,7 +103,7 @@ msd_lsd(Cacheblock<CachedChars>* cache, size_t N, size_t depth)
 					cache+i,
 					sizeof(Cacheblock<CachedChars>));
 		memcpy(cache, sorted, N*sizeof(Cacheblock<CachedChars>));
-		free(sorted);
+		big_free(sorted);
 	}
 	size_t start=0, cnt=1;
 	for (size_t i=0; i < N-1; ++i) {
@@ -141,7 +142,7 @@ msd_lsd_adaptive(Cacheblock<CachedChars>* cache, size_t N, size_t depth)
 			++bucketsize[bucket];
 		}
 		Cacheblock<CachedChars>* sorted = (Cacheblock<CachedChars>*)
-			malloc(N*sizeof(Cacheblock<CachedChars>));
+			big_malloc(N*sizeof(Cacheblock<CachedChars>));
 		static size_t bucketindex[0x10000];
 		bucketindex[0] = 0;
 		for (size_t i=1; i < 0x10000; ++i)
@@ -154,7 +155,7 @@ msd_lsd_adaptive(Cacheblock<CachedChars>* cache, size_t N, size_t depth)
 					sizeof(Cacheblock<CachedChars>));
 		}
 		memcpy(cache, sorted, N*sizeof(Cacheblock<CachedChars>));
-		free(sorted);
+		big_free(sorted);
 	}
 	size_t start=0, cnt=1;
 	for (size_t i=0; i < N-1; ++i) {
@@ -179,12 +180,12 @@ static void
 msd_A_lsd(unsigned char** strings, size_t N)
 {
 	Cacheblock<CachedChars>* cache = static_cast<Cacheblock<CachedChars>*>(
-			malloc(N*sizeof(Cacheblock<CachedChars>)));
+			big_malloc(N*sizeof(Cacheblock<CachedChars>)));
 	for (size_t i=0; i < N; ++i) cache[i].ptr = strings[i];
 	fill_cache(cache, N, 0);
 	msd_lsd(cache, N, 0);
 	for (size_t i=0; i < N; ++i) strings[i] = cache[i].ptr;
-	free(cache);
+	big_free(cache);
 }
 
 template <unsigned CachedChars>
@@ -192,12 +193,12 @@ static void
 msd_A_lsd_adaptive(unsigned char** strings, size_t N)
 {
 	Cacheblock<CachedChars>* cache = static_cast<Cacheblock<CachedChars>*>(
-			malloc(N*sizeof(Cacheblock<CachedChars>)));
+			big_malloc(N*sizeof(Cacheblock<CachedChars>)));
 	for (size_t i=0; i < N; ++i) cache[i].ptr = strings[i];
 	fill_cache(cache, N, 0);
 	msd_lsd_adaptive(cache, N, 0);
 	for (size_t i=0; i < N; ++i) strings[i] = cache[i].ptr;
-	free(cache);
+	big_free(cache);
 }
 
 void msd_A_lsd4(unsigned char** strings, size_t N) {msd_A_lsd<4>(strings, N); }
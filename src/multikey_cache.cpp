@@ -30,7 +30,9 @@
  */
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/median.h"
+#include "util/get_char.h"
 #include <algorithm>
 
 template <unsigned CachedChars>
@@ -67,19 +69,21 @@ struct Cmp
 };
 
 // Insertion sort, ignores any cached characters.
-template <unsigned CachedChars>
+template <typename ByteMap, unsigned CachedChars>
 static inline void
-insertion_sort(Cacheblock<CachedChars>* cache, int n, size_t depth)
+insertion_sort(Cacheblock<CachedChars>* cache, int n, size_t depth,
+		const ByteMap& bm)
 {
 	Cacheblock<CachedChars> *pi, *pj;
 	unsigned char *s, *t;
 	for (pi = cache + 1; --n > 0; ++pi) {
 		unsigned char* tmp = pi->ptr;
 		for (pj = pi; pj > cache; --pj) {
-			for (s=(pj-1)->ptr+depth, t=tmp+depth; *s==*t && *s!=0;
-					++s, ++t)
+			for (s=(pj-1)->ptr+depth, t=tmp+depth;
+			     bm.map(*s)==bm.map(*t) && *s!=0;
+			     ++s, ++t)
 				;
-			if (*s <= *t)
+			if (bm.map(*s) <= bm.map(*t))
 				break;
 			pj->ptr = (pj-1)->ptr;
 		}
@@ -106,16 +110,17 @@ inssort_cache_block(Cacheblock<CachedChars>* cache, int n)
 
 // Fill the cache, but swap the characters in such order that we may load them
 // as integers in little endian machines.
-template <unsigned CachedChars>
+template <typename ByteMap, unsigned CachedChars>
 static inline void
-fill_cache(Cacheblock<CachedChars>* cache, size_t N, size_t depth)
+fill_cache(Cacheblock<CachedChars>* cache, size_t N, size_t depth,
+		const ByteMap& bm)
 {
 	for (size_t i=0; i < N; ++i) {
 		unsigned si=0, ci=CachedChars-1; //string index, cache index
 		typename Cacheblock<CachedChars>::CacheType ch = 0;
 		while (ci < CachedChars) {
 			const typename Cacheblock<CachedChars>::CacheType c =
-				cache[i].ptr[depth+si];
+				bm.map(cache[i].ptr[depth+si]);
 			ch |= (c << (ci*8));
 			--ci; ++si;
 			if (is_end(c)) break;
@@ -124,14 +129,15 @@ fill_cache(Cacheblock<CachedChars>* cache, size_t N, size_t depth)
 	}
 }
 
-template <unsigned CachedChars, bool CacheDirty>
+template <typename ByteMap, unsigned CachedChars, bool CacheDirty>
 static void
-multikey_cache(Cacheblock<CachedChars>* cache, size_t N, size_t depth)
+multikey_cache(Cacheblock<CachedChars>* cache, size_t N, size_t depth,
+		const ByteMap& bm)
 {
 	if (N < 32) {
 		if (N==0) return;
 		if (CacheDirty) {
-			insertion_sort(cache, N, depth);
+			insertion_sort(cache, N, depth, bm);
 			return;
 		}
 		inssort_cache_block(cache, N);
@@ -143,16 +149,17 @@ multikey_cache(Cacheblock<CachedChars>* cache, size_t N, size_t depth)
 			}
 			if (cnt > 1 and cache[start].cached_bytes & 0xFF)
 				insertion_sort(cache+start, cnt,
-						depth+CachedChars);
+						depth+CachedChars, bm);
 			cnt = 1;
 			start = i+1;
 		}
 		if (cnt > 1 and cache[start].cached_bytes & 0xFF)
-			insertion_sort(cache+start, cnt, depth+CachedChars);
+			insertion_sort(cache+start, cnt,
+					depth+CachedChars, bm);
 		return;
 	}
 	if (CacheDirty) {
-		fill_cache(cache, N, depth);
+		fill_cache(cache, N, depth, bm);
 	}
 	// Move pivot to first position to avoid wrapping the unsigned values
 	// we are using in the main loop from zero to max.
@@ -204,35 +211,53 @@ multikey_cache(Cacheblock<CachedChars>* cache, size_t N, size_t depth)
 	const size_t size2 = std::min(num_eq_end, num_gt);
 	std::swap_ranges(cache+first, cache+first+size2, cache+N-size2);
 	// Now recurse.
-	multikey_cache<CachedChars, false>(cache, num_lt, depth);
-	multikey_cache<CachedChars, false>(cache+num_lt+num_eq, num_gt, depth);
+	multikey_cache<ByteMap, CachedChars, false>(cache, num_lt, depth, bm);
+	multikey_cache<ByteMap, CachedChars, false>(cache+num_lt+num_eq, num_gt,
+			depth, bm);
 	if (partval.cached_bytes & 0xFF)
-		multikey_cache<CachedChars, true>(
-			cache+num_lt, num_eq, depth+CachedChars);
+		multikey_cache<ByteMap, CachedChars, true>(
+			cache+num_lt, num_eq, depth+CachedChars, bm);
 }
 
-template <unsigned CachedChars>
+template <typename ByteMap, unsigned CachedChars>
 static inline void
-multikey_cache(unsigned char** strings, size_t n, size_t depth)
+multikey_cache(unsigned char** strings, size_t n, size_t depth,
+		const ByteMap& bm)
 {
 	Cacheblock<CachedChars>* cache =
 		static_cast<Cacheblock<CachedChars>*>(
-			malloc(n*sizeof(Cacheblock<CachedChars>)));
+			big_malloc(n*sizeof(Cacheblock<CachedChars>)));
 	for (size_t i=0; i < n; ++i) {
 		cache[i].ptr = strings[i];
 	}
-	multikey_cache<CachedChars, true>(cache, n, depth);
+	multikey_cache<ByteMap, CachedChars, true>(cache, n, depth, bm);
 	for (size_t i=0; i < n; ++i) {
 		strings[i] = cache[i].ptr;
 	}
-	free(cache);
+	big_free(cache);
 }
 
 void multikey_cache4(unsigned char** strings, size_t n)
-{ multikey_cache<4>(strings, n, 0); }
+{ multikey_cache<identity_map, 4>(strings, n, 0, identity_map()); }
 
 void multikey_cache8(unsigned char** strings, size_t n)
-{ multikey_cache<8>(strings, n, 0); }
+{ multikey_cache<identity_map, 8>(strings, n, 0, identity_map()); }
+
+void multikey_cache4_collate(unsigned char** strings, size_t n,
+		const unsigned char* table)
+{
+	multikey_cache<table_map, 4>(strings, n, 0, table_map{table});
+}
+
+void multikey_cache8_collate(unsigned char** strings, size_t n,
+		const unsigned char* table)
+{
+	multikey_cache<table_map, 8>(strings, n, 0, table_map{table});
+}
 
-ROUTINE_REGISTER_SINGLECORE(multikey_cache4, "multikey_cache with 4byte cache")
-ROUTINE_REGISTER_SINGLECORE(multikey_cache8, "multikey_cache with 8byte cache")
+ROUTINE_REGISTER_FULL(multikey_cache4,
+		"multikey_cache with 4byte cache", 0,
+		ROUTINE_COLLATE(multikey_cache4_collate))
+ROUTINE_REGISTER_FULL(multikey_cache8,
+		"multikey_cache with 8byte cache", 0,
+		ROUTINE_COLLATE(multikey_cache8_collate))
@@ -53,6 +53,7 @@
 #ifdef __SSE2__
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/insertion_sort.h"
 #include "util/get_char.h"
 #include "util/median.h"
@@ -402,7 +403,7 @@ multikey_multipivot(unsigned char** strings, size_t n, size_t depth)
 	for (unsigned i=0; i < Pivots; ++i) {
 		pivots[i] = sample_array[step*i];
 	}
-	uint8_t* restrict oracle = static_cast<uint8_t*>(_mm_malloc(n, 16));
+	uint8_t* restrict oracle = static_cast<uint8_t*>(big_malloc(n));
 	fill_oracle<Pivots>(strings, n, oracle, pivots, depth);
 	std::array<size_t, total_buckets(Pivots)> bucketsize;
 	bucketsize.fill(0);
@@ -422,7 +423,7 @@ multikey_multipivot(unsigned char** strings, size_t n, size_t depth)
 		++bucketsize[oracle[i]];
 	if (not sorted) {
 		unsigned char** sorted = (unsigned char**)
-			malloc(n*sizeof(unsigned char*));
+			big_malloc(n*sizeof(unsigned char*));
 		static std::array<size_t, total_buckets(Pivots)> bucketindex;
 		bucketindex[0] = 0;
 		for (unsigned i=1; i < total_buckets(Pivots); ++i)
@@ -430,9 +431,9 @@ multikey_multipivot(unsigned char** strings, size_t n, size_t depth)
 		for (size_t i=0; i < n; ++i)
 			sorted[bucketindex[oracle[i]]++] = strings[i];
 		memcpy(strings, sorted, n*sizeof(unsigned char*));
-		free(sorted);
+		big_free(sorted);
 	}
-	_mm_free(oracle);
+	big_free(oracle);
 	size_t b=0;
 	size_t bsum = bucketsize[0];
 	if (bsum) multikey_multipivot<CharT, Pivots>(strings, bsum, depth);
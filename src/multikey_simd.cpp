@@ -37,6 +37,7 @@
 #ifdef __SSE2__
 
 #include "routine.h"
+#include "util/bigalloc.h"
 #include "util/insertion_sort.h"
 #include "util/get_char.h"
 #include "util/median.h"
@@ -46,12 +47,20 @@
 #include <array>
 #include <xmmintrin.h>
 
-template <bool Prefetch>
+static inline void
+prefetch(unsigned char* str, size_t depth)
+{ __builtin_prefetch(str+depth); }
+
+static inline void
+prefetch(const bstring& str, size_t depth)
+{ __builtin_prefetch(str.ptr+depth); }
+
+template <bool Prefetch, typename StringT, typename Access = direct_access>
 static void
 calculate_bucketsizes_sse(
-		unsigned char** strings, size_t n,
+		StringT* strings, size_t n,
 		uint8_t* restrict oracle,
-		uint8_t pivot, size_t depth)
+		uint8_t pivot, size_t depth, Access acc = Access())
 {
 	assert(n % 16 == 0);
 	static const uint8_t _Constants[] __attribute__((aligned(16))) = {
@@ -79,9 +88,9 @@ calculate_bucketsizes_sse(
 		unsigned char data00[16] __attribute__ ((aligned (16)));
 		if (Prefetch)
 			for (unsigned j=0; j < 16; ++j)
-				__builtin_prefetch(&strings[i+j+16][depth]);
+				prefetch(acc(strings[i+j+16]), depth);
 		for (unsigned j=0; j < 16; ++j)
-			data00[j] = strings[i+j][depth];
+			data00[j] = get_char<unsigned char>(acc(strings[i+j]), depth);
 		__m128i d00 = _mm_load_si128(
 				reinterpret_cast<__m128i*>(data00));
 		d00 = _mm_add_epi8(d00, FlipBit);
@@ -94,14 +103,14 @@ calculate_bucketsizes_sse(
 	}
 }
 
-template <bool Prefetch>
+template <bool Prefetch, typename StringT, typename Access = direct_access>
 static void
 calculate_bucketsizes_sse(
-		unsigned char** strings,
+		StringT* strings,
 		size_t n,
 		uint8_t* restrict oracle,
 		uint16_t pivot,
-		size_t depth)
+		size_t depth, Access acc = Access())
 {
 	typedef uint16_t CharT;
 	assert(n % 16 == 0);
@@ -125,28 +134,28 @@ calculate_bucketsizes_sse(
 	for (size_t i=0; i < n; i += 16) {
 		if (Prefetch)
 			for (unsigned j=0; j < 16; ++j)
-				__builtin_prefetch(&strings[i+j+16][depth]);
+				prefetch(acc(strings[i+j+16]), depth);
 		const CharT data00[] __attribute__ ((aligned (16)))
 			= {
-				get_char<CharT>(strings[i+0 ], depth),
-				get_char<CharT>(strings[i+2 ], depth),
-				get_char<CharT>(strings[i+4 ], depth),
-				get_char<CharT>(strings[i+6 ], depth),
-				get_char<CharT>(strings[i+8 ], depth),
-				get_char<CharT>(strings[i+10], depth),
-				get_char<CharT>(strings[i+12], depth),
-				get_char<CharT>(strings[i+14], depth)
+				get_char<CharT>(acc(strings[i+0 ]), depth),
+				get_char<CharT>(acc(strings[i+2 ]), depth),
+				get_char<CharT>(acc(strings[i+4 ]), depth),
+				get_char<CharT>(acc(strings[i+6 ]), depth),
+				get_char<CharT>(acc(strings[i+8 ]), depth),
+				get_char<CharT>(acc(strings[i+10]), depth),
+				get_char<CharT>(acc(strings[i+12]), depth),
+				get_char<CharT>(acc(strings[i+14]), depth)
 			};
 		const CharT data01[] __attribute__ ((aligned (16)))
 			= {
-				get_char<CharT>(strings[i+1 ], depth),
-				get_char<CharT>(strings[i+3 ], depth),
-				get_char<CharT>(strings[i+5 ], depth),
-				get_char<CharT>(strings[i+7 ], depth),
-				get_char<CharT>(strings[i+9 ], depth),
-				get_char<CharT>(strings[i+11], depth),
-				get_char<CharT>(strings[i+13], depth),
-				get_char<CharT>(strings[i+15], depth)
+				get_char<CharT>(acc(strings[i+1 ]), depth),
+				get_char<CharT>(acc(strings[i+3 ]), depth),
+				get_char<CharT>(acc(strings[i+5 ]), depth),
+				get_char<CharT>(acc(strings[i+7 ]), depth),
+				get_char<CharT>(acc(strings[i+9 ]), depth),
+				get_char<CharT>(acc(strings[i+11]), depth),
+				get_char<CharT>(acc(strings[i+13]), depth),
+				get_char<CharT>(acc(strings[i+15]), depth)
 			};
 		__m128i d00 = _mm_load_si128(
 				reinterpret_cast<const __m128i*>(data00));
@@ -171,14 +180,14 @@ calculate_bucketsizes_sse(
 	}
 }
 
-template <bool Prefetch>
+template <bool Prefetch, typename StringT, typename Access = direct_access>
 static void
 calculate_bucketsizes_sse(
-		unsigned char** strings,
+		StringT* strings,
 		size_t n,
 		uint8_t* restrict oracle,
 		uint32_t pivot,
-		size_t depth)
+		size_t depth, Access acc = Access())
 {
 	typedef uint32_t CharT;
 	assert(n % 16 == 0);
@@ -202,34 +211,34 @@ calculate_bucketsizes_sse(
 	for (size_t i=0; i < n; i += 16) {
 		if (Prefetch)
 			for (unsigned j=0; j < 16; ++j)
-				__builtin_prefetch(&strings[i+j+16][depth]);
+				prefetch(acc(strings[i+j+16]), depth);
 		const CharT data00[] __attribute__ ((aligned (16)))
 			= {
-				get_char<CharT>(strings[i+0 ], depth),
-				get_char<CharT>(strings[i+4 ], depth),
-				get_char<CharT>(strings[i+8 ], depth),
-				get_char<CharT>(strings[i+12], depth),
+				get_char<CharT>(acc(strings[i+0 ]), depth),
+				get_char<CharT>(acc(strings[i+4 ]), depth),
+				get_char<CharT>(acc(strings[i+8 ]), depth),
+				get_char<CharT>(acc(strings[i+12]), depth),
 			};
 		const CharT data01[] __attribute__ ((aligned (16)))
 			= {
-				get_char<CharT>(strings[i+1 ], depth),
-				get_char<CharT>(strings[i+5 ], depth),
-				get_char<CharT>(strings[i+9 ], depth),
-				get_char<CharT>(strings[i+13], depth),
+				get_char<CharT>(acc(strings[i+1 ]), depth),
+				get_char<CharT>(acc(strings[i+5 ]), depth),
+				get_char<CharT>(acc(strings[i+9 ]), depth),
+				get_char<CharT>(acc(strings[i+13]), depth),
 			};
 		const CharT data02[] __attribute__ ((aligned (16)))
 			= {
-				get_char<CharT>(strings[i+2 ], depth),
-				get_char<CharT>(strings[i+6 ], depth),
-				get_char<CharT>(strings[i+10], depth),
-				get_char<CharT>(strings[i+14], depth)
+				get_char<CharT>(acc(strings[i+2 ]), depth),
+				get_char<CharT>(acc(strings[i+6 ]), depth),
+				get_char<CharT>(acc(strings[i+10]), depth),
+				get_char<CharT>(acc(strings[i+14]), depth)
 			};
 		const CharT data03[] __attribute__ ((aligned (16)))
 			= {
-				get_char<CharT>(strings[i+3 ], depth),
-				get_char<CharT>(strings[i+7 ], depth),
-				get_char<CharT>(strings[i+11], depth),
-				get_char<CharT>(strings[i+15], depth)
+				get_char<CharT>(acc(strings[i+3 ]), depth),
+				get_char<CharT>(acc(strings[i+7 ]), depth),
+				get_char<CharT>(acc(strings[i+11]), depth),
+				get_char<CharT>(acc(strings[i+15]), depth)
 			};
 		__m128i d00 = _mm_load_si128(
 				reinterpret_cast<const __m128i*>(data00));
@@ -271,30 +280,32 @@ get_bucket(CharT c, CharT pivot)
         return ((c > pivot) << 1) | (c == pivot);
 }
 
-template <typename CharT>
-static void
-multikey_simd(unsigned char** strings, size_t N, size_t depth)
+// The partitioning step of multikey_simd() and its variants: picks the pivot
+// character at `depth', and moves the strings to the order of the smaller,
+// equal and larger partitions, whose sizes are stored in bucketsize. Returns
+// the pivot. The variants differ only in how they recurse into the
+// partitions.
+template <typename CharT, typename StringT, typename Access>
+static CharT
+multikey_simd_partition(StringT* strings, size_t N, size_t depth,
+		std::array<size_t, 3>& bucketsize, Access acc)
 {
-	if (N < 32) {
-		insertion_sort(strings, N, depth);
-		return;
-	}
-	CharT partval = pseudo_median<CharT>(strings, N, depth);
+	CharT partval = pseudo_median<CharT>(strings, N, depth, acc);
 	uint8_t* const restrict oracle =
-		static_cast<uint8_t*>(_mm_malloc(N, 16));
-	std::array<size_t, 3> bucketsize;
+		static_cast<uint8_t*>(big_malloc(N));
 	bucketsize.fill(0);
 	size_t i=N-N%16;
-	calculate_bucketsizes_sse<false>(strings, i, oracle, partval, depth);
+	calculate_bucketsizes_sse<false>(strings, i, oracle, partval, depth,
+			acc);
 	for (; i < N; ++i)
 		oracle[i] = get_bucket(
-				get_char<CharT>(strings[i], depth),
+				get_char<CharT>(acc(strings[i]), depth),
 				partval);
 	for (i=0; i < N; ++i)
 		++bucketsize[oracle[i]];
 	assert(bucketsize[0] + bucketsize[1] + bucketsize[2] == N);
-	unsigned char** sorted =
-		static_cast<unsigned char**>(malloc(N*sizeof(unsigned char*)));
+	StringT* sorted =
+		static_cast<StringT*>(big_malloc(N*sizeof(StringT)));
 	size_t bucketindex[3];
 	bucketindex[0] = 0;
 	bucketindex[1] = bucketsize[0];
@@ -303,14 +314,123 @@ multikey_simd(unsigned char** strings, size_t N, size_t depth)
 		sorted[bucketindex[oracle[i]]++] = strings[i];
 	}
 	std::copy(sorted, sorted+N, strings);
-	free(sorted);
-	_mm_free(oracle);
-	multikey_simd<CharT>(strings, bucketsize[0], depth);
+	big_free(sorted);
+	big_free(oracle);
+	return partval;
+}
+
+// Only the first K positions are sorted: the partitions that start at or
+// after K are left unsorted.
+template <typename CharT, typename StringT, typename Access = direct_access>
+static void
+multikey_simd(StringT* strings, size_t N, size_t depth, size_t K=size_t(-1),
+		Access acc=Access())
+{
+	if (K == 0) return;
+	if (N < 32) {
+		insertion_sort(strings, N, depth, acc);
+		return;
+	}
+	std::array<size_t, 3> bucketsize;
+	const CharT partval = multikey_simd_partition<CharT>(strings, N, depth,
+			bucketsize, acc);
+	multikey_simd<CharT>(strings, bucketsize[0], depth, K, acc);
+	if (K <= bucketsize[0]) return;
+	K -= bucketsize[0];
 	if (not is_end(partval))
-		multikey_simd<CharT>(strings+bucketsize[0],
-				bucketsize[1], depth+sizeof(CharT));
+		multikey_simd<CharT>(strings+bucketsize[0], bucketsize[1],
+				depth+char_step<CharT, StringT>::value, K, acc);
+	if (K <= bucketsize[1]) return;
+	K -= bucketsize[1];
 	multikey_simd<CharT>(strings+bucketsize[0]+bucketsize[1],
-			bucketsize[2], depth);
+			bucketsize[2], depth, K, acc);
+}
+
+// Moves the distinct strings of a partition, and their counts, down to
+// position m. Returns the new m.
+static inline size_t
+append_distinct(unsigned char** strings, size_t* counts, size_t m,
+		size_t begin, size_t distinct)
+{
+	memmove(strings+m, strings+begin, distinct*sizeof(unsigned char*));
+	if (counts)
+		memmove(counts+m, counts+begin, distinct*sizeof(size_t));
+	return m + distinct;
+}
+
+// Same as multikey_simd(), but collapses the equal strings while sorting. The
+// equal partition of a pivot that ends the strings holds only equal strings.
+// Returns the number of distinct strings.
+template <typename CharT>
+static size_t
+multikey_simd_unique(unsigned char** strings, size_t N, size_t depth,
+		size_t* counts)
+{
+	if (N < 32) {
+		insertion_sort(strings, N, depth);
+		return collapse_sorted(strings, N, depth, counts);
+	}
+	std::array<size_t, 3> bucketsize;
+	const CharT partval = multikey_simd_partition<CharT>(strings, N, depth,
+			bucketsize, direct_access());
+	size_t m = multikey_simd_unique<CharT>(strings, bucketsize[0], depth,
+			counts);
+	const size_t eq = bucketsize[0];
+	if (is_end(partval)) {
+		strings[m] = strings[eq];
+		if (counts) counts[m] = bucketsize[1];
+		++m;
+	} else {
+		m = append_distinct(strings, counts, m, eq,
+				multikey_simd_unique<CharT>(strings+eq,
+					bucketsize[1],
+					depth+char_step<CharT,
+						unsigned char*>::value,
+					counts ? counts+eq : 0));
+	}
+	const size_t gt = bucketsize[0] + bucketsize[1];
+	return append_distinct(strings, counts, m, gt,
+			multikey_simd_unique<CharT>(strings+gt, bucketsize[2],
+				depth, counts ? counts+gt : 0));
+}
+
+// Same as multikey_simd(), and stores lcp[i] = lcp(strings[i-1], strings[i])
+// for 0 < i < N. Only the first string of each partition needs to be compared
+// with its predecessor, from `depth' onwards.
+template <typename CharT>
+static void
+multikey_simd_lcp(unsigned char** strings, size_t N, size_t depth, size_t* lcp)
+{
+	if (N < 32) {
+		insertion_sort(strings, N, depth);
+		lcp_sorted(strings, N, depth, lcp);
+		return;
+	}
+	std::array<size_t, 3> bucketsize;
+	const CharT partval = multikey_simd_partition<CharT>(strings, N, depth,
+			bucketsize, direct_access());
+	multikey_simd_lcp<CharT>(strings, bucketsize[0], depth, lcp);
+	const size_t eq = bucketsize[0];
+	if (bucketsize[1]) {
+		if (is_end(partval)) {
+			const size_t len = lcp_from(strings[eq], strings[eq],
+					depth);
+			for (size_t i=1; i < bucketsize[1]; ++i)
+				lcp[eq+i] = len;
+		} else {
+			multikey_simd_lcp<CharT>(strings+eq, bucketsize[1],
+					depth+char_step<CharT,
+						unsigned char*>::value,
+					lcp+eq);
+		}
+		if (eq) lcp[eq] = lcp_from(strings[eq-1], strings[eq], depth);
+	}
+	const size_t gt = bucketsize[0] + bucketsize[1];
+	if (bucketsize[2]) {
+		multikey_simd_lcp<CharT>(strings+gt, bucketsize[2], depth,
+				lcp+gt);
+		if (gt) lcp[gt] = lcp_from(strings[gt-1], strings[gt], depth);
+	}
 }
 
 void multikey_simd1(unsigned char** strings, size_t n)
@@ -322,21 +442,89 @@ void multikey_simd2(unsigned char** strings, size_t n)
 void multikey_simd4(unsigned char** strings, size_t n)
 { multikey_simd<uint32_t>(strings, n, 0); }
 
-ROUTINE_REGISTER_SINGLECORE(multikey_simd1,
-		"multikey_simd with 1byte alphabet")
-ROUTINE_REGISTER_SINGLECORE(multikey_simd2,
-		"multikey_simd with 2byte alphabet")
-ROUTINE_REGISTER_SINGLECORE(multikey_simd4,
-		"multikey_simd with 4byte alphabet")
+void multikey_simd2_binary(bstring* strings, size_t n)
+{ multikey_simd<uint16_t>(strings, n, 0); }
+
+void multikey_simd4_binary(bstring* strings, size_t n)
+{ multikey_simd<uint32_t>(strings, n, 0); }
+
+void multikey_simd1_top(unsigned char** strings, size_t n, size_t k)
+{ multikey_simd<unsigned char>(strings, n, 0, k); }
+
+void multikey_simd2_top(unsigned char** strings, size_t n, size_t k)
+{ multikey_simd<uint16_t>(strings, n, 0, k); }
+
+void multikey_simd4_top(unsigned char** strings, size_t n, size_t k)
+{ multikey_simd<uint32_t>(strings, n, 0, k); }
+
+size_t multikey_simd1_unique(unsigned char** strings, size_t n, size_t* counts)
+{ return multikey_simd_unique<unsigned char>(strings, n, 0, counts); }
+
+size_t multikey_simd2_unique(unsigned char** strings, size_t n, size_t* counts)
+{ return multikey_simd_unique<uint16_t>(strings, n, 0, counts); }
+
+size_t multikey_simd4_unique(unsigned char** strings, size_t n, size_t* counts)
+{ return multikey_simd_unique<uint32_t>(strings, n, 0, counts); }
+
+void multikey_simd1_lcp(unsigned char** strings, size_t n, size_t* lcp)
+{ if (n) lcp[0] = 0; multikey_simd_lcp<unsigned char>(strings, n, 0, lcp); }
+
+void multikey_simd2_lcp(unsigned char** strings, size_t n, size_t* lcp)
+{ if (n) lcp[0] = 0; multikey_simd_lcp<uint16_t>(strings, n, 0, lcp); }
+
+void multikey_simd4_lcp(unsigned char** strings, size_t n, size_t* lcp)
+{ if (n) lcp[0] = 0; multikey_simd_lcp<uint32_t>(strings, n, 0, lcp); }
+
+void multikey_simd1_offset(uint32_t* strings, size_t n, unsigned char* text)
+{
+	multikey_simd<unsigned char>(
+			reinterpret_cast<text_offset*>(strings), n, 0,
+			size_t(-1), offset_access{text});
+}
+
+void multikey_simd2_offset(uint32_t* strings, size_t n, unsigned char* text)
+{
+	multikey_simd<uint16_t>(
+			reinterpret_cast<text_offset*>(strings), n, 0,
+			size_t(-1), offset_access{text});
+}
+
+void multikey_simd4_offset(uint32_t* strings, size_t n, unsigned char* text)
+{
+	multikey_simd<uint32_t>(
+			reinterpret_cast<text_offset*>(strings), n, 0,
+			size_t(-1), offset_access{text});
+}
+
+ROUTINE_REGISTER_FULL(multikey_simd1,
+		"multikey_simd with 1byte alphabet", 0,
+		ROUTINE_OFFSET(multikey_simd1_offset),
+		ROUTINE_TOP(multikey_simd1_top),
+		ROUTINE_UNIQUE(multikey_simd1_unique),
+		ROUTINE_LCP(multikey_simd1_lcp))
+ROUTINE_REGISTER_FULL(multikey_simd2,
+		"multikey_simd with 2byte alphabet", 0,
+		ROUTINE_BINARY(multikey_simd2_binary),
+		ROUTINE_OFFSET(multikey_simd2_offset),
+		ROUTINE_TOP(multikey_simd2_top),
+		ROUTINE_UNIQUE(multikey_simd2_unique),
+		ROUTINE_LCP(multikey_simd2_lcp))
+ROUTINE_REGISTER_FULL(multikey_simd4,
+		"multikey_simd with 4byte alphabet", 0,
+		ROUTINE_BINARY(multikey_simd4_binary),
+		ROUTINE_OFFSET(multikey_simd4_offset),
+		ROUTINE_TOP(multikey_simd4_top),
+		ROUTINE_UNIQUE(multikey_simd4_unique),
+		ROUTINE_LCP(multikey_simd4_lcp))
 
 /*
  * Same as multikey_simd(), but "sorted" and "oracle" memory is preallocated,
  * and prefetching is done to try to speed up string accesses.
  */
-template <typename CharT>
+template <typename CharT, typename StringT>
 static void
-multikey_simd_b(unsigned char** strings, size_t N, size_t depth,
-		unsigned char** restrict sorted, uint8_t* restrict oracle)
+multikey_simd_b(StringT* strings, size_t N, size_t depth,
+		StringT* restrict sorted, uint8_t* restrict oracle)
 {
 	if (N < 32) {
 		insertion_sort(strings, N, depth);
@@ -369,7 +557,8 @@ multikey_simd_b(unsigned char** strings, size_t N, size_t depth,
 			sorted, oracle);
 	if (not is_end(partval))
 		multikey_simd_b<CharT>(strings+bucketsize[0],
-				bucketsize[1], depth+sizeof(CharT),
+				bucketsize[1],
+				depth+char_step<CharT, StringT>::value,
 				sorted, oracle);
 	multikey_simd_b<CharT>(strings+bucketsize[0]+bucketsize[1],
 			bucketsize[2], depth, sorted, oracle);
@@ -378,54 +567,79 @@ multikey_simd_b(unsigned char** strings, size_t N, size_t depth,
 void multikey_simd_b_1(unsigned char** strings, size_t n)
 {
 	unsigned char** sorted =
-		static_cast<unsigned char**>(malloc(n*sizeof(unsigned char*)));
+		static_cast<unsigned char**>(big_malloc(n*sizeof(unsigned char*)));
 	uint8_t* const restrict oracle =
-		static_cast<uint8_t*>(_mm_malloc(n, 16));
+		static_cast<uint8_t*>(big_malloc(n));
 	multikey_simd_b<unsigned char>(strings, n, 0, sorted, oracle);
-	_mm_free(oracle);
-	free(sorted);
+	big_free(oracle);
+	big_free(sorted);
 }
 
 void multikey_simd_b_2(unsigned char** strings, size_t n)
 {
 	unsigned char** sorted =
-		static_cast<unsigned char**>(malloc(n*sizeof(unsigned char*)));
+		static_cast<unsigned char**>(big_malloc(n*sizeof(unsigned char*)));
+	uint8_t* const restrict oracle =
+		static_cast<uint8_t*>(big_malloc(n));
+	multikey_simd_b<uint16_t>(strings, n, 0, sorted, oracle);
+	big_free(oracle);
+	big_free(sorted);
+}
+
+void multikey_simd_b_2_binary(bstring* strings, size_t n)
+{
+	bstring* sorted =
+		static_cast<bstring*>(big_malloc(n*sizeof(bstring)));
 	uint8_t* const restrict oracle =
-		static_cast<uint8_t*>(_mm_malloc(n, 16));
+		static_cast<uint8_t*>(big_malloc(n));
 	multikey_simd_b<uint16_t>(strings, n, 0, sorted, oracle);
-	_mm_free(oracle);
-	free(sorted);
+	big_free(oracle);
+	big_free(sorted);
 }
 
 void multikey_simd_b_4(unsigned char** strings, size_t n)
 {
 	unsigned char** sorted =
-		static_cast<unsigned char**>(malloc(n*sizeof(unsigned char*)));
+		static_cast<unsigned char**>(big_malloc(n*sizeof(unsigned char*)));
+	uint8_t* const restrict oracle =
+		static_cast<uint8_t*>(big_malloc(n));
+	multikey_simd_b<uint32_t>(strings, n, 0, sorted, oracle);
+	big_free(oracle);
+	big_free(sorted);
+}
+
+void multikey_simd_b_4_binary(bstring* strings, size_t n)
+{
+	bstring* sorted =
+		static_cast<bstring*>(big_malloc(n*sizeof(bstring)));
 	uint8_t* const restrict oracle =
-		static_cast<uint8_t*>(_mm_malloc(n, 16));
+		static_cast<uint8_t*>(big_malloc(n));
 	multikey_simd_b<uint32_t>(strings, n, 0, sorted, oracle);
-	_mm_free(oracle);
-	free(sorted);
+	big_free(oracle);
+	big_free(sorted);
 }
 
 ROUTINE_REGISTER_SINGLECORE(multikey_simd_b_1,
 		"multikey_simd with 1byte alphabet + prealloc + prefetch")
-ROUTINE_REGISTER_SINGLECORE(multikey_simd_b_2,
-		"multikey_simd with 2byte alphabet + prealloc + prefetch")
-ROUTINE_REGISTER_SINGLECORE(multikey_simd_b_4,
-		"multikey_simd with 4byte alphabet + prealloc + prefetch")
+ROUTINE_REGISTER_FULL(multikey_simd_b_2,
+		"multikey_simd with 2byte alphabet + prealloc + prefetch", 0,
+		ROUTINE_BINARY(multikey_simd_b_2_binary))
+ROUTINE_REGISTER_FULL(multikey_simd_b_4,
+		"multikey_simd with 4byte alphabet + prealloc + prefetch", 0,
+		ROUTINE_BINARY(multikey_simd_b_4_binary))
 
-template <typename CharT>
+template <typename CharT, typename StringT, typename Access = direct_access>
 static void
-multikey_simd_parallel(unsigned char** strings, size_t N, size_t depth)
+multikey_simd_parallel(StringT* strings, size_t N, size_t depth,
+		Access acc = Access())
 {
 	if (N < 32) {
-		insertion_sort(strings, N, depth);
+		insertion_sort(strings, N, depth, acc);
 		return;
 	}
-	CharT partval = pseudo_median<CharT>(strings, N, depth);
+	CharT partval = pseudo_median<CharT>(strings, N, depth, acc);
 	uint8_t* const restrict oracle =
-		static_cast<uint8_t*>(_mm_malloc(N, 16));
+		static_cast<uint8_t*>(big_malloc(N));
 	std::array<size_t, 3> bucketsize;
 	bucketsize.fill(0);
 	size_t i=N-N%32;
@@ -434,22 +648,23 @@ multikey_simd_parallel(unsigned char** strings, size_t N, size_t depth)
 		{
 #pragma omp section
 		calculate_bucketsizes_sse<false>(strings, i/2, oracle,
-				partval, depth);
+				partval, depth, acc);
 #pragma omp section
 		calculate_bucketsizes_sse<false>(strings+i/2, i/2, oracle+i/2,
-				partval, depth);
+				partval, depth, acc);
 		}
 	} else
-		calculate_bucketsizes_sse<false>(strings, i, oracle, partval, depth);
+		calculate_bucketsizes_sse<false>(strings, i, oracle, partval, depth,
+			acc);
 	for (; i < N; ++i)
 		oracle[i] = get_bucket(
-				get_char<CharT>(strings[i], depth),
+				get_char<CharT>(acc(strings[i]), depth),
 				partval);
 	for (i=0; i < N; ++i)
 		++bucketsize[oracle[i]];
 	assert(bucketsize[0] + bucketsize[1] + bucketsize[2] == N);
-	unsigned char** sorted =
-		static_cast<unsigned char**>(malloc(N*sizeof(unsigned char*)));
+	StringT* sorted =
+		static_cast<StringT*>(big_malloc(N*sizeof(StringT)));
 	size_t bucketindex[3];
 	bucketindex[0] = 0;
 	bucketindex[1] = bucketsize[0];
@@ -458,19 +673,20 @@ multikey_simd_parallel(unsigned char** strings, size_t N, size_t depth)
 		sorted[bucketindex[oracle[i]]++] = strings[i];
 	}
 	std::copy(sorted, sorted+N, strings);
-	free(sorted);
-	_mm_free(oracle);
+	big_free(sorted);
+	big_free(oracle);
 #pragma omp parallel sections
 	{
 #pragma omp section
-	multikey_simd_parallel<CharT>(strings, bucketsize[0], depth);
+	multikey_simd_parallel<CharT>(strings, bucketsize[0], depth, acc);
 #pragma omp section
 	if (not is_end(partval))
 		multikey_simd_parallel<CharT>(strings+bucketsize[0],
-				bucketsize[1], depth+sizeof(CharT));
+				bucketsize[1],
+				depth+char_step<CharT, StringT>::value, acc);
 #pragma omp section
 	multikey_simd_parallel<CharT>(strings+bucketsize[0]+bucketsize[1],
-			bucketsize[2], depth);
+			bucketsize[2], depth, acc);
 	}
 }
 
@@ -483,11 +699,46 @@ void multikey_simd_parallel2(unsigned char** strings, size_t n)
 void multikey_simd_parallel4(unsigned char** strings, size_t n)
 { multikey_simd_parallel<uint32_t>(strings, n, 0); }
 
-ROUTINE_REGISTER_MULTICORE(multikey_simd_parallel1,
-		"parallel multikey_simd with 1byte alphabet")
-ROUTINE_REGISTER_MULTICORE(multikey_simd_parallel2,
-		"parallel multikey_simd with 2byte alphabet")
-ROUTINE_REGISTER_MULTICORE(multikey_simd_parallel4,
-		"parallel multikey_simd with 4byte alphabet")
+void multikey_simd_parallel2_binary(bstring* strings, size_t n)
+{ multikey_simd_parallel<uint16_t>(strings, n, 0); }
+
+void multikey_simd_parallel4_binary(bstring* strings, size_t n)
+{ multikey_simd_parallel<uint32_t>(strings, n, 0); }
+
+void multikey_simd_parallel1_offset(uint32_t* strings, size_t n,
+		unsigned char* text)
+{
+	multikey_simd_parallel<unsigned char>(
+			reinterpret_cast<text_offset*>(strings), n, 0,
+			offset_access{text});
+}
+
+void multikey_simd_parallel2_offset(uint32_t* strings, size_t n,
+		unsigned char* text)
+{
+	multikey_simd_parallel<uint16_t>(
+			reinterpret_cast<text_offset*>(strings), n, 0,
+			offset_access{text});
+}
+
+void multikey_simd_parallel4_offset(uint32_t* strings, size_t n,
+		unsigned char* text)
+{
+	multikey_simd_parallel<uint32_t>(
+			reinterpret_cast<text_offset*>(strings), n, 0,
+			offset_access{text});
+}
+
+ROUTINE_REGISTER_FULL(multikey_simd_parallel1,
+		"parallel multikey_simd with 1byte alphabet", 1,
+		ROUTINE_OFFSET(multikey_simd_parallel1_offset))
+ROUTINE_REGISTER_FULL(multikey_simd_parallel2,
+		"parallel multikey_simd with 2byte alphabet", 1,
+		ROUTINE_BINARY(multikey_simd_parallel2_binary),
+		ROUTINE_OFFSET(multikey_simd_parallel2_offset))
+ROUTINE_REGISTER_FULL(multikey_simd_parallel4,
+		"parallel multikey_simd with 4byte alphabet", 1,
+		ROUTINE_BINARY(multikey_simd_parallel4_binary),
+		ROUTINE_OFFSET(multikey_simd_parallel4_offset))
 
 #endif
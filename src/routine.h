@@ -24,6 +24,8 @@
 #define ROUTINE_H
 
 #include <stdlib.h>
+#include <stdint.h>
+#include "util/bstring.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -34,24 +36,82 @@ struct routine {
 	const char *name;
 	const char *desc;
 	unsigned multicore : 1;
+	/* Optional variant of f that uses caller provided scratch memory of
+	 * n*scratch_per_string bytes, instead of allocating it. */
+	void (*f_scratch)(unsigned char **, size_t, void *);
+	size_t scratch_per_string;
+	/* Optional variant of f that sorts binary strings of known length. */
+	void (*f_binary)(struct bstring *, size_t);
+	/* Optional variant of f that sorts 32-bit offsets of NUL terminated
+	 * strings from the start of the text. */
+	void (*f_offset)(uint32_t *, size_t, unsigned char *text);
+	/* Optional variant of f that only sorts the k smallest strings into
+	 * the first k positions, and leaves the rest in arbitrary order. */
+	void (*f_top)(unsigned char **, size_t n, size_t k);
+	/* Optional variant of f that collapses equal strings while sorting:
+	 * the distinct strings are stored in the first m positions, with the
+	 * number of occurrences in counts[0..m) if counts is not NULL.
+	 * Returns m. */
+	size_t (*f_unique)(unsigned char **, size_t n, size_t *counts);
+	/* Optional variant of f that also stores the LCP array of the sorted
+	 * strings: lcp[0] is 0, and lcp[i] is the length of the longest common
+	 * prefix of strings[i-1] and strings[i]. */
+	void (*f_lcp)(unsigned char **, size_t n, size_t *lcp);
+	/* Optional variant of f that orders the bytes by table[byte] instead
+	 * of their value, e.g. to sort case-insensitively. The table has 256
+	 * entries, maps 0 to 0 and no other byte to 0. */
+	void (*f_collate)(unsigned char **, size_t n,
+			const unsigned char *table);
+	/* Optional variant of f that also stores the permutation of the
+	 * sort: perm[i] is the index in the input of the string at position
+	 * i of the output. The indexes are moved along with the strings in a
+	 * side array, see util/index_array.h. */
+	void (*f_perm)(unsigned char **, size_t n, size_t *perm);
+	/* Set if the routine is meant only for the suffixes of a text, as
+	 * created by --suffix-sorting. Other input is sorted with a fallback
+	 * routine, so the timings would not be the routine's own. */
+	unsigned suffixes_only : 1;
 };
 
 void routine_register(const struct routine *);
 
-#define ROUTINE_REGISTER(_func, _desc, _multicore) \
-	static const struct routine _func##_routine = {    \
-	        _func,                                     \
-	        #_func,                                    \
-	        _desc,                                     \
-	        _multicore,                                \
-	};                                                 \
+/*
+ * Registers _func, and the optional variants that are given as the remaining
+ * arguments with the ROUTINE_xxx() macros below, in any order, for example:
+ *
+ *   ROUTINE_REGISTER_FULL(msd_CE2, "CE2: oracle+loop fission", 0,
+ *           ROUTINE_BINARY(msd_CE2_binary),
+ *           ROUTINE_LCP(msd_CE2_lcp))
+ */
+#define ROUTINE_REGISTER_FULL(_func, _desc, _multicore, ...) \
+	static struct routine _func##_routine;             \
 	static void _func##_register_hook(void)            \
 	        __attribute__((constructor));              \
 	static void _func##_register_hook(void)            \
 	{                                                  \
-	        routine_register(&_func##_routine);        \
+	        struct routine *_r = &_func##_routine;     \
+	        _r->f = _func;                             \
+	        _r->name = #_func;                         \
+	        _r->desc = _desc;                          \
+	        _r->multicore = _multicore;                \
+	        __VA_ARGS__;                               \
+	        routine_register(_r);                      \
 	}
 
+#define ROUTINE_SCRATCH(_f, _bytes) \
+	(_r->f_scratch = (_f), _r->scratch_per_string = (_bytes))
+#define ROUTINE_BINARY(_f)  (_r->f_binary = (_f))
+#define ROUTINE_OFFSET(_f)  (_r->f_offset = (_f))
+#define ROUTINE_TOP(_f)     (_r->f_top = (_f))
+#define ROUTINE_UNIQUE(_f)  (_r->f_unique = (_f))
+#define ROUTINE_LCP(_f)     (_r->f_lcp = (_f))
+#define ROUTINE_COLLATE(_f) (_r->f_collate = (_f))
+#define ROUTINE_PERM(_f)    (_r->f_perm = (_f))
+#define ROUTINE_SUFFIXES_ONLY (_r->suffixes_only = 1)
+
+#define ROUTINE_REGISTER(_func, _desc, _multicore) \
+	ROUTINE_REGISTER_FULL(_func, _desc, _multicore)
+
 #define ROUTINE_REGISTER_SINGLECORE(_func, _desc) \
 	ROUTINE_REGISTER(_func, _desc, 0)
 
@@ -20,7 +20,7 @@
  * IN THE SOFTWARE.
  */
 
-#include "routine.h"
+#include "routines.h"
 #include <string.h>
 
 #define ROUTINES_MAX 256
@@ -73,3 +73,40 @@ routine_get_all(const struct routine ***r, unsigned *cnt)
 	*cnt = routine_cnt;
 	qsort(*r, *cnt, sizeof(struct routine *), routine_cmp);
 }
+
+static size_t
+lcp(const unsigned char *a, const unsigned char *b)
+{
+	size_t i = 0;
+	while (a[i] && a[i] == b[i])
+		++i;
+	return i;
+}
+
+void
+routine_lcp_fallback(unsigned char **strings, size_t n, size_t *lcp_array)
+{
+	if (n == 0)
+		return;
+	lcp_array[0] = 0;
+#pragma omp parallel for schedule(static, 16384)
+	for (size_t i=1; i < n; ++i)
+		lcp_array[i] = lcp(strings[i-1], strings[i]);
+}
+
+void
+routine_lcp_fallback_collate(unsigned char **strings, size_t n,
+		size_t *lcp_array, const unsigned char *table)
+{
+	if (n == 0)
+		return;
+	lcp_array[0] = 0;
+#pragma omp parallel for schedule(static, 16384)
+	for (size_t i=1; i < n; ++i) {
+		const unsigned char *a = strings[i-1], *b = strings[i];
+		size_t h = 0;
+		while (a[h] && table[a[h]] == table[b[h]])
+			++h;
+		lcp_array[i] = h;
+	}
+}
@@ -31,6 +31,14 @@ extern "C" {
 
 const struct routine *routine_from_name(const char *);
 void routine_get_all(const struct routine ***, unsigned *);
+/* Stores the LCP array of sorted strings with an extra pass over them, for
+ * routines without the f_lcp variant. */
+void routine_lcp_fallback(unsigned char **, size_t n, size_t *lcp);
+/* Same as routine_lcp_fallback() for strings sorted by a collation table: the
+ * common prefix is compared through the table, so `Abc' and `abc' share all
+ * three characters with case folding. */
+void routine_lcp_fallback_collate(unsigned char **, size_t n, size_t *lcp,
+		const unsigned char *table);
 
 #ifdef __cplusplus
 }
@@ -26,6 +26,16 @@
 #include "vmainfo.h"
 #include "routines.h"
 #include "cpus_allowed.h"
+#include "generate.h"
+#include "external_sort.h"
+#include "output.h"
+#include "permutation.h"
+#include "verify.h"
+#include "memtrack.h"
+#include "auto_select.h"
+#include "analyze.h"
+#include "collation.h"
+#include "bigalloc.h"
 #include "util/debug.h"
 #include "util/sdt.h"
 
@@ -38,27 +48,97 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <libgen.h>
+#include <fnmatch.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <stdint.h>
+#include <sched.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* How the input file is loaded, see --load. */
+enum load_mode {
+	LOAD_READ,
+	LOAD_PARALLEL,
+	LOAD_POPULATE,
+	LOAD_WILLNEED,
+};
+
+static const char *const load_names[] = {
+	[LOAD_READ]     = "read",
+	[LOAD_PARALLEL] = "parallel",
+	[LOAD_POPULATE] = "populate",
+	[LOAD_WILLNEED] = "willneed",
+};
 
 static struct {
 	const struct routine *r;
+	const char *routines;
+	const char *generate;
+	const char *tmpdir;
 	char *write_filename;
+	const char *permutation_filename;
+	const char *lcp_filename;
 	unsigned suffixsorting    : 1;
 	unsigned check_result     : 1;
 	unsigned oprofile         : 1;
 	unsigned write            : 1;
 	unsigned xml_stats        : 1;
+	unsigned json_stats       : 1;
 	unsigned hugetlb_text     : 1;
 	unsigned hugetlb_pointers : 1;
 	unsigned text_raw         : 1;
+	unsigned perf_counters    : 1;
+	unsigned fork             : 1;
+	unsigned memtrack         : 1;
+	unsigned analyze          : 1;
+	unsigned length_prefixed  : 1;
+	unsigned offsets          : 1;
+	unsigned permutation      : 1;
+	unsigned unique           : 1;
+	unsigned count            : 1;
+	unsigned lcp              : 1;
+	unsigned collate          : 1;
 	int perf_control_fd;
+	unsigned repeat;
+	unsigned warmup;
+	size_t external_memory;
+	size_t external_block;
+	enum output_mode write_mode;
+	enum cpu_pin pin;
+	unsigned *threads;
+	unsigned threads_cnt;
+	size_t analyze_sample;
+	size_t top;
+	enum load_mode load;
 } opts;
 
+/* Details of the current input, included in the XML/JSON statistics. */
+static struct {
+	const char *filename;
+	size_t text_len;
+	double load_ms;
+	double parse_ms;
+	struct input_features features;
+	/* The --generate seed, or the srand48() seed of the run. */
+	unsigned long seed;
+} input;
+
 static FILE *log_file;
 
+/* Where the XML/JSON statistics are written to. */
+static FILE *stats_file;
+
 static void
 open_log_file(void)
 {
@@ -162,6 +242,8 @@ alloc_bytes(size_t bytes, int hugetlb)
 			strerror(errno));
 		exit(1);
 	}
+	if (!hugetlb)
+		big_advise(p, bytes);
 	return p;
 }
 
@@ -172,12 +254,38 @@ alloc_text(size_t bytes)
 	return (unsigned char *)p;
 }
 
-static unsigned char **
+/* The string array holds pointers to NUL terminated strings, or with
+ * --length-prefixed, struct bstring elements, or with --offsets, 32-bit
+ * offsets of the strings from the start of offsets_text. */
+static size_t
+string_size(void)
+{
+	if (opts.length_prefixed)
+		return sizeof(struct bstring);
+	if (opts.offsets)
+		return sizeof(uint32_t);
+	return sizeof(unsigned char *);
+}
+
+static unsigned char *offsets_text;
+
+/* With --unique, the number of distinct strings of the latest sort, and with
+ * --count, the number of occurrences of each. */
+static size_t unique_len;
+static size_t *unique_counts;
+
+/* With --lcp, the LCP array of the latest sort. */
+static size_t *lcp_array;
+/* The permutation computed by the f_perm variant of the routine. */
+static size_t *perm_array;
+
+/* With --collate, the byte order of the sort. */
+static unsigned char collation[256];
+
+static void *
 alloc_pointers(size_t num)
 {
-	void *p = alloc_bytes(num*sizeof(unsigned char *),
-			opts.hugetlb_pointers);
-	return (unsigned char **)p;
+	return alloc_bytes(num*string_size(), opts.hugetlb_pointers);
 }
 
 static void
@@ -187,7 +295,7 @@ free_text(unsigned char *text, size_t text_len)
 }
 
 static void
-free_pointers(unsigned char **strings, size_t strings_len)
+free_pointers(void *strings, size_t strings_len)
 {
 	munmap((void *)strings, strings_len);
 }
@@ -280,13 +388,20 @@ input_mmap(const char *fname, unsigned char **text, size_t *text_len)
 			fname);
 		exit(1);
 	}
-	void *raw = mmap(0, filesize, PROT_READ, MAP_PRIVATE, fd, 0);
+	int map_flags = MAP_PRIVATE;
+	if (opts.load == LOAD_POPULATE)
+		map_flags |= MAP_POPULATE;
+	void *raw = mmap(0, filesize, PROT_READ, map_flags, fd, 0);
 	if (raw == MAP_FAILED) {
 		fprintf(stderr,
 			"ERROR: unable to mmap input file '%s': %s.\n",
 			fname, strerror(errno));
 		exit(1);
 	}
+	/* Start reading the whole file ahead, instead of faulting it in
+	 * during the first pass of the sort. */
+	if (opts.load == LOAD_WILLNEED)
+		(void) madvise(raw, filesize, MADV_WILLNEED);
 	if (close(fd) == -1) {
 		fprintf(stderr,
 			"ERROR: unable to close() input file '%s': %s.\n",
@@ -297,46 +412,165 @@ input_mmap(const char *fname, unsigned char **text, size_t *text_len)
 	*text_len = filesize;
 }
 
+static void input_load_parallel(const char *fname, int delim,
+		unsigned char **text, size_t *text_len,
+		void **strings, size_t *strings_cnt);
+
 static void
 readbytes(const char *fname, unsigned char **text, size_t *text_len)
 {
 	/* mapping file with MAP_HUGETLB does not work. */
-	if (opts.text_raw && !opts.hugetlb_text)
+	if (opts.load == LOAD_PARALLEL)
+		return input_load_parallel(fname, 0, text, text_len,
+				NULL, NULL);
+	else if (opts.text_raw && !opts.hugetlb_text)
 		return input_mmap(fname, text, text_len);
 	else
 		return input_copy(fname, text, text_len);
 }
 
+/* Builds a synthetic input according to the --generate specification. */
+static void
+input_generate(const struct generate_params *params,
+		unsigned char **text, size_t *text_len)
+{
+	*text_len = generate_size(params);
+	*text = alloc_text(*text_len);
+	generate_fill(params, *text, opts.text_raw ? '\0' : '\n');
+}
+
+/* Returns a bit mask of the bytes in p[0..63] that are equal to delim. */
+static inline uint64_t
+delim_mask64(const unsigned char *p, int delim)
+{
+#if defined(__AVX2__)
+	const __m256i d = _mm256_set1_epi8((char)delim);
+	uint32_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+			_mm256_loadu_si256((const __m256i *)(p+ 0)), d));
+	uint32_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+			_mm256_loadu_si256((const __m256i *)(p+32)), d));
+	return ((uint64_t)hi << 32) | lo;
+#elif defined(__SSE2__)
+	const __m128i d = _mm_set1_epi8((char)delim);
+	uint64_t m0 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(
+			_mm_loadu_si128((const __m128i *)(p+ 0)), d));
+	uint64_t m1 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(
+			_mm_loadu_si128((const __m128i *)(p+16)), d));
+	uint64_t m2 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(
+			_mm_loadu_si128((const __m128i *)(p+32)), d));
+	uint64_t m3 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(
+			_mm_loadu_si128((const __m128i *)(p+48)), d));
+	return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+#else
+	uint64_t m = 0;
+	for (unsigned i=0; i < 64; ++i)
+		if (p[i] == delim)
+			m |= (uint64_t)1 << i;
+	return m;
+#endif
+}
+
+static size_t
+count_delim(const unsigned char *text, size_t begin, size_t end, int delim)
+{
+	size_t cnt = 0, i = begin;
+	for (; i + 64 <= end; i += 64)
+		cnt += __builtin_popcountll(delim_mask64(text+i, delim));
+	for (; i < end; ++i)
+		if (text[i] == delim)
+			++cnt;
+	return cnt;
+}
+
+static inline void
+set_string(void *strs, size_t k, unsigned char *text, size_t pos)
+{
+	if (opts.offsets)
+		((uint32_t *)strs)[k] = pos;
+	else
+		((unsigned char **)strs)[k] = text + pos;
+}
+
+/* The k'th delimiter of the text ends the k'th string, and the (k+1)'th
+ * string starts right after it. `k' is the number of delimiters before
+ * text[begin], so chunks can be processed independently. */
+static void
+fill_strings(unsigned char *text, size_t begin, size_t end, int delim,
+		void *strs, size_t k, size_t strs_cnt)
+{
+	size_t i = begin;
+	for (; i + 64 <= end; i += 64) {
+		uint64_t m = delim_mask64(text+i, delim);
+		while (m) {
+			size_t pos = i + __builtin_ctzll(m);
+			m &= m - 1;
+			if (delim != '\0')
+				text[pos] = '\0';
+			if (++k < strs_cnt)
+				set_string(strs, k, text, pos + 1);
+		}
+	}
+	for (; i < end; ++i)
+		if (text[i] == delim) {
+			if (delim != '\0')
+				text[i] = '\0';
+			if (++k < strs_cnt)
+				set_string(strs, k, text, i + 1);
+		}
+}
+
+/* Splits the text into chunks, counts the delimiters in each chunk in
+ * parallel, computes the index of the first string of each chunk with an
+ * exclusive prefix sum, and then fills the string pointers in parallel. */
 static void
 create_strings_delim(unsigned char *text, size_t text_len, int delim,
-		unsigned char ***strings, size_t *strings_cnt)
+		void **strings, size_t *strings_cnt)
 {
+	const size_t min_chunk = 1024*1024;
+	size_t chunks = 1;
+#ifdef _OPENMP
+	chunks = 8*omp_get_max_threads();
+#endif
+	if (chunks > text_len / min_chunk)
+		chunks = text_len / min_chunk;
+	if (chunks == 0)
+		chunks = 1;
+	size_t *chunk_cnt = (size_t *)malloc(chunks*sizeof(size_t));
+	if (!chunk_cnt) {
+		fprintf(stderr,
+			"ERROR: unable to allocate memory for parsing.\n");
+		exit(1);
+	}
+#pragma omp parallel for schedule(dynamic)
+	for (size_t c=0; c < chunks; ++c)
+		chunk_cnt[c] = count_delim(text, c*text_len/chunks,
+				(c+1)*text_len/chunks, delim);
 	size_t strs_cnt = 0;
-	for (size_t i=0; i < text_len; ++i)
-		if (text[i] == delim)
-			++strs_cnt;
+	for (size_t c=0; c < chunks; ++c) {
+		size_t cnt = chunk_cnt[c];
+		chunk_cnt[c] = strs_cnt;
+		strs_cnt += cnt;
+	}
 	if (strs_cnt == 0) {
 		fprintf(stderr,
 			"ERROR: unable to read any lines from the input "
 			"file.\n");
 		exit(1);
 	}
-	unsigned char **strs = alloc_pointers(strs_cnt);
-	unsigned char *line_start = text;
-	for (size_t j=0, i=0; i < text_len; ++i)
-		if (text[i] == delim) {
-			strs[j++] = line_start;
-			line_start = text + i + 1;
-			if (delim != '\0')
-				text[i] = '\0';
-		}
+	void *strs = alloc_pointers(strs_cnt);
+	set_string(strs, 0, text, 0);
+#pragma omp parallel for schedule(dynamic)
+	for (size_t c=0; c < chunks; ++c)
+		fill_strings(text, c*text_len/chunks, (c+1)*text_len/chunks,
+				delim, strs, chunk_cnt[c], strs_cnt);
+	free(chunk_cnt);
 	*strings = strs;
 	*strings_cnt = strs_cnt;
 }
 
 static void
 create_strings(unsigned char *text, size_t text_len,
-		unsigned char ***strings, size_t *strings_cnt)
+		void **strings, size_t *strings_cnt)
 {
 	if (opts.text_raw)
 		return create_strings_delim(text, text_len, '\0',
@@ -346,6 +580,173 @@ create_strings(unsigned char *text, size_t text_len,
 				strings, strings_cnt);
 }
 
+/* Reads len bytes from the offset, returns 0 or -1 with errno set. */
+static int
+pread_full(int fd, unsigned char *buf, size_t len, off_t offset)
+{
+	while (len) {
+		ssize_t ret = pread(fd, buf, len, offset);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			if (ret == 0)
+				errno = EIO;
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+		offset += ret;
+	}
+	return 0;
+}
+
+#ifdef _OPENMP
+/* The reads mostly wait for the storage, so use more threads than CPUs. */
+static int
+load_threads(void)
+{
+	int threads = omp_get_max_threads();
+	return threads < 8 ? 8 : threads;
+}
+#endif
+
+/* --load=parallel: reads the file in 8 MB chunks with parallel pread()
+ * calls into a THP backed buffer. With `strings', each chunk is parsed as
+ * soon as it has been read, while later chunks are still in flight: the
+ * delimiters of the chunk are counted, the index of its first string is
+ * taken from the running total in file order, and the string pointers of
+ * the chunk are filled. As the number of strings is not known until the
+ * whole file has been read, the string array is reserved for one string
+ * per byte and trimmed afterwards; the untouched pages cost nothing. */
+static void
+input_load_parallel(const char *fname, int delim,
+		unsigned char **text_, size_t *text_len_,
+		void **strings_, size_t *strings_cnt_)
+{
+	const size_t chunk = 8*1024*1024;
+	int fd = open(fname, O_RDONLY);
+	if (fd == -1) {
+		fprintf(stderr,
+			"ERROR: unable to open() input file '%s': %s.\n",
+			fname, strerror(errno));
+		exit(1);
+	}
+	off_t filesize = file_size(fd);
+	if (filesize <= 0) {
+		fprintf(stderr,
+			"ERROR: input file '%s' empty.\n",
+			fname);
+		exit(1);
+	}
+	(void) posix_fadvise(fd, 0, filesize, POSIX_FADV_SEQUENTIAL);
+	unsigned char *text = alloc_text(filesize);
+	if (!opts.hugetlb_text)
+		(void) madvise(text, filesize, MADV_HUGEPAGE);
+	void *strs = NULL;
+	size_t reserved = 0;
+	if (strings_) {
+		reserved = ((size_t)filesize+1)*string_size();
+		strs = mmap(NULL, reserved, PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE,
+				-1, 0);
+		if (strs == MAP_FAILED) {
+			fprintf(stderr,
+				"ERROR: unable to mmap memory for input: %s.\n",
+				strerror(errno));
+			exit(1);
+		}
+	}
+	const size_t chunks = ((size_t)filesize + chunk-1) / chunk;
+	size_t strs_cnt = 0;
+	int error = 0;
+#pragma omp parallel for schedule(dynamic, 1) ordered num_threads(load_threads())
+	for (size_t c=0; c < chunks; ++c) {
+		const size_t begin = c*chunk;
+		const size_t end = begin+chunk < (size_t)filesize
+			? begin+chunk : (size_t)filesize;
+		if (pread_full(fd, text+begin, end-begin, begin) == -1) {
+#pragma omp atomic write
+			error = errno;
+		}
+		size_t first = 0, cnt = 0;
+		if (strs)
+			cnt = count_delim(text, begin, end, delim);
+#pragma omp ordered
+		{
+			first = strs_cnt;
+			strs_cnt += cnt;
+		}
+		if (strs)
+			fill_strings(text, begin, end, delim, strs, first,
+					SIZE_MAX);
+	}
+	if (error) {
+		fprintf(stderr, "ERROR: failed pread() "
+			"from input file '%s': %s.\n",
+			fname, strerror(error));
+		exit(1);
+	}
+	if (close(fd) == -1) {
+		fprintf(stderr,
+			"ERROR: unable to close() input file '%s': %s.\n",
+			fname, strerror(errno));
+		exit(1);
+	}
+	*text_ = text;
+	*text_len_ = filesize;
+	if (!strs)
+		return;
+	if (strs_cnt == 0) {
+		fprintf(stderr,
+			"ERROR: unable to read any lines from the input "
+			"file.\n");
+		exit(1);
+	}
+	set_string(strs, 0, text, 0);
+	const size_t page = sysconf(_SC_PAGESIZE);
+	const size_t used = (strs_cnt*string_size() + page-1) & ~(page-1);
+	if (used < reserved)
+		munmap((unsigned char *)strs + used, reserved - used);
+	*strings_ = strs;
+	*strings_cnt_ = strs_cnt;
+}
+
+/* Each string of the --length-prefixed input is preceded by its length as a
+ * 32-bit little endian integer. */
+static inline size_t
+length_prefix(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((size_t)p[3] << 24);
+}
+
+static void
+create_bstrings(unsigned char *text, size_t text_len,
+		struct bstring **strings, size_t *strings_cnt)
+{
+	size_t i, cnt = 0;
+	for (i=0; i + 4 <= text_len; i += 4 + length_prefix(text+i))
+		++cnt;
+	if (i != text_len) {
+		fprintf(stderr,
+			"ERROR: the last string of the length prefixed input "
+			"is truncated.\n");
+		exit(1);
+	}
+	if (cnt == 0) {
+		fprintf(stderr,
+			"ERROR: unable to read any strings from the input "
+			"file.\n");
+		exit(1);
+	}
+	struct bstring *strs = alloc_pointers(cnt);
+	for (i=0, cnt=0; i < text_len; i += 4 + strs[cnt++].len) {
+		strs[cnt].ptr = text + i + 4;
+		strs[cnt].len = length_prefix(text+i);
+	}
+	*strings = strs;
+	*strings_cnt = cnt;
+}
+
 static void
 create_suffixes(unsigned char *text, size_t text_len,
 		unsigned char ***strings, size_t *strings_cnt)
@@ -358,9 +759,8 @@ create_suffixes(unsigned char *text, size_t text_len,
 }
 
 static void
-write_result(unsigned char **strings, size_t n)
+default_write_filename(void)
 {
-	FILE *fp;
 	if (!opts.write_filename) {
 		const char *username = getenv("USERNAME");
 		if (!username)
@@ -368,88 +768,994 @@ write_result(unsigned char **strings, size_t n)
 		if (asprintf(&opts.write_filename, "/tmp/%s/alg.out", username) == -1)
 			opts.write_filename = NULL;
 	}
-	fp = fopen(opts.write_filename, "w");
-	if (!fp) {
+}
+
+/* With --all or --routines every routine writes to its own file, the
+ * routine name appended to the --write file name. The layout of the strings
+ * is given by their size, as returned by string_size(). */
+static void
+write_result(const struct routine *r, void *strings, size_t n, size_t size)
+{
+	struct timespec start, stop;
+	long long bytes;
+	double ms;
+	char *filename;
+	default_write_filename();
+	if (!opts.write_filename) {
 		fprintf(stderr,
 			"WARNING: --write failed: "
-			"unable to open file for writing!\n");
+			"unable to determine output filename!\n");
+		return;
+	}
+	if (size == sizeof(uint32_t)) {
+		/* The writers take pointers, convert outside of the timing. */
+		unsigned char **pointers = malloc(n*sizeof(unsigned char *));
+		if (!pointers) {
+			fprintf(stderr,
+				"WARNING: --write failed: out of memory\n");
+			return;
+		}
+		for (size_t i=0; i < n; ++i)
+			pointers[i] = offsets_text + ((uint32_t *)strings)[i];
+		write_result(r, pointers, n, sizeof(unsigned char *));
+		free(pointers);
+		return;
+	}
+	if (!opts.routines)
+		filename = strdup(opts.write_filename);
+	else if (asprintf(&filename, "%s.%s", opts.write_filename,
+				r->name) == -1)
+		filename = NULL;
+	if (!filename) {
+		fprintf(stderr,
+			"WARNING: --write failed: out of memory\n");
 		return;
 	}
-	for (size_t i=0; i < n; ++i) {
-		fputs((const char *)strings[i], fp);
-		fputc('\n', fp);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (size == sizeof(struct bstring))
+		bytes = output_write_binary(filename, strings, n);
+	else if (opts.count)
+		bytes = output_write_counts(filename, strings,
+				unique_counts, n);
+	else
+		bytes = output_write(filename, strings, n, '\n',
+				opts.write_mode);
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	if (bytes == -1) {
+		fprintf(stderr,
+			"WARNING: --write failed: %s\n", strerror(errno));
+		free(filename);
+		return;
 	}
-	fclose(fp);
-	fprintf(stderr, "Wrote sorted output to '%s'.\n",
-			opts.write_filename);
-	/*
-	std::cout << "\n";
-	system("md5sum " + opts.write_filename);
-	system("cat    " + opts.input_filename + ".md5sum");
-	std::cout << "\n";
-	*/
+	ms = (stop.tv_sec - start.tv_sec)*1000.0
+		+ (stop.tv_nsec - start.tv_nsec)/1e6;
+	fprintf(stderr, "Wrote sorted output to '%s'.\n", filename);
+	fprintf(stderr, "Write: %lld bytes in %.2f ms (%.1f MB/s, %s)\n",
+			bytes, ms, ms > 0 ? bytes/1e3/ms : 0.0,
+			output_mode_name(size == sizeof(struct bstring)
+				|| opts.count ? OUTPUT_WRITEV
+				: opts.write_mode));
+	free(filename);
 }
 
+/* The clocks collected by timing.c, in the order they are reported. */
+static const struct {
+	const char *name;
+	double (*get)(void);
+} clocks[] = {
+	{ "wall-clock",      gettime_wall_clock      },
+	{ "user",            gettime_user            },
+	{ "sys",             gettime_sys             },
+	{ "user+sys",        gettime_user_sys        },
+	{ "PROCESS_CPUTIME", gettime_process_cputime },
+};
+#define CLOCKS_CNT (sizeof(clocks)/sizeof(clocks[0]))
+
+/* Timing results of each repeated run, indexed as samples[clock][iteration].
+ * The clocks are followed by the hardware counters from timing.c. */
+#define SAMPLES_CNT (CLOCKS_CNT + TIMING_COUNTERS)
+static double *samples[SAMPLES_CNT];
+static unsigned samples_cnt;
+
 static void
-print_timing_results_xml(void)
+samples_alloc(unsigned cnt)
 {
-	/*
-	"<event>\n"
-	"  <algorithm num=\""<<algnum<<"\" name=\""<<algname<<"\"/>\n"
-	"  <input fullpath=\""<<filename<<"\" n=\""<<n<<"\"/>\n"
-	"  <time seconds=\""<<time<<"\"/>\n"
-	"</event>";
-	*/
+	for (unsigned c=0; c < SAMPLES_CNT; ++c) {
+		samples[c] = (double *)calloc(cnt, sizeof(double));
+		if (!samples[c]) {
+			fprintf(stderr,
+				"ERROR: unable to allocate memory for timing "
+				"results.\n");
+			exit(1);
+		}
+	}
+	samples_cnt = 0;
 }
 
 static void
-print_timing_results_human(void)
+samples_free(void)
 {
-	printf("%10.2f ms : wall-clock\n", gettime_wall_clock());
-	printf("%10.2f ms : user\n", gettime_user());
-	printf("%10.2f ms : sys\n", gettime_sys());
-	printf("%10.2f ms : user+sys\n", gettime_user_sys());
-	printf("%10.2f ms : PROCESS_CPUTIME\n", gettime_process_cputime());
+	for (unsigned c=0; c < SAMPLES_CNT; ++c) {
+		free(samples[c]);
+		samples[c] = NULL;
+	}
+	samples_cnt = 0;
 }
 
 static void
-print_timing_results(void)
+samples_record(void)
 {
-	if (opts.xml_stats)
-		print_timing_results_xml();
+	for (unsigned c=0; c < CLOCKS_CNT; ++c)
+		samples[c][samples_cnt] = clocks[c].get();
+	if (opts.perf_counters)
+		for (unsigned i=0; i < TIMING_COUNTERS; ++i)
+			samples[CLOCKS_CNT+i][samples_cnt] =
+				timing_counter_value(i);
+	++samples_cnt;
+}
+
+static int
+double_cmp(const void *a, const void *b)
+{
+	double aa = *(const double *)a;
+	double bb = *(const double *)b;
+	if (aa < bb) return -1;
+	if (aa > bb) return 1;
+	return 0;
+}
+
+struct sample_stats {
+	double min, median, p90, max;
+};
+
+/* Computes the statistics from a sorted copy of the samples. The 90th
+ * percentile uses the nearest-rank method. */
+static struct sample_stats
+samples_stats(unsigned clock)
+{
+	struct sample_stats st = { 0, 0, 0, 0 };
+	const unsigned n = samples_cnt;
+	double *v;
+	if (n == 0)
+		return st;
+	v = (double *)malloc(n*sizeof(double));
+	if (!v) {
+		fprintf(stderr,
+			"ERROR: unable to allocate memory for timing "
+			"results.\n");
+		exit(1);
+	}
+	memcpy(v, samples[clock], n*sizeof(double));
+	qsort(v, n, sizeof(double), double_cmp);
+	st.min = v[0];
+	st.max = v[n-1];
+	if (n % 2)
+		st.median = v[n/2];
 	else
-		print_timing_results_human();
+		st.median = (v[n/2-1] + v[n/2]) / 2;
+	st.p90 = v[(9*n+9)/10 - 1];
+	free(v);
+	return st;
+}
+
+static double
+sample_median(unsigned idx)
+{
+	if (samples_cnt == 1)
+		return samples[idx][0];
+	return samples_stats(idx).median;
+}
+
+/* Prints instructions per cycle and the amount of misses per string, based
+ * on the median counter values. */
+static void
+print_counter_ratios(size_t n)
+{
+	const unsigned cycles = CLOCKS_CNT + 0;
+	const unsigned instructions = CLOCKS_CNT + 1;
+	if (timing_counter_available(0) && timing_counter_available(1)
+			&& sample_median(cycles) > 0)
+		printf("%13.2f : IPC\n", sample_median(instructions)
+				/ sample_median(cycles));
+	for (unsigned i=2; i < TIMING_COUNTERS; ++i)
+		if (timing_counter_available(i))
+			printf("%13.2f : %s per string\n",
+				sample_median(CLOCKS_CNT+i) / n,
+				timing_counter_name(i));
+}
+
+static void
+print_timing_results_human(size_t n)
+{
+	if (samples_cnt == 1) {
+		for (unsigned c=0; c < CLOCKS_CNT; ++c)
+			printf("%10.2f ms : %s\n", samples[c][0], clocks[c].name);
+		if (!opts.perf_counters)
+			return;
+		for (unsigned i=0; i < TIMING_COUNTERS; ++i)
+			if (timing_counter_available(i))
+				printf("%13.0f : %s\n", samples[CLOCKS_CNT+i][0],
+						timing_counter_name(i));
+			else
+				printf("%13s : %s\n", "<not supported>",
+						timing_counter_name(i));
+		print_counter_ratios(n);
+		return;
+	}
+	printf("%u iterations, %u warmup:\n", samples_cnt, opts.warmup);
+	printf("%10s %10s %10s %10s\n", "min", "median", "p90", "max");
+	for (unsigned c=0; c < CLOCKS_CNT; ++c) {
+		struct sample_stats st = samples_stats(c);
+		printf("%10.2f %10.2f %10.2f %10.2f ms : %s\n",
+				st.min, st.median, st.p90, st.max,
+				clocks[c].name);
+	}
+	if (!opts.perf_counters)
+		return;
+	for (unsigned i=0; i < TIMING_COUNTERS; ++i) {
+		struct sample_stats st = samples_stats(CLOCKS_CNT+i);
+		if (timing_counter_available(i))
+			printf("%10.4g %10.4g %10.4g %10.4g    : %s\n",
+				st.min, st.median, st.p90, st.max,
+				timing_counter_name(i));
+		else
+			printf("%43s    : %s\n", "<not supported>",
+				timing_counter_name(i));
+	}
+	print_counter_ratios(n);
+}
+
+/* Formats a power of two size as e.g. "512 B", "64 kB" or "2 GB". */
+static const char *
+format_pow2_size(char *buf, size_t bufsize, unsigned order)
+{
+	static const char *const units[] = { "B", "kB", "MB", "GB", "TB" };
+	unsigned u = order / 10;
+	if (u > 4)
+		u = 4;
+	snprintf(buf, bufsize, "%llu %s", 1ULL << (order - u*10), units[u]);
+	return buf;
+}
+
+/* Prints the allocations made by the routine during the last timed run, and
+ * the peak of live allocated bytes over all timed runs. */
+static void
+print_memtrack_human(void)
+{
+	struct memtrack_stats st;
+	char lo[16], hi[16];
+	memtrack_get(&st);
+	printf("%10.2f kB : peak allocated\n", st.peak / 1024.0);
+	printf("%13zu : allocations\n", st.allocations);
+	printf("%13zu : frees\n", st.frees);
+	for (unsigned i=0; i < MEMTRACK_BUCKETS; ++i)
+		if (st.histogram[i])
+			printf("%13zu : allocations in [%s, %s)\n",
+				st.histogram[i],
+				format_pow2_size(lo, sizeof(lo), i),
+				format_pow2_size(hi, sizeof(hi), i+1));
+}
+
+static long
+peak_rss_kb(void)
+{
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == -1)
+		return -1;
+	return ru.ru_maxrss;
+}
+
+static int
+thread_count(void)
+{
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+static const char *const pin_names[] = {
+	[CPU_PIN_NONE]    = "none",
+	[CPU_PIN_COMPACT] = "compact",
+	[CPU_PIN_SCATTER] = "scatter",
+	[CPU_PIN_NUMA]    = "numa",
+};
+
+static void
+print_xml_escaped(const char *str)
+{
+	for (; *str; ++str) {
+		switch (*str) {
+		case '&':  fputs("&amp;", stats_file);  break;
+		case '<':  fputs("&lt;", stats_file);   break;
+		case '>':  fputs("&gt;", stats_file);   break;
+		case '"':  fputs("&quot;", stats_file); break;
+		default:   fputc(*str, stats_file);           break;
+		}
+	}
+}
+
+static void
+print_json_string(const char *str)
+{
+	fputc('"', stats_file);
+	for (; *str; ++str) {
+		unsigned char c = (unsigned char)*str;
+		if (c == '"' || c == '\\')
+			fprintf(stats_file, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(stats_file, "\\u%04x", c);
+		else
+			fputc(c, stats_file);
+	}
+	fputc('"', stats_file);
+}
+
+/* One <event> per timed routine, all inside a single <events> root element
+ * that main() opens and closes, so that --routines and --threads lists still
+ * produce a well-formed document. The <time> element holds the median
+ * wall-clock time in seconds, as expected by report/htmlreport.xsl. */
+static void
+print_timing_results_xml(const struct routine *r, size_t n)
+{
+	char *cpus_al = cpus_allowed_list();
+	fprintf(stats_file, "<event>\n");
+	fprintf(stats_file, "  <algorithm name=\"");
+	print_xml_escaped(r->name);
+	fprintf(stats_file, "\" multicore=\"%d\"/>\n", r->multicore);
+	fprintf(stats_file, "  <input fullpath=\"");
+	print_xml_escaped(input.filename);
+	fprintf(stats_file, "\" n=\"%zu\" bytes=\"%zu\" load-ms=\"%.3f\" "
+			"parse-ms=\"%.3f\"/>\n",
+			n, input.text_len, input.load_ms, input.parse_ms);
+	fprintf(stats_file, "  <features alphabet=\"%u\" dprefix=\"%.3f\" "
+			"duplicates=\"%.5f\" avg-len=\"%.3f\"/>\n",
+			input.features.alphabet, input.features.dprefix,
+			input.features.duplicates, input.features.avg_len);
+	fprintf(stats_file, "  <time seconds=\"%.6f\"/>\n", sample_median(0) / 1000);
+	fprintf(stats_file, "  <timers iterations=\"%u\" warmup=\"%u\">\n",
+			samples_cnt, opts.warmup);
+	for (unsigned c=0; c < CLOCKS_CNT; ++c) {
+		struct sample_stats st = samples_stats(c);
+		fprintf(stats_file, "    <timer name=\"%s\" unit=\"ms\" min=\"%.3f\" "
+		       "median=\"%.3f\" p90=\"%.3f\" max=\"%.3f\"/>\n",
+		       clocks[c].name, st.min, st.median, st.p90, st.max);
+	}
+	if (opts.perf_counters)
+		for (unsigned i=0; i < TIMING_COUNTERS; ++i) {
+			struct sample_stats st;
+			if (!timing_counter_available(i))
+				continue;
+			st = samples_stats(CLOCKS_CNT+i);
+			fprintf(stats_file, "    <counter name=\"%s\" min=\"%.0f\" "
+			       "median=\"%.0f\" p90=\"%.0f\" max=\"%.0f\"/>\n",
+			       timing_counter_name(i),
+			       st.min, st.median, st.p90, st.max);
+		}
+	fprintf(stats_file, "  </timers>\n");
+	fprintf(stats_file, "  <memory peak-rss-kb=\"%ld\"/>\n", peak_rss_kb());
+	if (opts.memtrack) {
+		struct memtrack_stats st;
+		memtrack_get(&st);
+		fprintf(stats_file, "  <allocations peak-bytes=\"%zu\" count=\"%zu\" "
+		       "frees=\"%zu\">\n", st.peak, st.allocations, st.frees);
+		for (unsigned i=0; i < MEMTRACK_BUCKETS; ++i)
+			if (st.histogram[i])
+				fprintf(stats_file, "    <bucket min-bytes=\"%llu\" "
+				       "count=\"%zu\"/>\n", 1ULL << i,
+				       st.histogram[i]);
+		fprintf(stats_file, "  </allocations>\n");
+	}
+	fprintf(stats_file, "  <system threads=\"%d\" pin=\"%s\" cpus-allowed=\"%s\" "
+			"seed=\"%lu\"/>\n", thread_count(), pin_names[opts.pin],
+			cpus_al ? cpus_al : "", input.seed);
+	fprintf(stats_file, "</event>\n");
+	free(cpus_al);
+}
+
+static void
+print_json_stats(const struct sample_stats *st)
+{
+	fprintf(stats_file, "{\"min\":%.3f,\"median\":%.3f,\"p90\":%.3f,\"max\":%.3f}",
+			st->min, st->median, st->p90, st->max);
+}
+
+/* Prints one result record per line (JSON Lines). */
+static void
+print_timing_results_json(const struct routine *r, size_t n)
+{
+	char *cpus_al = cpus_allowed_list();
+	fprintf(stats_file, "{\"routine\":");
+	print_json_string(r->name);
+	fprintf(stats_file, ",\"multicore\":%s", r->multicore ? "true" : "false");
+	fprintf(stats_file, ",\"input\":");
+	print_json_string(input.filename);
+	fprintf(stats_file, ",\"n\":%zu,\"text_bytes\":%zu,\"load_ms\":%.3f"
+			",\"parse_ms\":%.3f",
+			n, input.text_len, input.load_ms, input.parse_ms);
+	fprintf(stats_file, ",\"features\":{\"alphabet\":%u,\"dprefix\":%.3f,"
+			"\"duplicates\":%.5f,\"avg_len\":%.3f}",
+			input.features.alphabet, input.features.dprefix,
+			input.features.duplicates, input.features.avg_len);
+	fprintf(stats_file, ",\"iterations\":%u,\"warmup\":%u", samples_cnt, opts.warmup);
+	fprintf(stats_file, ",\"timers_ms\":{");
+	for (unsigned c=0; c < CLOCKS_CNT; ++c) {
+		struct sample_stats st = samples_stats(c);
+		fprintf(stats_file, "%s\"%s\":", c ? "," : "", clocks[c].name);
+		print_json_stats(&st);
+	}
+	fprintf(stats_file, "}");
+	if (opts.perf_counters) {
+		fprintf(stats_file, ",\"counters\":{");
+		for (unsigned i=0; i < TIMING_COUNTERS; ++i) {
+			struct sample_stats st = samples_stats(CLOCKS_CNT+i);
+			fprintf(stats_file, "%s\"%s\":", i ? "," : "",
+					timing_counter_name(i));
+			if (timing_counter_available(i))
+				print_json_stats(&st);
+			else
+				fprintf(stats_file, "null");
+		}
+		fprintf(stats_file, "}");
+	}
+	fprintf(stats_file, ",\"peak_rss_kb\":%ld", peak_rss_kb());
+	if (opts.memtrack) {
+		struct memtrack_stats st;
+		int first = 1;
+		memtrack_get(&st);
+		fprintf(stats_file, ",\"allocations\":{\"peak_bytes\":%zu,"
+				"\"count\":%zu,\"frees\":%zu,\"histogram\":{",
+				st.peak, st.allocations, st.frees);
+		for (unsigned i=0; i < MEMTRACK_BUCKETS; ++i) {
+			if (!st.histogram[i])
+				continue;
+			fprintf(stats_file, "%s\"%llu\":%zu", first ? "" : ",",
+					1ULL << i, st.histogram[i]);
+			first = 0;
+		}
+		fprintf(stats_file, "}}");
+	}
+	fprintf(stats_file, ",\"threads\":%d", thread_count());
+	fprintf(stats_file, ",\"pin\":\"%s\"", pin_names[opts.pin]);
+	fprintf(stats_file, ",\"cpus_allowed\":");
+	print_json_string(cpus_al ? cpus_al : "");
+	fprintf(stats_file, ",\"seed\":%lu}\n", input.seed);
+	free(cpus_al);
+}
+
+static void
+print_timing_results(const struct routine *r, size_t n)
+{
+	if (opts.xml_stats)
+		print_timing_results_xml(r, n);
+	else if (opts.json_stats)
+		print_timing_results_json(r, n);
+	else {
+		print_timing_results_human(n);
+		if (opts.memtrack)
+			print_memtrack_human();
+	}
+	fflush(stats_file);
+}
+
+static void
+restore_strings(void *strings, void *pristine, size_t n)
+{
+	if (pristine)
+		memcpy(strings, pristine, n*string_size());
+}
+
+static inline void
+call_routine(const struct routine *r, void *strings, size_t n)
+{
+	if (perm_array)
+		r->f_perm(strings, n, perm_array);
+	else if (opts.length_prefixed)
+		r->f_binary(strings, n);
+	else if (opts.offsets)
+		r->f_offset(strings, n, offsets_text);
+	else if (opts.top)
+		r->f_top(strings, n, opts.top < n ? opts.top : n);
+	else if (opts.unique)
+		unique_len = r->f_unique(strings, n, unique_counts);
+	else if (opts.collate) {
+		r->f_collate(strings, n, collation);
+		if (opts.lcp)
+			routine_lcp_fallback_collate(strings, n, lcp_array,
+					collation);
+	} else if (opts.lcp && r->f_lcp)
+		r->f_lcp(strings, n, lcp_array);
+	else if (opts.lcp) {
+		r->f(strings, n);
+		routine_lcp_fallback(strings, n, lcp_array);
+	} else
+		r->f(strings, n);
+}
+
+/* Writes the permutation or LCP values one per line. */
+static void
+write_values(const char *filename, const char *what, const size_t *values,
+		size_t n)
+{
+	FILE *fp = fopen(filename, "w");
+	if (!fp) {
+		fprintf(stderr,
+			"WARNING: unable to write %s to '%s': %s\n",
+			what, filename, strerror(errno));
+		return;
+	}
+	for (size_t i=0; i < n; ++i)
+		fprintf(fp, "%zu\n", values[i]);
+	if (fclose(fp) == EOF) {
+		fprintf(stderr,
+			"WARNING: unable to write %s to '%s': %s\n",
+			what, filename, strerror(errno));
+		return;
+	}
+	fprintf(stderr, "Wrote %s to '%s'.\n", what, filename);
+}
+
+/* The f_perm variant of the routine carries the input index of every string
+ * through the sort. It is used for plain strings without the other output
+ * modes. */
+static int
+perm_variant(const struct routine *r)
+{
+	return r->f_perm && !opts.length_prefixed && !opts.offsets
+		&& !opts.top && !opts.collate && !opts.lcp;
+}
+
+/* Checks and writes the permutation of the sort, after recovering it from
+ * the sorted strings and the input order if the routine did not compute
+ * it. */
+static int
+permutation_result(void *strings, void *pristine, size_t n)
+{
+	struct timespec start, stop;
+	int ret = 0;
+	size_t *perm = perm_array;
+	if (!perm) {
+		perm = malloc((n ? n : 1)*sizeof(size_t));
+		if (!perm) {
+			fprintf(stderr,
+				"ERROR: unable to allocate memory for the "
+				"permutation.\n");
+			return 1;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if (permutation_recover(pristine, strings, n, string_size(),
+					perm) == -1) {
+			fprintf(stderr,
+				"ERROR: unable to recover the permutation: "
+				"%s.\n", strerror(errno));
+			free(perm);
+			return 1;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &stop);
+		fprintf(stderr, "Permutation: recovered in %.2f ms\n",
+				(stop.tv_sec - start.tv_sec)*1000.0
+				+ (stop.tv_nsec - start.tv_nsec)/1e6);
+	}
+	if (opts.check_result) {
+		ret = permutation_check(pristine, strings, n, string_size(),
+				perm);
+		if (ret == 0)
+			fprintf(stderr, "Check permutation: GOOD\n");
+	}
+	if (opts.permutation_filename)
+		write_values(opts.permutation_filename, "permutation",
+				perm, n);
+	if (perm != perm_array)
+		free(perm);
+	return ret;
 }
 
+/* Median wall-clock time of the latest run(), for the thread scaling table. */
+static double run_wall_ms;
+
 int
-run(const struct routine *r, unsigned char **strings, size_t n)
+run(const struct routine *r, void *strings, size_t n)
 {
 	int ret = 0;
+	void *pristine = NULL;
+	struct fingerprint before, after;
+	unsigned i;
+	/* --unique collapses the duplicates, so its output is not a
+	 * permutation of the input. */
+	if (opts.check_result && !opts.unique)
+		verify_fingerprint(strings, n, string_size(), &before);
+	/* Keep the original input order around, so that every iteration
+	 * sorts identical input. Restoring is not included in the timings.
+	 * The permutation is recovered from the original order too, and
+	 * the --unique output is checked against it. */
+	if (opts.repeat > 1 || opts.warmup || opts.permutation
+			|| (opts.check_result && opts.unique)) {
+		pristine = alloc_pointers(n);
+		memcpy(pristine, strings, n*string_size());
+	}
+	if (opts.count) {
+		unique_counts = malloc((n ? n : 1)*sizeof(size_t));
+		if (!unique_counts) {
+			fprintf(stderr,
+				"ERROR: unable to allocate memory for the "
+				"counts.\n");
+			exit(1);
+		}
+	}
+	if (opts.lcp) {
+		lcp_array = malloc((n ? n : 1)*sizeof(size_t));
+		if (!lcp_array) {
+			fprintf(stderr,
+				"ERROR: unable to allocate memory for the "
+				"LCP array.\n");
+			exit(1);
+		}
+		fprintf(stderr, "LCP: %s\n", r->f_lcp && !opts.collate
+				? "computed while sorting" : "extra pass");
+	}
+	if (opts.permutation && perm_variant(r)) {
+		perm_array = malloc((n ? n : 1)*sizeof(size_t));
+		if (!perm_array) {
+			fprintf(stderr,
+				"ERROR: unable to allocate memory for the "
+				"permutation.\n");
+			exit(1);
+		}
+		fprintf(stderr, "Permutation: computed while sorting\n");
+	}
+	samples_alloc(opts.repeat);
+	if (opts.warmup)
+		puts("Warming up ...");
+	for (i=0; i < opts.warmup; ++i) {
+		restore_strings(strings, pristine, n);
+		call_routine(r, strings, n);
+	}
 	puts("Timing ...");
-	if (opts.oprofile)
-		opcontrol_start();
-	if (opts.perf_control_fd > 0)
-		perf_control_enable(opts.perf_control_fd);
-	STAP_PROBE2(sortstring, routine_start, r->name, n);
-	timing_start();
-	r->f(strings, n);
-	timing_stop();
-	STAP_PROBE2(sortstring, routine_done, r->name, n);
-	if (opts.oprofile)
-		opcontrol_stop();
-	if (opts.perf_control_fd > 0)
-		perf_control_disable(opts.perf_control_fd);
-	print_timing_results();
+	memtrack_reset();
+	for (i=0; i < opts.repeat; ++i) {
+		if (opts.warmup || i)
+			restore_strings(strings, pristine, n);
+		if (opts.oprofile)
+			opcontrol_start();
+		if (opts.perf_control_fd > 0)
+			perf_control_enable(opts.perf_control_fd);
+		STAP_PROBE2(sortstring, routine_start, r->name, n);
+		if (opts.memtrack)
+			memtrack_start();
+		timing_start();
+		call_routine(r, strings, n);
+		timing_stop();
+		memtrack_stop();
+		STAP_PROBE2(sortstring, routine_done, r->name, n);
+		if (opts.oprofile)
+			opcontrol_stop();
+		if (opts.perf_control_fd > 0)
+			perf_control_disable(opts.perf_control_fd);
+		samples_record();
+	}
+	if (opts.permutation)
+		ret |= permutation_result(strings, pristine, n);
+	print_timing_results(r, n);
+	run_wall_ms = sample_median(0);
+	samples_free();
 	if (opts.check_result) {
-		ret = check_result(strings, n);
+		if (opts.top)
+			ret |= check_result_top(strings, n,
+					opts.top < n ? opts.top : n);
+		else if (opts.unique)
+			ret |= check_result_unique(strings, unique_len,
+					unique_counts, pristine, n);
+		else if (opts.collate)
+			ret |= check_result_collated(strings, n, collation);
+		else
+			ret |= verify_sorted(strings, n, string_size(),
+					offsets_text);
+		if (!opts.unique) {
+			verify_fingerprint(strings, n, string_size(), &after);
+			ret |= verify_permutation(&before, &after);
+		}
+		if (opts.lcp)
+			ret |= check_result_lcp(strings, lcp_array, n,
+					opts.collate ? collation : NULL);
 		if (ret == 0)
 			fprintf(stderr, "Check: GOOD\n");
 	}
+	if (pristine)
+		free_pointers(pristine, n*string_size());
+	if (opts.unique)
+		fprintf(stderr, "Distinct: %zu of %zu strings\n",
+				unique_len, n);
 	if (opts.write)
-		write_result(strings, n);
+		write_result(r, strings, opts.unique ? unique_len
+				: opts.top && opts.top < n ? opts.top : n,
+				string_size());
+	if (opts.lcp_filename)
+		write_values(opts.lcp_filename, "LCP array", lcp_array, n);
+	free(unique_counts);
+	unique_counts = NULL;
+	free(lcp_array);
+	lcp_array = NULL;
+	free(perm_array);
+	perm_array = NULL;
+	return ret;
+}
+
+/* Binds the OpenMP threads to the first `threads' CPUs of the pinning order.
+ * The worker threads are kept alive between parallel regions, so the binding
+ * holds for the following run. */
+static void
+pin_threads(const int *cpus, unsigned cpus_cnt, unsigned threads)
+{
+	(void) threads;
+#ifdef _OPENMP
+	omp_set_num_threads(threads);
+#pragma omp parallel num_threads(threads)
+#endif
+	{
+		unsigned i = 0;
+		cpu_set_t set;
+#ifdef _OPENMP
+		i = omp_get_thread_num();
+#endif
+		CPU_ZERO(&set);
+		CPU_SET(cpus[i % cpus_cnt], &set);
+		if (sched_setaffinity(0, sizeof(set), &set) == -1)
+			fprintf(stderr,
+				"WARNING: unable to bind thread %u to CPU%d: %s\n",
+				i, cpus[i % cpus_cnt], strerror(errno));
+	}
+}
+
+/* Restores the thread count and the original CPU set after a sweep. */
+static void
+unpin_threads(unsigned threads)
+{
+	int maxcpu = -1;
+	size_t setsize = 0;
+	cpu_set_t *cpus = cpus_allowed(&setsize, &maxcpu);
+	(void) threads;
+	if (!cpus)
+		return;
+#ifdef _OPENMP
+	omp_set_num_threads(threads);
+#pragma omp parallel num_threads(threads)
+#endif
+	(void) sched_setaffinity(0, setsize, cpus);
+	CPU_FREE(cpus);
+}
+
+/* Runs a multicore routine at each --threads count, with the threads bound
+ * according to --pin, and prints the speedup and parallel efficiency.
+ * Single core routines are run once, bound to the first CPU if --pin is
+ * given. The original order of the strings is restored between runs. */
+static int
+run_scaling(const struct routine *r, void *strings, size_t n)
+{
+	unsigned default_threads = thread_count(), single_thread = 1;
+	unsigned counts_cnt = opts.threads_cnt;
+	const unsigned *counts = opts.threads;
+	void *pristine = NULL;
+	double *wall_ms;
+	int *cpus = NULL, cpus_cnt = 0;
+	int ret = 0;
+	unsigned i;
+	if (!opts.threads_cnt && opts.pin == CPU_PIN_NONE)
+		return run(r, strings, n);
+	if (!r->multicore || !opts.threads_cnt) {
+		counts = r->multicore ? &default_threads : &single_thread;
+		counts_cnt = 1;
+	}
+	if (opts.pin != CPU_PIN_NONE) {
+		cpus_cnt = cpus_pin_order(opts.pin, &cpus);
+		if (cpus_cnt <= 0) {
+			fprintf(stderr,
+				"ERROR: unable to determine the allowed CPUs.\n");
+			exit(1);
+		}
+	}
+	wall_ms = malloc(counts_cnt*sizeof(double));
+	if (!wall_ms) {
+		fprintf(stderr,
+			"ERROR: unable to allocate memory for the timings.\n");
+		exit(1);
+	}
+	if (counts_cnt > 1) {
+		pristine = alloc_pointers(n);
+		memcpy(pristine, strings, n*string_size());
+	}
+	for (i=0; i < counts_cnt; ++i) {
+		if (i) {
+			memcpy(strings, pristine, n*string_size());
+			puts("");
+		}
+		if (cpus) {
+			if (counts[i] > (unsigned)cpus_cnt)
+				fprintf(stderr,
+					"WARNING: %u threads on %d CPUs, "
+					"CPUs are oversubscribed.\n",
+					counts[i], cpus_cnt);
+			pin_threads(cpus, cpus_cnt, counts[i]);
+			printf("Threads: %u, pin=%s, CPUs:", counts[i],
+					pin_names[opts.pin]);
+			for (unsigned j=0; j < counts[i] && j < (unsigned)cpus_cnt; ++j)
+				printf(" %d", cpus[j]);
+			puts("");
+		} else {
+#ifdef _OPENMP
+			omp_set_num_threads(counts[i]);
+#endif
+			printf("Threads: %u\n", counts[i]);
+		}
+		ret |= run(r, strings, n);
+		wall_ms[i] = run_wall_ms;
+	}
+	if (counts_cnt > 1) {
+		/* Speedup is relative to the first thread count, scaled by it
+		 * when the sweep does not start from a single thread. */
+		printf("\nThread scaling of %s (pin=%s), median wall-clock:\n",
+				r->name, pin_names[opts.pin]);
+		printf("%8s %12s %9s %11s\n",
+				"threads", "ms", "speedup", "efficiency");
+		for (i=0; i < counts_cnt; ++i) {
+			double speedup = wall_ms[i] > 0
+				? wall_ms[0] * counts[0] / wall_ms[i] : 0;
+			printf("%8u %12.2f %9.2f %10.1f%%\n", counts[i],
+				wall_ms[i], speedup, 100.0 * speedup / counts[i]);
+		}
+	}
+	if (cpus)
+		unpin_threads(default_threads);
+#ifdef _OPENMP
+	omp_set_num_threads(default_threads);
+#endif
+	if (pristine)
+		free_pointers(pristine, n*string_size());
+	free(wall_ms);
+	free(cpus);
 	return ret;
 }
 
+/* Parses --threads: comma separated thread counts, "max" is the number of
+ * CPUs available to the process. */
+static int
+parse_threads(const char *list)
+{
+	char *copy = strdup(list), *tok, *saveptr;
+	unsigned cnt = 0;
+	if (!copy)
+		return -1;
+	for (const char *p = list; *p; ++p)
+		if (*p == ',')
+			++cnt;
+	opts.threads = malloc((cnt+1)*sizeof(unsigned));
+	if (!opts.threads) {
+		fprintf(stderr,
+			"ERROR: unable to allocate memory for the thread "
+			"counts.\n");
+		exit(1);
+	}
+	opts.threads_cnt = 0;
+	for (tok = strtok_r(copy, ",", &saveptr); tok;
+			tok = strtok_r(NULL, ",", &saveptr)) {
+		unsigned long v;
+		char *end;
+		if (strcmp(tok, "max") == 0) {
+			v = 1;
+#ifdef _OPENMP
+			v = omp_get_num_procs();
+#endif
+		} else {
+			v = strtoul(tok, &end, 10);
+			if (end == tok || *end != '\0' || v == 0 || v > 65536)
+				goto fail;
+		}
+		opts.threads[opts.threads_cnt++] = v;
+	}
+	free(copy);
+	return opts.threads_cnt ? 0 : -1;
+fail:
+	free(copy);
+	return -1;
+}
+
+/* Sorts the input file with the external memory sort, and writes the result
+ * to the --write file. */
+static int
+run_external(const struct routine *r, const char *filename)
+{
+	struct external_sort_opts eopts;
+	struct external_sort_stats stats;
+	default_write_filename();
+	if (!opts.write_filename) {
+		fprintf(stderr,
+			"ERROR: unable to determine output filename.\n");
+		return 1;
+	}
+	eopts.input = filename;
+	eopts.output = opts.write_filename;
+	eopts.tmpdir = opts.tmpdir;
+	eopts.delim = opts.text_raw ? '\0' : '\n';
+	eopts.memory = opts.external_memory;
+	eopts.block_size = opts.external_block;
+	eopts.check = opts.check_result;
+	puts("Timing ...");
+	samples_alloc(1);
+	memtrack_reset();
+	if (opts.memtrack)
+		memtrack_start();
+	timing_start();
+	external_sort(r, &eopts, &stats);
+	timing_stop();
+	memtrack_stop();
+	samples_record();
+	printf("External sort: %zu strings, %zu runs, %zu merge passes\n",
+			stats.strings, stats.runs, stats.merge_passes);
+	printf("%10.2f ms : run formation\n", stats.run_formation_ms);
+	printf("%10.2f ms : merge\n", stats.merge_ms);
+	print_timing_results(r, stats.strings);
+	samples_free();
+	fprintf(stderr, "Wrote sorted output to '%s'.\n", opts.write_filename);
+	if (opts.check_result) {
+		if (stats.wrong_order) {
+			fprintf(stderr,
+				"WARNING: found %zu incorrect orderings!\n",
+				stats.wrong_order);
+			return 1;
+		}
+		fprintf(stderr, "Check: GOOD\n");
+	}
+	return 0;
+}
+
+/* Parses sizes such as "4096", "64k", "512M" and "2G". */
+static size_t
+parse_size(const char *str)
+{
+	char *end;
+	unsigned long long v = strtoull(str, &end, 10);
+	switch (*end) {
+	case 'k': case 'K': v <<= 10; ++end; break;
+	case 'm': case 'M': v <<= 20; ++end; break;
+	case 'g': case 'G': v <<= 30; ++end; break;
+	}
+	if (end == str || *end != '\0')
+		return 0;
+	return (size_t)v;
+}
+
+/* Parses --alloc: comma separated "thp", "prefault", "local" or
+ * "interleave", and "min=SIZE" for the threshold. */
+static int
+parse_alloc(const char *list)
+{
+	struct big_policy policy = *big_policy_get();
+	char *copy = strdup(list), *tok, *saveptr;
+	if (!copy)
+		return -1;
+	for (tok = strtok_r(copy, ",", &saveptr); tok;
+			tok = strtok_r(NULL, ",", &saveptr)) {
+		if (strcmp(tok, "thp") == 0)
+			policy.thp = 1;
+		else if (strcmp(tok, "prefault") == 0)
+			policy.prefault = 1;
+		else if (strcmp(tok, "local") == 0)
+			policy.numa = BIG_NUMA_LOCAL;
+		else if (strcmp(tok, "interleave") == 0)
+			policy.numa = BIG_NUMA_INTERLEAVE;
+		else if (strncmp(tok, "min=", 4) == 0
+				&& (policy.threshold = parse_size(tok+4)))
+			;
+		else {
+			free(copy);
+			return -1;
+		}
+	}
+	free(copy);
+	big_policy_set(&policy);
+	return 0;
+}
+
 static void
 print_alg_names_and_descs(void)
 {
@@ -502,7 +1808,7 @@ routine_information(const struct routine *r)
 
 static void
 input_information(unsigned char *text, size_t text_len,
-		unsigned char **strings, size_t strings_len)
+		void *strings, size_t strings_len)
 {
 	size_t input_mb = text_len / (1024*1024);
 	size_t input_kb = text_len / 1024;
@@ -515,6 +1821,26 @@ input_information(unsigned char *text, size_t text_len,
 	else
 		printf("    size: %zu bytes\n", text_len);
 	printf("    strings: %zu\n", strings_len);
+	printf("    loading: %.2f ms (%s)\n", input.load_ms,
+			opts.generate ? "generated" : load_names[opts.load]);
+	printf("    parsing: %.2f ms\n", input.parse_ms);
+	if (!opts.length_prefixed && !opts.offsets) {
+		input_features_sample(strings, strings_len, &input.features);
+		printf("    sampled: alphabet %u, distinguishing prefix %.1f, "
+				"duplicates %.1f%%, average length %.1f\n",
+				input.features.alphabet, input.features.dprefix,
+				100*input.features.duplicates,
+				input.features.avg_len);
+	}
+	const struct big_policy *policy = big_policy_get();
+	if (policy->thp || policy->prefault || policy->numa)
+		printf("    large buffers: >= %zu kB%s%s%s\n",
+				policy->threshold / 1024,
+				policy->thp ? ", thp" : "",
+				policy->numa == BIG_NUMA_LOCAL ? ", local"
+				: policy->numa == BIG_NUMA_INTERLEAVE
+				? ", interleave" : "",
+				policy->prefault ? ", prefault" : "");
 	puts("");
 	char *vma_info_text = vma_info(text);
 	char *vma_info_strings = vma_info(strings);
@@ -531,6 +1857,199 @@ input_information(unsigned char *text, size_t text_len,
 	free(vma_info_strings);
 }
 
+static void
+print_histogram(const size_t *histogram, size_t total)
+{
+	for (unsigned b=0; b < ANALYZE_BUCKETS; ++b) {
+		char range[48];
+		if (!histogram[b])
+			continue;
+		if (b <= 1)
+			snprintf(range, sizeof(range), "%u", b);
+		else
+			snprintf(range, sizeof(range), "%llu..%llu",
+					1ULL << (b-1), (1ULL << (b-1))*2 - 1);
+		printf("        %24s : %12zu  %5.1f%%\n", range, histogram[b],
+				100.0 * histogram[b] / total);
+	}
+}
+
+/* Prints the characters present in the input as ranges of byte values. */
+static void
+print_char_ranges(const unsigned char *chars)
+{
+	for (unsigned c=0; c < 256; ++c) {
+		unsigned end = c;
+		if (!chars[c])
+			continue;
+		while (end+1 < 256 && chars[end+1])
+			++end;
+		if (end == c)
+			printf(" 0x%02x", c);
+		else
+			printf(" 0x%02x-0x%02x", c, end);
+		c = end;
+	}
+	puts("");
+}
+
+static void
+analysis_information(unsigned char **strings, size_t n)
+{
+	struct input_analysis a;
+	struct timespec start, stop;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (analyze_strings(strings, n, opts.analyze_sample, &a)) {
+		fprintf(stderr,
+			"ERROR: --analyze: unable to allocate memory.\n");
+		exit(1);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	if (a.n < n)
+		printf("Input analysis (sample of %zu strings", a.n);
+	else
+		printf("Input analysis (exact");
+	printf(", %.2f ms):\n", (stop.tv_sec - start.tv_sec)*1000.0
+			+ (stop.tv_nsec - start.tv_nsec)/1e6);
+	if (a.n == 0) {
+		puts("    no strings\n");
+		return;
+	}
+	printf("    strings: %zu, distinct: %zu, duplicates: %zu (%.2f%%)\n",
+			a.n, a.n - a.duplicates, a.duplicates,
+			100.0 * a.duplicates / a.n);
+	printf("    distinct characters: %u:", a.alphabet);
+	print_char_ranges(a.chars);
+	printf("    length: total %llu, mean %.2f, max %llu\n",
+			a.total_len, (double)a.total_len / a.n, a.max_len);
+	printf("    distinguishing prefix: D=%llu, D/N=%.2f, "
+			"D/length=%.1f%%\n", a.dprefix,
+			(double)a.dprefix / a.n,
+			a.total_len ? 100.0 * a.dprefix / a.total_len : 0.0);
+	if (a.n > 1)
+		printf("    LCP: mean %.2f, max %llu\n",
+				(double)a.lcp_total / (a.n-1), a.lcp_max);
+	if (a.n > 1) {
+		puts("    LCP histogram:");
+		print_histogram(a.lcp_histogram, a.n-1);
+	}
+	puts("    length histogram:");
+	print_histogram(a.len_histogram, a.n);
+	puts("");
+}
+
+/* Matches the routine name against the comma separated list of shell
+ * wildcard patterns given with --routines. */
+static int
+routine_matches(const struct routine *r)
+{
+	char *patterns = strdup(opts.routines);
+	char *pattern, *saveptr;
+	int match = 0;
+	if (!patterns) {
+		fprintf(stderr,
+			"ERROR: unable to allocate memory.\n");
+		exit(1);
+	}
+	for (pattern = strtok_r(patterns, ",", &saveptr); pattern;
+			pattern = strtok_r(NULL, ",", &saveptr))
+		if (fnmatch(pattern, r->name, 0) == 0) {
+			match = 1;
+			break;
+		}
+	free(patterns);
+	return match;
+}
+
+/* Runs the routine in a child process, so that a crashing routine or the
+ * allocator state it leaves behind does not affect the following routines. */
+static int
+run_forked(const struct routine *r, void *strings, size_t n)
+{
+	int status;
+	pid_t pid;
+	fflush(stdout);
+	fflush(stats_file);
+	pid = fork();
+	if (pid == -1) {
+		fprintf(stderr,
+			"ERROR: unable to fork(): %s.\n",
+			strerror(errno));
+		exit(1);
+	}
+	if (pid == 0)
+		exit(run_scaling(r, strings, n));
+	while (waitpid(pid, &status, 0) == -1) {
+		if (errno == EINTR)
+			continue;
+		fprintf(stderr,
+			"ERROR: unable to waitpid(): %s.\n",
+			strerror(errno));
+		exit(1);
+	}
+	if (WIFSIGNALED(status)) {
+		fprintf(stderr,
+			"WARNING: routine %s terminated by signal %d (%s).\n",
+			r->name, WTERMSIG(status), strsignal(WTERMSIG(status)));
+		if (log_file)
+			fprintf(log_file,
+				"Routine %s terminated by signal %d.\n",
+				r->name, WTERMSIG(status));
+		return 1;
+	}
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+}
+
+/* Runs every routine matching --routines with the same input. The original
+ * order of the strings is restored before each routine. */
+static int
+run_routines(void *strings, size_t n)
+{
+	const struct routine **routines;
+	unsigned i, routines_cnt, matched = 0;
+	void *pristine;
+	int ret = 0;
+	pristine = alloc_pointers(n);
+	memcpy(pristine, strings, n*string_size());
+	routine_get_all(&routines, &routines_cnt);
+	for (i=0; i < routines_cnt; ++i) {
+		const struct routine *r = routines[i];
+		if (!routine_matches(r))
+			continue;
+		if (opts.length_prefixed && !r->f_binary)
+			continue;
+		if (opts.offsets && !r->f_offset)
+			continue;
+		if (opts.top && !r->f_top)
+			continue;
+		if (opts.unique && !r->f_unique)
+			continue;
+		if (opts.collate && !r->f_collate)
+			continue;
+		if (r->suffixes_only && !opts.suffixsorting)
+			continue;
+		if (matched++) {
+			memcpy(strings, pristine, n*string_size());
+			puts("");
+		}
+		routine_information(r);
+		if (log_file)
+			fprintf(log_file, "Routine: %s\n", r->name);
+		if (opts.fork)
+			ret |= run_forked(r, strings, n);
+		else
+			ret |= run_scaling(r, strings, n);
+	}
+	free_pointers(pristine, n*string_size());
+	if (matched == 0) {
+		fprintf(stderr,
+			"ERROR: no match found for routines '%s'!\n",
+			opts.routines);
+		return 1;
+	}
+	return ret;
+}
+
 static void
 cpu_information(void)
 {
@@ -569,14 +2088,24 @@ usage(void)
 	     "--------------\n"
 	     "\n"
 	     "Usage: ./sortstring [options] <algorithm> <filename>\n"
+	     "       ./sortstring [options] --all <filename>\n"
+	     "       ./sortstring [options] --routines=PATTERN[,PATTERN...] <filename>\n"
+	     "\n"
+	     "With --generate=SPEC, the <filename> argument is omitted.\n"
 	     "\n"
 	     "Options:\n"
-	     "   --check          : Tries to check output for validity. Might not catch\n"
-	     "                      all errors. Prints a warning when errors found.\n"
+	     "   --check          : Checks the order of the output in parallel, and that\n"
+	     "                      it is a permutation of the input by comparing\n"
+	     "                      fingerprints of the string pointers. Prints a\n"
+	     "                      warning when errors found.\n"
 	     "   --perf-ctrl-fd=FD  Use file descriptor to control perf tool.\n"
 	     "                      Enable perf just before sorting algorithm is called,\n"
 	     "                      and disable after returning from the call.\n"
 	     "                      See perf --control option.\n"
+	     "   --perf-counters  : Measure cycles, instructions, LLC-load-misses,\n"
+	     "                      dTLB-load-misses and branch-misses of the sorting\n"
+	     "                      algorithm call with perf_event_open(), including\n"
+	     "                      all threads it creates.\n"
 	     "   --oprofile       : Executes `oprofile --start' just before calling the\n"
 	     "                      actual sorting algorithm, and `oprofile --stop' after\n"
 	     "                      returning from the call. Can be used to obtain more\n"
@@ -586,16 +2115,160 @@ usage(void)
 	     "                      Example:\n"
 	     "                         for N in `./sortstring -L` ; do\n"
 	     "                                   ./sortstring $N input ; done\n"
+	     "   --all            : Run all algorithms with the same input. The input is\n"
+	     "                      read only once, and its original order is restored\n"
+	     "                      before each algorithm.\n"
+	     "   --routines=PATTERN\n"
+	     "                    : Like --all, but only run the algorithms whose names\n"
+	     "                      match any of the comma separated shell wildcard\n"
+	     "                      patterns, e.g. --routines='msd_CE*,mergesort_lcp*'\n"
+	     "   --fork           : With --all or --routines, run each algorithm in a\n"
+	     "                      child process. Isolates crashes and allocator state.\n"
 	     "   --suffix-sorting : Treat input as text, and sort each suffix of the text.\n"
-	     "                      Can be _very_ slow.\n"
+	     "                      Can be _very_ slow with the string sorting\n"
+	     "                      algorithms. suffix_array_sais builds the suffix\n"
+	     "                      array in linear time, and\n"
+	     "                      suffix_array_doubling_parallel in O(n log n)\n"
+	     "                      time. These two need --suffix-sorting input.\n"
 	     "   --write          : Writes sorted output to `/tmp/$USERNAME/alg.out'\n"
 	     "   --write=outfile  : Writes sorted output to `outfile'\n"
+	     "                      With --all or --routines, the routine name is\n"
+	     "                      appended, e.g. `outfile.msd_CE2'\n"
+	     "   --write-mode=MODE: How --write writes the output:\n"
+	     "                        writev   - gather into large writev() batches\n"
+	     "                                   (default)\n"
+	     "                        direct   - aligned buffers with O_DIRECT\n"
+	     "                        parallel - threads pwrite() ranges of the\n"
+	     "                                   output into a preallocated file\n"
 	     "   --xml-stats      : Outputs statistics in XML (default: human readable)\n"
+	     "   --json-stats     : Outputs statistics in JSON, one record per line.\n"
+	     "                      With --xml-stats or --json-stats, the statistics\n"
+	     "                      are the only output to stdout, other information\n"
+	     "                      is printed to stderr.\n"
+	     "   --repeat=N       : Sort the input N times, restoring the original input\n"
+	     "                      order before each run. Reports min/median/p90/max\n"
+	     "                      of each timer. Default: 1.\n"
+	     "   --warmup=M       : Sort the input M times before the timed runs.\n"
+	     "                      Default: 0.\n"
+	     "   --threads=N,M,...: Run multicore algorithms with each number of threads\n"
+	     "                      and report the speedup and parallel efficiency,\n"
+	     "                      e.g. --threads=1,2,4,8,max. Requires OpenMP.\n"
+	     "   --pin=POLICY     : Bind the threads to the allowed CPUs:\n"
+	     "                        compact - fill SMT siblings and cores first\n"
+	     "                        scatter - spread over cores and packages\n"
+	     "                        numa    - spread over NUMA nodes\n"
+	     "   --analyze[=N]    : Characterize the input before sorting: duplicates,\n"
+	     "                      alphabet, distinguishing prefix, LCP and length\n"
+	     "                      histograms. Exact, or estimated from a sample of\n"
+	     "                      N strings. The algorithm is optional.\n"
+	     "   --memtrack       : Track the memory allocations of the algorithm:\n"
+	     "                      peak allocated bytes, number of allocations and\n"
+	     "                      a histogram of allocation sizes. Counts the malloc\n"
+	     "                      family, mmap and mremap, but not memory that the C\n"
+	     "                      library allocates internally.\n"
 	     "   --hugetlb-text   : Place the input text into huge pages.\n"
 	     "   --hugetlb-ptrs   : Place the string pointer array into huge pages.\n"
+	     "   --load=MODE      : How the input file is loaded:\n"
+	     "                        read     : serial read() loop (default)\n"
+	     "                        parallel : parallel pread() of 8 MB chunks\n"
+	     "                                   into huge pages, each chunk is\n"
+	     "                                   parsed as soon as it is read\n"
+	     "                        populate : with --raw, map the file with\n"
+	     "                                   MAP_POPULATE\n"
+	     "                        willneed : with --raw, map the file and\n"
+	     "                                   madvise(MADV_WILLNEED)\n"
+	     "   --alloc=POLICY   : Placement of the text, the string array and the\n"
+	     "                      temporary arrays of the algorithms, a comma\n"
+	     "                      separated list of:\n"
+	     "                        thp        : transparent huge pages\n"
+	     "                        local      : NUMA first touch placement\n"
+	     "                        interleave : interleave over the NUMA nodes\n"
+	     "                        prefault   : touch the pages in parallel when\n"
+	     "                                     allocating\n"
+	     "                        min=SIZE   : only for buffers of at least SIZE\n"
+	     "                                     bytes. Default: 2M.\n"
 	     "                      HugeTLB requires kernel and hardware support.\n"
 	     "   --raw            : The input file is in raw format: strings are delimited\n"
 	     "                      with NULL bytes instead of newlines.\n"
+	     "   --length-prefixed: The input file holds binary strings, each preceded\n"
+	     "                      by its length as a 32-bit little endian integer.\n"
+	     "                      The strings may contain any bytes, including NUL.\n"
+	     "                      Only algorithms with a binary variant can be used,\n"
+	     "                      --write uses the same format.\n"
+	     "   --permutation[=outfile]\n"
+	     "                    : Output the permutation of the sort, i.e. the\n"
+	     "                      input index of each sorted string. Algorithms with\n"
+	     "                      a permutation variant carry the index through the\n"
+	     "                      sort, for the others it is recovered from the\n"
+	     "                      string addresses after sorting. Checked with\n"
+	     "                      --check, and written to `outfile' one index per\n"
+	     "                      line.\n"
+	     "   --top=K          : Only sort the K smallest strings into the first K\n"
+	     "                      positions, --write writes only those. Only\n"
+	     "                      algorithms with a top-K variant can be used. The\n"
+	     "                      burstsort variants still insert every string into\n"
+	     "                      the trie, and only save the sorting of the buckets\n"
+	     "                      and tries past K.\n"
+	     "   --unique         : Collapse equal strings while sorting, --write\n"
+	     "                      writes only the distinct strings.\n"
+	     "   --count          : Like --unique, and --write precedes each distinct\n"
+	     "                      string with its count like `uniq -c'.\n"
+	     "                      Only algorithms with a unique variant can be used.\n"
+	     "   --lcp[=outfile]  : Compute the LCP array of the sorted strings, i.e.\n"
+	     "                      the longest common prefix of each string with its\n"
+	     "                      predecessor, as part of the timed sort. Algorithms\n"
+	     "                      without an LCP variant take an extra pass for it.\n"
+	     "                      With --collate the characters are compared\n"
+	     "                      through the table. Checked with --check, and\n"
+	     "                      written to `outfile' one value per line.\n"
+	     "   --collate=SPEC   : Sort in the byte order of a collation table instead\n"
+	     "                      of the byte values. SPEC is a comma separated list\n"
+	     "                      of `fold' for ASCII case-insensitive order,\n"
+	     "                      `digits-last' for digits after letters, or the\n"
+	     "                      name of a file with a 256 byte table. The table\n"
+	     "                      must map only the NUL byte to 0. Only algorithms\n"
+	     "                      with a collate variant can be used.\n"
+	     "   --offsets        : Sort 32-bit offsets of the strings into the text\n"
+	     "                      instead of pointers. Halves the string array and\n"
+	     "                      temporary arrays, for inputs smaller than 4 GB.\n"
+	     "                      Only algorithms with an offset variant can be used.\n"
+	     "   --external=SIZE  : Sort a file larger than the available memory. The\n"
+	     "                      input is sorted in chunks with the given algorithm,\n"
+	     "                      and the sorted runs are merged into the --write\n"
+	     "                      file. The text, string pointers and I/O blocks use\n"
+	     "                      at most SIZE bytes (e.g. 512M or 4G), as does the\n"
+	     "                      temporary memory of algorithms with a scratch\n"
+	     "                      variant; that of other algorithms is not counted.\n"
+	     "                      Runs are merged in several passes if needed.\n"
+	     "   --external-block=SIZE\n"
+	     "                    : Block size for reading and writing the sorted runs,\n"
+	     "                      limits the maximum string length. The --external\n"
+	     "                      SIZE must be at least 5 blocks. Default: 1M, or\n"
+	     "                      1/8 of the --external SIZE when that is below 8M.\n"
+	     "   --tmpdir=DIR     : Directory for the sorted runs. Default: $TMPDIR\n"
+	     "                      or /tmp.\n"
+	     "   --generate=KIND[,PARAM=VALUE...]\n"
+	     "                    : Generate a synthetic input instead of reading a file.\n"
+	     "                      The same parameters always generate the same input.\n"
+	     "                      Each string is a shared prefix followed by a body.\n"
+	     "                      KIND is one of:\n"
+	     "                        random : random strings over `alphabet' characters\n"
+	     "                        url    : URL-like strings with long shared prefixes\n"
+	     "                        dna    : fixed length strings over ACGT\n"
+	     "                        dups   : `distinct' random strings, many duplicates\n"
+	     "                        zipf   : Zipf distributed words from a vocabulary\n"
+	     "                                 of `distinct' words, exponent `s'\n"
+	     "                        lcp    : very long shared prefix, short random body\n"
+	     "                      PARAMs (numbers accept k/M/G suffixes and 1e9 syntax):\n"
+	     "                        n        : number of strings (1M)\n"
+	     "                        seed     : random seed, an integer (1)\n"
+	     "                        len      : maximum length of the body\n"
+	     "                        minlen   : minimum length of the body\n"
+	     "                        prefix   : length of the shared prefix\n"
+	     "                        prefixes : number of different shared prefixes\n"
+	     "                        alphabet : alphabet size, 1-254\n"
+	     "                        distinct : vocabulary size of dups and zipf\n"
+	     "                        s        : Zipf exponent (1.0)\n"
 	     "\n"
 	     "Examples:\n"
 	     "   # Get list of what is available:\n"
@@ -607,6 +2280,18 @@ usage(void)
 	     "   # Sort all suffixes of of the given text file with quicksort:\n"
 	     "   ./sortstring --check --suffix-sorting quicksort ~/testdata/text\n"
 	     "\n"
+	     "   # Build the suffix array of the given text file, and write its LCP array:\n"
+	     "   ./sortstring --check --suffix-sorting --lcp=lcp.out suffix_array_sais ~/testdata/text\n"
+	     "\n"
+	     "   # Sort hostnames case-insensitively:\n"
+	     "   ./sortstring --check --collate=fold msd_A ~/testdata/hostnames\n"
+	     "\n"
+	     "   # Sort 10M random strings with a 30 byte shared prefix:\n"
+	     "   ./sortstring --generate=random,n=10M,prefix=30 msd_CE7\n"
+	     "\n"
+	     "   # Sort input file with all MSD radix sorts, JSON output:\n"
+	     "   ./sortstring --json-stats --repeat=5 --routines='msd_*' ~/testdata/testfile1\n"
+	     "\n"
 	     "   # Perf tool and control file descriptor:\n"
 	     "   mkfifo ctrl && exec 9<>ctrl && rm ctrl"
 	         " && perf stat --delay=-1 --control=fd:9"
@@ -633,6 +2318,11 @@ int main(int argc, char **argv)
 		usage();
 		return 1;
 	}
+	opts.repeat = 1;
+	opts.tmpdir = getenv("TMPDIR");
+	if (!opts.tmpdir || !*opts.tmpdir)
+		opts.tmpdir = "/tmp";
+	stats_file = stdout;
 	static const struct option long_options[] = {
 		{"help",           0, 0, 1000},
 		{"algs",           0, 0, 'A' },
@@ -646,6 +2336,32 @@ int main(int argc, char **argv)
 		{"hugetlb-ptrs",   0, 0, 1010},
 		{"raw",            0, 0, 1011},
 		{"perf-ctrl-fd",   1, 0, 1012},
+		{"repeat",         1, 0, 1013},
+		{"warmup",         1, 0, 1014},
+		{"perf-counters",  0, 0, 1015},
+		{"json-stats",     0, 0, 1016},
+		{"all",            0, 0, 1017},
+		{"routines",       1, 0, 1018},
+		{"fork",           0, 0, 1019},
+		{"generate",       1, 0, 1020},
+		{"external",       1, 0, 1021},
+		{"external-block", 1, 0, 1022},
+		{"tmpdir",         1, 0, 1023},
+		{"write-mode",     1, 0, 1024},
+		{"memtrack",       0, 0, 1025},
+		{"threads",        1, 0, 1026},
+		{"pin",            1, 0, 1027},
+		{"analyze",        2, 0, 1028},
+		{"length-prefixed",0, 0, 1029},
+		{"offsets",        0, 0, 1030},
+		{"permutation",    2, 0, 1031},
+		{"top",            1, 0, 1032},
+		{"unique",         0, 0, 1033},
+		{"count",          0, 0, 1034},
+		{"lcp",            2, 0, 1035},
+		{"collate",        1, 0, 1036},
+		{"alloc",          1, 0, 1037},
+		{"load",           1, 0, 1038},
 		{0,                0, 0, 0}
 	};
 	while (1) {
@@ -691,64 +2407,464 @@ int main(int argc, char **argv)
 		case 1012:
 			opts.perf_control_fd = atoi(optarg);
 			break;
+		case 1013:
+			if (atoi(optarg) < 1) {
+				fprintf(stderr,
+					"ERROR: --repeat must be at least 1.\n");
+				return 1;
+			}
+			opts.repeat = atoi(optarg);
+			break;
+		case 1014:
+			if (atoi(optarg) < 0) {
+				fprintf(stderr,
+					"ERROR: --warmup must not be negative.\n");
+				return 1;
+			}
+			opts.warmup = atoi(optarg);
+			break;
+		case 1015:
+			opts.perf_counters = 1;
+			break;
+		case 1016:
+			opts.json_stats = 1;
+			break;
+		case 1017:
+			opts.routines = "*";
+			break;
+		case 1018:
+			opts.routines = optarg;
+			break;
+		case 1019:
+			opts.fork = 1;
+			break;
+		case 1020:
+			opts.generate = optarg;
+			break;
+		case 1021:
+			opts.external_memory = parse_size(optarg);
+			if (opts.external_memory == 0) {
+				fprintf(stderr,
+					"ERROR: invalid --external size '%s'.\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 1022:
+			opts.external_block = parse_size(optarg);
+			if (opts.external_block < 4096) {
+				fprintf(stderr,
+					"ERROR: invalid --external-block size "
+					"'%s', minimum is 4k.\n", optarg);
+				return 1;
+			}
+			break;
+		case 1023:
+			opts.tmpdir = optarg;
+			break;
+		case 1024:
+			if (output_mode_parse(optarg, &opts.write_mode)) {
+				fprintf(stderr,
+					"ERROR: unknown --write-mode '%s'.\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 1025:
+			opts.memtrack = 1;
+			break;
+		case 1026:
+#ifndef _OPENMP
+			fprintf(stderr,
+				"ERROR: --threads requires OpenMP support, "
+				"build with CMAKE_BUILD_TYPE=Release.\n");
+			return 1;
+#endif
+			if (parse_threads(optarg)) {
+				fprintf(stderr,
+					"ERROR: invalid --threads list '%s'.\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 1027:
+			for (opts.pin = CPU_PIN_COMPACT; opts.pin <= CPU_PIN_NUMA;
+					++opts.pin)
+				if (strcmp(optarg, pin_names[opts.pin]) == 0)
+					break;
+			if (opts.pin > CPU_PIN_NUMA) {
+				fprintf(stderr,
+					"ERROR: unknown --pin policy '%s'.\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 1028:
+			opts.analyze = 1;
+			if (optarg) {
+				opts.analyze_sample = parse_size(optarg);
+				if (!opts.analyze_sample) {
+					fprintf(stderr,
+						"ERROR: invalid --analyze sample "
+						"size '%s'.\n", optarg);
+					return 1;
+				}
+			}
+			break;
+		case 1029:
+			opts.length_prefixed = 1;
+			break;
+		case 1030:
+			opts.offsets = 1;
+			break;
+		case 1031:
+			opts.permutation = 1;
+			opts.permutation_filename = optarg;
+			break;
+		case 1032:
+			opts.top = parse_size(optarg);
+			if (!opts.top) {
+				fprintf(stderr,
+					"ERROR: invalid --top count '%s'.\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 1033:
+			opts.unique = 1;
+			break;
+		case 1034:
+			opts.unique = 1;
+			opts.count = 1;
+			break;
+		case 1035:
+			opts.lcp = 1;
+			opts.lcp_filename = optarg;
+			break;
+		case 1036:
+			if (collation_parse(optarg, collation) == -1) {
+				fprintf(stderr,
+					"ERROR: invalid --collate table '%s': "
+					"%s.\n", optarg, strerror(errno));
+				return 1;
+			}
+			opts.collate = 1;
+			break;
+		case 1037:
+			if (parse_alloc(optarg)) {
+				fprintf(stderr,
+					"ERROR: invalid --alloc policy '%s'.\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 1038:
+			for (opts.load = LOAD_READ; opts.load <= LOAD_WILLNEED;
+					++opts.load)
+				if (strcmp(optarg, load_names[opts.load]) == 0)
+					break;
+			if (opts.load > LOAD_WILLNEED) {
+				fprintf(stderr,
+					"ERROR: unknown --load mode '%s'.\n",
+					optarg);
+				return 1;
+			}
+			break;
 		case '?':
 		default:
 			break;
 		}
 	}
-	if (argc - 2 != optind) {
+	if (opts.external_memory && (opts.routines || opts.generate
+			|| opts.suffixsorting || opts.repeat > 1 || opts.warmup)) {
 		fprintf(stderr,
-			"ERROR: wrong number of arguments.\n");
+			"ERROR: --external cannot be combined with --all, "
+			"--routines, --generate, --suffix-sorting, --repeat "
+			"or --warmup.\n");
+		return 1;
+	}
+	if (opts.external_memory && !opts.external_block) {
+		opts.external_block = opts.external_memory / 8 / 4096 * 4096;
+		if (opts.external_block > 1024*1024)
+			opts.external_block = 1024*1024;
+		if (opts.external_block < 4096)
+			opts.external_block = 4096;
+	}
+	if (opts.external_memory
+			&& opts.external_memory / opts.external_block < 5) {
+		fprintf(stderr,
+			"ERROR: --external size must be at least 5 times the "
+			"--external-block size of %zu bytes.\n",
+			opts.external_block);
+		return 1;
+	}
+	if (opts.external_memory && (opts.threads_cnt || opts.pin)) {
+		fprintf(stderr,
+			"ERROR: --external cannot be combined with --threads "
+			"or --pin.\n");
+		return 1;
+	}
+	if (opts.analyze && (opts.external_memory || opts.suffixsorting)) {
+		fprintf(stderr,
+			"ERROR: --analyze cannot be combined with --external "
+			"or --suffix-sorting.\n");
+		return 1;
+	}
+	if (opts.length_prefixed && (opts.text_raw || opts.suffixsorting
+			|| opts.generate || opts.external_memory
+			|| opts.analyze)) {
+		fprintf(stderr,
+			"ERROR: --length-prefixed cannot be combined with "
+			"--raw, --suffix-sorting, --generate, --external "
+			"or --analyze.\n");
+		return 1;
+	}
+	if (opts.top && (opts.length_prefixed || opts.offsets
+			|| opts.external_memory)) {
+		fprintf(stderr,
+			"ERROR: --top cannot be combined with --length-prefixed, "
+			"--offsets or --external.\n");
+		return 1;
+	}
+	if (opts.unique && (opts.length_prefixed || opts.offsets
+			|| opts.external_memory || opts.top || opts.permutation)) {
+		fprintf(stderr,
+			"ERROR: --unique and --count cannot be combined with "
+			"--length-prefixed, --offsets, --external, --top or "
+			"--permutation.\n");
+		return 1;
+	}
+	if (opts.lcp && (opts.length_prefixed || opts.offsets
+			|| opts.external_memory || opts.top || opts.unique)) {
+		fprintf(stderr,
+			"ERROR: --lcp cannot be combined with --length-prefixed, "
+			"--offsets, --external, --top, --unique or --count.\n");
+		return 1;
+	}
+	if (opts.collate && (opts.length_prefixed || opts.offsets
+			|| opts.external_memory || opts.top || opts.unique)) {
+		fprintf(stderr,
+			"ERROR: --collate cannot be combined with "
+			"--length-prefixed, --offsets, --external, --top, "
+			"--unique or --count.\n");
+		return 1;
+	}
+	if (opts.load && (opts.generate || opts.external_memory)) {
+		fprintf(stderr,
+			"ERROR: --load cannot be combined with --generate or "
+			"--external.\n");
 		return 1;
 	}
-	const char *algorithm = argv[optind];
-	if (!algorithm || strlen(algorithm) == 0) {
+	if ((opts.load == LOAD_POPULATE || opts.load == LOAD_WILLNEED)
+			&& (!opts.text_raw || opts.hugetlb_text)) {
 		fprintf(stderr,
-			"ERROR: please specify algorithm name.\n");
+			"ERROR: --load=%s needs --raw input that is mapped, "
+			"without --hugetlb-text.\n", load_names[opts.load]);
 		return 1;
 	}
-	opts.r = routine_from_name(algorithm);
-	if (!opts.r) {
+	if (opts.permutation && opts.external_memory) {
 		fprintf(stderr,
-			"ERROR: no match found for algorithm '%s'!\n",
-			algorithm);
+			"ERROR: --permutation cannot be combined with "
+			"--external.\n");
 		return 1;
 	}
-	const char *filename = argv[optind+1];
+	if (opts.offsets && (opts.length_prefixed || opts.suffixsorting
+			|| opts.external_memory || opts.analyze)) {
+		fprintf(stderr,
+			"ERROR: --offsets cannot be combined with "
+			"--length-prefixed, --suffix-sorting, --external "
+			"or --analyze.\n");
+		return 1;
+	}
+	/* With --analyze, the algorithm is optional. */
+	int need_algorithm = !opts.routines && !(opts.analyze
+			&& argc - (opts.generate ? 0 : 1) == optind);
+	if (argc - need_algorithm - (opts.generate ? 0 : 1) != optind) {
+		fprintf(stderr,
+			"ERROR: wrong number of arguments.\n");
+		return 1;
+	}
+	if (need_algorithm) {
+		const char *algorithm = argv[optind++];
+		if (!algorithm || strlen(algorithm) == 0) {
+			fprintf(stderr,
+				"ERROR: please specify algorithm name.\n");
+			return 1;
+		}
+		opts.r = routine_from_name(algorithm);
+		if (!opts.r) {
+			fprintf(stderr,
+				"ERROR: no match found for algorithm '%s'!\n",
+				algorithm);
+			return 1;
+		}
+		if (opts.length_prefixed && !opts.r->f_binary) {
+			fprintf(stderr,
+				"ERROR: algorithm '%s' cannot sort "
+				"--length-prefixed input!\n", algorithm);
+			return 1;
+		}
+		if (opts.unique && !opts.r->f_unique) {
+			fprintf(stderr,
+				"ERROR: algorithm '%s' cannot sort --unique!\n",
+				algorithm);
+			return 1;
+		}
+		if (opts.top && !opts.r->f_top) {
+			fprintf(stderr,
+				"ERROR: algorithm '%s' cannot sort --top!\n",
+				algorithm);
+			return 1;
+		}
+		if (opts.offsets && !opts.r->f_offset) {
+			fprintf(stderr,
+				"ERROR: algorithm '%s' cannot sort "
+				"--offsets!\n", algorithm);
+			return 1;
+		}
+		if (opts.collate && !opts.r->f_collate) {
+			fprintf(stderr,
+				"ERROR: algorithm '%s' cannot sort "
+				"--collate!\n", algorithm);
+			return 1;
+		}
+		if (opts.r->suffixes_only && !opts.suffixsorting) {
+			fprintf(stderr,
+				"ERROR: algorithm '%s' needs "
+				"--suffix-sorting!\n", algorithm);
+			return 1;
+		}
+	}
+	const char *filename = opts.generate ? opts.generate : argv[optind];
 	if (!filename || strlen(filename) == 0) {
 		fprintf(stderr,
 			"ERROR: please specify input filename.\n");
 		return 1;
 	}
+	struct generate_params generate_params;
+	if (opts.generate && generate_parse(opts.generate, &generate_params) == -1)
+		return 1;
+	/* Open the counters before any threads are created, so that they
+	 * are inherited by the OpenMP worker threads. */
+	if (opts.perf_counters && timing_counters_open() == 0)
+		fprintf(stderr,
+			"WARNING: unable to open any performance counters: "
+			"%s.\n", strerror(errno));
+	/* Keep stdout clean for the machine readable statistics by moving
+	 * all other output to stderr. */
+	if (opts.xml_stats || opts.json_stats) {
+		int stats_fd = dup(STDOUT_FILENO);
+		if (stats_fd == -1 || dup2(STDERR_FILENO, STDOUT_FILENO) == -1
+				|| !(stats_file = fdopen(stats_fd, "w"))) {
+			fprintf(stderr,
+				"ERROR: unable to redirect stdout: %s.\n",
+				strerror(errno));
+			return 1;
+		}
+	}
+	if (opts.xml_stats)
+		fprintf(stats_file, "<events>\n");
 	open_log_file();
 	if (log_file)
 		fprintf(log_file, "===START===\n");
 	print_cmdline(argc, argv, log_file);
-	routine_information(opts.r);
+	if (opts.r)
+		routine_information(opts.r);
 	cpu_information();
-	unsigned long seed = getpid()*time(0);
-	//seed = 0xdeadbeef;
-	srand48(seed);
+	input.seed = getpid()*time(0);
+	//input.seed = 0xdeadbeef;
+	srand48(input.seed);
 	if (log_file)
-		fprintf(log_file, "Random seed: %lu.\n", seed);
-	printf("Input (%s): %s ...\n",
-			opts.text_raw ? "RAW" : "plain",
-			bazename(filename));
+		fprintf(log_file, "Random seed: %lu.\n", input.seed);
+	/* The statistics report the seed that reproduces a generated input. */
+	if (opts.generate)
+		input.seed = generate_params.seed;
+	if (opts.external_memory) {
+		struct stat st;
+		printf("Input (%s, external sort): %s ...\n\n",
+				opts.text_raw ? "RAW" : "plain",
+				bazename(filename));
+		input.filename = filename;
+		if (stat(filename, &st) == 0)
+			input.text_len = st.st_size;
+		ret = run_external(opts.r, filename);
+		if (opts.xml_stats)
+			fprintf(stats_file, "</events>\n");
+		if (opts.perf_counters)
+			timing_counters_close();
+		if (log_file) {
+			fprintf(log_file, "===DONE===\n");
+			fclose(log_file);
+		}
+		return ret;
+	}
 	unsigned char *text;
-	unsigned char **strings;
+	void *strings = NULL;
 	size_t text_len, strings_len;
-	readbytes(filename, &text, &text_len);
-	if (opts.suffixsorting) {
+	struct timespec load_start, load_stop;
+	clock_gettime(CLOCK_MONOTONIC, &load_start);
+	if (opts.generate) {
+		printf("Input (generated): %s ...\n", opts.generate);
+		input_generate(&generate_params, &text, &text_len);
+	} else {
+		printf("Input (%s): %s ...\n",
+				opts.length_prefixed ? "length prefixed"
+				: opts.text_raw ? "RAW" : "plain",
+				bazename(filename));
+		/* The string array is reserved with mmap(), which does not
+		 * work for MAP_HUGETLB. */
+		if (opts.load == LOAD_PARALLEL && !opts.length_prefixed
+				&& !opts.suffixsorting && !opts.hugetlb_pointers)
+			input_load_parallel(filename,
+					opts.text_raw ? '\0' : '\n',
+					&text, &text_len,
+					&strings, &strings_len);
+		else
+			readbytes(filename, &text, &text_len);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &load_stop);
+	input.load_ms = (load_stop.tv_sec - load_start.tv_sec)*1000.0
+		+ (load_stop.tv_nsec - load_start.tv_nsec)/1e6;
+	input.filename = filename;
+	input.text_len = text_len;
+	if (opts.offsets && text_len > UINT32_MAX) {
+		fprintf(stderr,
+			"ERROR: --offsets requires an input smaller than "
+			"4 GB.\n");
+		return 1;
+	}
+	offsets_text = text;
+	struct timespec parse_start, parse_stop;
+	clock_gettime(CLOCK_MONOTONIC, &parse_start);
+	if (opts.length_prefixed) {
+		struct bstring *bstrings;
+		create_bstrings(text, text_len, &bstrings, &strings_len);
+		strings = bstrings;
+	} else if (opts.suffixsorting) {
+		unsigned char **pointers;
 		if (log_file)
 			fprintf(log_file, "Suffix sorting mode!\n");
-		create_suffixes(text, text_len, &strings, &strings_len);
-	} else {
+		create_suffixes(text, text_len, &pointers, &strings_len);
+		strings = pointers;
+	} else if (!strings) {
 		create_strings(text, text_len, &strings, &strings_len);
 	}
+	clock_gettime(CLOCK_MONOTONIC, &parse_stop);
+	input.parse_ms = (parse_stop.tv_sec - parse_start.tv_sec)*1000.0
+		+ (parse_stop.tv_nsec - parse_start.tv_nsec)/1e6;
 	input_information(text, text_len, strings, strings_len);
-	ret = run(opts.r, strings, strings_len);
+	if (opts.analyze)
+		analysis_information(strings, strings_len);
+	if (opts.routines)
+		ret = run_routines(strings, strings_len);
+	else if (opts.r)
+		ret = run_scaling(opts.r, strings, strings_len);
 	free_text(text, text_len);
 	free_pointers(strings, strings_len);
+	if (opts.xml_stats)
+		fprintf(stats_file, "</events>\n");
+	if (opts.perf_counters)
+		timing_counters_close();
 	if (log_file) {
 		fprintf(log_file, "===DONE===\n");
 		fclose(log_file);
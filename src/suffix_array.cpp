@@ -0,0 +1,569 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Suffix array construction for --suffix-sorting.
+ *
+ * Sorting the suffixes of a text with a string sorting algorithm compares them
+ * character by character, which is quadratic on repetitive text. These
+ * routines use the structure of the suffixes instead:
+ *
+ * suffix_array_sais: induced sorting (SA-IS) by Nong, Zhang and Chan. Sorts
+ *   the LMS substrings by induction, names them, recurses on the reduced
+ *   string if the names are not unique, and induces the order of all suffixes
+ *   from the sorted LMS suffixes. Linear time.
+ *
+ * suffix_array_doubling_parallel: prefix doubling in the style of Larsson and
+ *   Sadakane. Buckets the suffixes by their first two characters, sorts the
+ *   buckets by the first eight, and then refines the groups of equal suffixes
+ *   by the rank of the suffix h characters later, doubling h every round.
+ *   Groups that are already sorted are skipped. Small groups are refined in
+ *   parallel, large groups with a parallel sort.
+ *
+ * Both use 32-bit indexes for texts smaller than 4 GB, and store the sorted
+ * suffixes as pointers like the string sorting routines. The LCP variants
+ * compute the LCP array with the algorithm by Kasai et al.
+ *
+ * The input is recognized by the layout of --suffix-sorting, strings[i] ==
+ * strings[0]+i, and the suffixes are ordered as if the text was followed by
+ * a NUL byte. If the text contains NUL bytes, that order is a refinement of
+ * the strcmp() order. Other inputs are sorted with a string sorting routine
+ * after a warning, and sortstring skips the routines unless --suffix-sorting
+ * is given.
+ */
+
+#include "routine.h"
+#include "util/bigalloc.h"
+#include "routines.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#ifdef _OPENMP
+#include <omp.h>
+#include <parallel/algorithm>
+#endif
+
+void msd_CE2(unsigned char**, size_t);
+void msd_CE2_lcp(unsigned char**, size_t, size_t*);
+void mergesort_lcp_2way_parallel(unsigned char**, size_t);
+void mergesort_lcp_2way_parallel_lcp(unsigned char**, size_t, size_t*);
+
+// Returns the text if the strings are all of its suffixes in text order, as
+// created by --suffix-sorting, otherwise NULL. The last suffix must be one
+// character long, or the strings are only the first suffixes of a longer text.
+static unsigned char*
+suffix_text(unsigned char** strings, size_t n)
+{
+	if (n == 0) return 0;
+	for (size_t i=1; i < n; ++i)
+		if (strings[i] != strings[0]+i)
+			return 0;
+	if (strings[n-1][1] != 0)
+		return 0;
+	return strings[0];
+}
+
+static void
+warn_fallback(const char* name, const char* fallback)
+{
+	fprintf(stderr,
+		"WARNING: %s: the input is not the suffixes of a text, "
+		"sorting with %s.\n", name, fallback);
+}
+
+static inline int
+thread_num()
+{
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+static inline int
+num_threads()
+{
+#ifdef _OPENMP
+	return omp_get_num_threads();
+#else
+	return 1;
+#endif
+}
+
+/*******************************************************************************
+ *
+ * SA-IS
+ *
+ ******************************************************************************/
+
+template <typename IndexT, typename CharT>
+static void
+sa_naive(const CharT* s, IndexT n, IndexT* sa)
+{
+	for (IndexT i=0; i < n; ++i)
+		sa[i] = i;
+	std::sort(sa, sa+n, [s, n](IndexT a, IndexT b) {
+		return std::lexicographical_compare(s+a, s+n, s+b, s+n);
+	});
+}
+
+// Sorts the suffixes of s[0..n) over the alphabet [0, upper] into sa. The end
+// of the string is smaller than any character. An S-type suffix is smaller
+// than the suffix that follows it, and an L-type suffix is larger. An LMS
+// suffix is an S-type suffix that follows an L-type suffix.
+template <typename IndexT, typename CharT>
+static void
+sais(const CharT* s, IndexT n, IndexT upper, IndexT* sa)
+{
+	const IndexT empty = IndexT(-1);
+	if (n < 16) {
+		sa_naive(s, n, sa);
+		return;
+	}
+	std::vector<bool> stype(n);
+	for (IndexT i=n-1; i-- > 0; )
+		stype[i] = s[i] == s[i+1] ? stype[i+1] : s[i] < s[i+1];
+	// The L-type suffixes that start with character c are stored from
+	// lstart[c] on, and the S-type suffixes from sstart[c] on. An S-type
+	// suffix is never the largest character, so lstart[c+1] fits.
+	std::vector<IndexT> lstart(upper+1), sstart(upper+1);
+	for (IndexT i=0; i < n; ++i) {
+		if (not stype[i])
+			++sstart[s[i]];
+		else
+			++lstart[s[i]+1];
+	}
+	for (IndexT c=0; c <= upper; ++c) {
+		sstart[c] += lstart[c];
+		if (c < upper) lstart[c+1] += sstart[c];
+	}
+	std::vector<IndexT> bucket(upper+1);
+	// Induces the order of all suffixes from the LMS suffixes in `lms'.
+	auto induce = [&](const std::vector<IndexT>& lms) {
+		std::fill(sa, sa+n, empty);
+		std::copy(sstart.begin(), sstart.end(), bucket.begin());
+		for (IndexT d : lms)
+			sa[bucket[s[d]]++] = d;
+		std::copy(lstart.begin(), lstart.end(), bucket.begin());
+		sa[bucket[s[n-1]]++] = n-1;
+		for (IndexT i=0; i < n; ++i) {
+			const IndexT v = sa[i];
+			if (v != empty and v >= 1 and not stype[v-1])
+				sa[bucket[s[v-1]]++] = v-1;
+		}
+		std::copy(lstart.begin(), lstart.end(), bucket.begin());
+		for (IndexT i=n; i-- > 0; ) {
+			const IndexT v = sa[i];
+			if (v != empty and v >= 1 and stype[v-1])
+				sa[--bucket[s[v-1]+1]] = v-1;
+		}
+	};
+	std::vector<IndexT> lms_index(n, empty);
+	std::vector<IndexT> lms;
+	for (IndexT i=1; i < n; ++i) {
+		if (not stype[i-1] and stype[i]) {
+			lms_index[i] = lms.size();
+			lms.push_back(i);
+		}
+	}
+	const IndexT m = lms.size();
+	induce(lms);
+	if (m == 0) return;
+	// The LMS substrings are now sorted. Name them by their rank, equal
+	// substrings get equal names.
+	std::vector<IndexT> sorted_lms;
+	sorted_lms.reserve(m);
+	for (IndexT i=0; i < n; ++i)
+		if (lms_index[sa[i]] != empty)
+			sorted_lms.push_back(sa[i]);
+	std::vector<IndexT> reduced(m);
+	IndexT name = 0;
+	reduced[lms_index[sorted_lms[0]]] = 0;
+	for (IndexT i=1; i < m; ++i) {
+		IndexT l = sorted_lms[i-1], r = sorted_lms[i];
+		const IndexT end_l = lms_index[l]+1 < m ? lms[lms_index[l]+1] : n;
+		const IndexT end_r = lms_index[r]+1 < m ? lms[lms_index[r]+1] : n;
+		bool same = end_l - l == end_r - r;
+		if (same) {
+			while (l < end_l and s[l] == s[r]) { ++l; ++r; }
+			if (l == n or r == n or s[l] != s[r])
+				same = false;
+		}
+		if (not same) ++name;
+		reduced[lms_index[sorted_lms[i]]] = name;
+	}
+	std::vector<IndexT>().swap(lms_index);
+	std::vector<IndexT> reduced_sa(m);
+	if (name+1 == m) {
+		for (IndexT i=0; i < m; ++i)
+			reduced_sa[reduced[i]] = i;
+	} else {
+		sais<IndexT, IndexT>(reduced.data(), m, name,
+				reduced_sa.data());
+	}
+	for (IndexT i=0; i < m; ++i)
+		sorted_lms[i] = lms[reduced_sa[i]];
+	induce(sorted_lms);
+}
+
+/*******************************************************************************
+ *
+ * Prefix doubling
+ *
+ ******************************************************************************/
+
+// The first eight characters of the suffix at i as a big endian integer,
+// padded with zeroes after the end of the text.
+template <typename IndexT>
+static inline uint64_t
+prefix8(const unsigned char* text, IndexT n, IndexT i)
+{
+	uint64_t key = 0;
+	if (n - i >= 8) {
+		memcpy(&key, text+i, 8);
+		return __builtin_bswap64(key);
+	}
+	for (IndexT j=0; j < 8; ++j)
+		key = key << 8 | (i+j < n ? text[i+j] : 0);
+	return key;
+}
+
+// Groups of equal suffixes are refined by the rank of the suffix h characters
+// later, i.e. the start of its group. Suffixes that end before that are
+// shorter than the rest of their group, and sort by their length.
+template <typename IndexT>
+struct DoublingKey
+{
+	const IndexT* rank;
+	IndexT n, h;
+	uint64_t operator()(IndexT i) const
+	{
+		if (i+h < n) return uint64_t(rank[i+h]) + n + 1;
+		return n - i;
+	}
+};
+
+template <typename IndexT>
+struct Prefix8Key
+{
+	const unsigned char* text;
+	IndexT n;
+	uint64_t operator()(IndexT i) const { return prefix8(text, n, i); }
+};
+
+template <typename IndexT>
+struct Group
+{
+	IndexT begin, size;
+};
+
+// Refines the group with the key, that is cached in the thread local buffer.
+// Stores the new ranks in new_rank, and appends the unsorted subgroups to
+// `unsorted'.
+template <typename IndexT, typename Key>
+static void
+refine_small(IndexT* sa, Group<IndexT> g, const Key& key, IndexT* new_rank,
+		std::vector<std::pair<uint64_t, IndexT>>& buf,
+		std::vector<Group<IndexT>>& unsorted)
+{
+	buf.resize(g.size);
+	for (IndexT i=0; i < g.size; ++i)
+		buf[i] = std::make_pair(key(sa[g.begin+i]), sa[g.begin+i]);
+	std::sort(buf.begin(), buf.end());
+	IndexT start = 0;
+	for (IndexT i=0; i < g.size; ++i) {
+		if (i and buf[i].first != buf[i-1].first) {
+			if (i - start > 1)
+				unsorted.push_back({g.begin+start, i-start});
+			start = i;
+		}
+		sa[g.begin+i] = buf[i].second;
+		new_rank[buf[i].second] = g.begin+start;
+	}
+	if (g.size - start > 1)
+		unsorted.push_back({g.begin+start, g.size-start});
+}
+
+// Same as refine_small(), but for a group that is large enough to be sorted
+// by all threads.
+template <typename IndexT, typename Key>
+static void
+refine_large(IndexT* sa, Group<IndexT> g, const Key& key, IndexT* new_rank,
+		std::vector<Group<IndexT>>& unsorted)
+{
+	IndexT* begin = sa+g.begin;
+	IndexT* end = begin+g.size;
+	auto cmp = [&key](IndexT a, IndexT b) { return key(a) < key(b); };
+#ifdef _OPENMP
+	__gnu_parallel::sort(begin, end, cmp);
+#else
+	std::sort(begin, end, cmp);
+#endif
+	// The group starts are found with a prefix maximum over the chunks of
+	// the threads.
+	const IndexT empty = IndexT(-1);
+	std::vector<IndexT> last_start;
+#pragma omp parallel
+	{
+		const int t = thread_num(), threads = num_threads();
+#pragma omp single
+		last_start.assign(threads, empty);
+		const IndexT b = IndexT(uint64_t(g.size)*t/threads);
+		const IndexT e = IndexT(uint64_t(g.size)*(t+1)/threads);
+		auto head = [&](IndexT i) {
+			return i == 0 or key(begin[i]) != key(begin[i-1]); };
+		for (IndexT i=e; i-- > b; ) {
+			if (head(i)) { last_start[t] = i; break; }
+		}
+#pragma omp barrier
+		IndexT start = 0;
+		for (int u=0; u < t; ++u)
+			if (last_start[u] != empty) start = last_start[u];
+		std::vector<Group<IndexT>> local;
+		for (IndexT i=b; i < e; ++i) {
+			if (head(i)) start = i;
+			new_rank[begin[i]] = g.begin+start;
+			if ((i+1 == g.size or head(i+1)) and i+1-start > 1)
+				local.push_back({g.begin+start, i+1-start});
+		}
+#pragma omp critical
+		unsorted.insert(unsorted.end(), local.begin(), local.end());
+	}
+}
+
+// Refines all groups by the key, and returns the unsorted subgroups.
+template <typename IndexT, typename Key>
+static std::vector<Group<IndexT>>
+refine(IndexT* sa, IndexT* rank, IndexT* new_rank, IndexT n,
+		const std::vector<Group<IndexT>>& groups, const Key& key)
+{
+	const IndexT large = std::max(IndexT(1) << 16, n/64);
+	std::vector<Group<IndexT>> unsorted;
+	for (const Group<IndexT>& g : groups)
+		if (g.size >= large)
+			refine_large(sa, g, key, new_rank, unsorted);
+#pragma omp parallel
+	{
+		std::vector<std::pair<uint64_t, IndexT>> buf;
+		std::vector<Group<IndexT>> local;
+#pragma omp for schedule(dynamic, 256)
+		for (size_t i=0; i < groups.size(); ++i)
+			if (groups[i].size < large)
+				refine_small(sa, groups[i], key, new_rank,
+						buf, local);
+#pragma omp critical
+		unsorted.insert(unsorted.end(), local.begin(), local.end());
+	}
+	// The ranks are updated only after all groups are refined, as the keys
+	// read them.
+#pragma omp parallel for schedule(dynamic, 256)
+	for (size_t i=0; i < groups.size(); ++i)
+		for (IndexT j=0; j < groups[i].size; ++j) {
+			const IndexT s = sa[groups[i].begin+j];
+			rank[s] = new_rank[s];
+		}
+	return unsorted;
+}
+
+// Sorts the suffixes of text[0..n) into sa, and stores the inverse suffix
+// array in rank.
+template <typename IndexT>
+static void
+prefix_doubling(const unsigned char* text, IndexT n, IndexT* sa, IndexT* rank)
+{
+	// Bucket the suffixes by the first two characters.
+	const unsigned buckets = 0x10000;
+	auto bucket = [text, n](IndexT i) -> unsigned {
+		return text[i] << 8 | (i+1 < n ? text[i+1] : 0); };
+	std::vector<IndexT> count;
+	std::vector<Group<IndexT>> groups;
+#pragma omp parallel
+	{
+		const int t = thread_num(), threads = num_threads();
+#pragma omp single
+		count.assign(size_t(buckets)*threads, 0);
+		IndexT* mycount = count.data() + size_t(buckets)*t;
+		const IndexT b = IndexT(uint64_t(n)*t/threads);
+		const IndexT e = IndexT(uint64_t(n)*(t+1)/threads);
+		for (IndexT i=b; i < e; ++i)
+			++mycount[bucket(i)];
+#pragma omp barrier
+#pragma omp single
+		{
+			IndexT sum = 0;
+			for (unsigned c=0; c < buckets; ++c) {
+				const IndexT begin = sum;
+				for (int u=0; u < threads; ++u) {
+					const IndexT cnt = count[size_t(buckets)*u+c];
+					count[size_t(buckets)*u+c] = sum;
+					sum += cnt;
+				}
+				if (sum - begin)
+					groups.push_back({begin, sum-begin});
+			}
+		}
+		for (IndexT i=b; i < e; ++i) {
+			const IndexT pos = mycount[bucket(i)]++;
+			sa[pos] = i;
+		}
+	}
+	std::vector<IndexT>().swap(count);
+	// Singleton buckets are already sorted, the rest are refined by the
+	// first eight characters.
+	std::vector<IndexT> new_rank(n);
+#pragma omp parallel for schedule(dynamic, 256)
+	for (size_t i=0; i < groups.size(); ++i)
+		for (IndexT j=0; j < groups[i].size; ++j)
+			rank[sa[groups[i].begin+j]] = groups[i].begin;
+	groups.erase(std::remove_if(groups.begin(), groups.end(),
+			[](const Group<IndexT>& g) { return g.size == 1; }),
+			groups.end());
+	groups = refine(sa, rank, new_rank.data(), n, groups,
+			Prefix8Key<IndexT>{text, n});
+	for (IndexT h=8; not groups.empty(); h *= 2) {
+		groups = refine(sa, rank, new_rank.data(), n, groups,
+				DoublingKey<IndexT>{rank, n, h});
+	}
+}
+
+/*******************************************************************************
+ *
+ * LCP array
+ *
+ ******************************************************************************/
+
+// Kasai et al.: the LCP of the suffix at i+1 with its predecessor is at least
+// the LCP of the suffix at i minus one. The text positions are split into
+// chunks, that each start over from zero, so that the chunks can be processed
+// in parallel. The LCP ends at a NUL byte like in strcmp().
+template <typename IndexT>
+static void
+kasai(const unsigned char* text, IndexT n, const IndexT* sa,
+		const IndexT* rank, size_t* lcp, bool parallel)
+{
+	const IndexT chunk = 1 << 20;
+	(void) parallel;
+	lcp[0] = 0;
+#pragma omp parallel for schedule(dynamic) if (parallel)
+	for (uint64_t c=0; c < (uint64_t(n)+chunk-1)/chunk; ++c) {
+		IndexT h = 0;
+		const IndexT end = IndexT(std::min<uint64_t>(n, (c+1)*chunk));
+		for (IndexT i=IndexT(c*chunk); i < end; ++i) {
+			const IndexT r = rank[i];
+			if (r == 0) { h = 0; continue; }
+			const IndexT j = sa[r-1];
+			while (i+h < n and j+h < n and text[i+h]
+					and text[i+h] == text[j+h])
+				++h;
+			lcp[r] = h;
+			if (h) --h;
+		}
+	}
+}
+
+/*******************************************************************************
+ *
+ * Routines
+ *
+ ******************************************************************************/
+
+template <typename IndexT>
+static void
+suffix_array_sais(unsigned char** strings, IndexT n, size_t* lcp)
+{
+	unsigned char* text = strings[0];
+	IndexT* sa = static_cast<IndexT*>(big_malloc(n*sizeof(IndexT)));
+	sais<IndexT, unsigned char>(text, n, 0xFF, sa);
+	if (lcp) {
+		IndexT* rank = static_cast<IndexT*>(big_malloc(n*sizeof(IndexT)));
+		for (IndexT i=0; i < n; ++i)
+			rank[sa[i]] = i;
+		kasai(text, n, sa, rank, lcp, false);
+		big_free(rank);
+	}
+	for (IndexT i=0; i < n; ++i)
+		strings[i] = text + sa[i];
+	big_free(sa);
+}
+
+template <typename IndexT>
+static void
+suffix_array_doubling_parallel(unsigned char** strings, IndexT n, size_t* lcp)
+{
+	unsigned char* text = strings[0];
+	IndexT* sa = static_cast<IndexT*>(big_malloc(n*sizeof(IndexT)));
+	IndexT* rank = static_cast<IndexT*>(big_malloc(n*sizeof(IndexT)));
+	prefix_doubling(text, n, sa, rank);
+	if (lcp)
+		kasai(text, n, sa, rank, lcp, true);
+	big_free(rank);
+#pragma omp parallel for
+	for (IndexT i=0; i < n; ++i)
+		strings[i] = text + sa[i];
+	big_free(sa);
+}
+
+void suffix_array_sais_lcp(unsigned char** strings, size_t n, size_t* lcp)
+{
+	if (n == 0) {
+		return;
+	} else if (not suffix_text(strings, n)) {
+		warn_fallback("suffix_array_sais", "msd_CE2");
+		if (lcp) msd_CE2_lcp(strings, n, lcp);
+		else     msd_CE2(strings, n);
+	} else if (n < UINT32_MAX) {
+		suffix_array_sais<uint32_t>(strings, n, lcp);
+	} else {
+		suffix_array_sais<uint64_t>(strings, n, lcp);
+	}
+}
+void suffix_array_sais(unsigned char** strings, size_t n)
+{ suffix_array_sais_lcp(strings, n, 0); }
+ROUTINE_REGISTER_FULL(suffix_array_sais,
+		"SA-IS suffix array construction for --suffix-sorting", 0,
+		ROUTINE_LCP(suffix_array_sais_lcp), ROUTINE_SUFFIXES_ONLY)
+
+void suffix_array_doubling_parallel_lcp(unsigned char** strings, size_t n,
+		size_t* lcp)
+{
+	if (n == 0) {
+		return;
+	} else if (not suffix_text(strings, n)) {
+		warn_fallback("suffix_array_doubling_parallel",
+				"mergesort_lcp_2way_parallel");
+		if (lcp) mergesort_lcp_2way_parallel_lcp(strings, n, lcp);
+		else     mergesort_lcp_2way_parallel(strings, n);
+	} else if (n < UINT32_MAX) {
+		suffix_array_doubling_parallel<uint32_t>(strings, n, lcp);
+	} else {
+		suffix_array_doubling_parallel<uint64_t>(strings, n, lcp);
+	}
+}
+void suffix_array_doubling_parallel(unsigned char** strings, size_t n)
+{ suffix_array_doubling_parallel_lcp(strings, n, 0); }
+ROUTINE_REGISTER_FULL(suffix_array_doubling_parallel,
+		"Parallel prefix doubling suffix array construction for "
+		"--suffix-sorting", 1,
+		ROUTINE_LCP(suffix_array_doubling_parallel_lcp),
+		ROUTINE_SUFFIXES_ONLY)
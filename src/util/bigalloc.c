@@ -0,0 +1,209 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+#include "bigalloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define HUGE_PAGE   (2*1024*1024)
+/* Keeps the memory aligned like malloc(), and mappings to a cache line. */
+#define HEADER_SIZE 64
+
+#define MPOL_INTERLEAVE 3
+#define MPOL_LOCAL      4
+
+struct header {
+	/* Length of the mapping that starts at the header, or 0 if the
+	 * memory is from malloc(). */
+	size_t map_bytes;
+};
+
+static struct big_policy policy = { HUGE_PAGE, 0, 0, BIG_NUMA_DEFAULT };
+
+void
+big_policy_set(const struct big_policy *p)
+{
+	policy = *p;
+}
+
+const struct big_policy *
+big_policy_get(void)
+{
+	return &policy;
+}
+
+static int
+policy_enabled(void)
+{
+	return policy.thp || policy.prefault || policy.numa != BIG_NUMA_DEFAULT;
+}
+
+/* Reads the online nodes, e.g. "0-3,6", into the node mask. Returns the
+ * number of bits in the mask for mbind(), or 0 on failure. */
+static unsigned long
+online_nodes(unsigned long *mask, unsigned long mask_bits)
+{
+	unsigned long maxnode = 0;
+	unsigned a, b;
+	char sep;
+	FILE *fp = fopen("/sys/devices/system/node/online", "r");
+	if (!fp)
+		return 0;
+	memset(mask, 0, mask_bits/8);
+	while (fscanf(fp, "%u", &a) == 1) {
+		b = a;
+		sep = fgetc(fp);
+		if (sep == '-') {
+			if (fscanf(fp, "%u", &b) != 1)
+				break;
+			sep = fgetc(fp);
+		}
+		for (; a <= b && a < mask_bits; ++a) {
+			mask[a / (8*sizeof(long))] |= 1UL << (a % (8*sizeof(long)));
+			if (a+1 > maxnode)
+				maxnode = a+1;
+		}
+		if (sep != ',')
+			break;
+	}
+	fclose(fp);
+	/* The kernel ignores the last bit of maxnode. */
+	return maxnode ? maxnode+1 : 0;
+}
+
+static void
+place(void *p, size_t bytes)
+{
+	unsigned long mask[16];
+	unsigned long maxnode;
+	/* mbind() needs a page aligned start. */
+	uintptr_t start = (uintptr_t)p & ~(uintptr_t)(sysconf(_SC_PAGESIZE)-1);
+	bytes += (uintptr_t)p - start;
+	switch (policy.numa) {
+	case BIG_NUMA_LOCAL:
+		(void) syscall(SYS_mbind, start, bytes, MPOL_LOCAL, NULL, 0, 0);
+		break;
+	case BIG_NUMA_INTERLEAVE:
+		maxnode = online_nodes(mask, 8*sizeof(mask));
+		if (maxnode)
+			(void) syscall(SYS_mbind, start, bytes, MPOL_INTERLEAVE,
+					mask, maxnode, 0);
+		break;
+	default:
+		break;
+	}
+}
+
+void
+big_advise(void *p, size_t bytes)
+{
+	if (!policy_enabled() || bytes < policy.threshold)
+		return;
+	if (policy.thp)
+		(void) madvise(p, bytes, MADV_HUGEPAGE);
+	place(p, bytes);
+	if (policy.prefault) {
+		const size_t page = sysconf(_SC_PAGESIZE);
+		volatile unsigned char *c = p;
+#pragma omp parallel for schedule(static)
+		for (size_t i=0; i < bytes; i += page)
+			c[i] = 0;
+	}
+}
+
+/* Maps at least `bytes', aligned to a huge page with THP, and returns the
+ * length of the mapping in *map_bytes. */
+static void *
+map(size_t bytes, size_t *map_bytes)
+{
+	const size_t align = policy.thp ? HUGE_PAGE : 0;
+	const size_t len = (bytes + HUGE_PAGE-1) & ~(size_t)(HUGE_PAGE-1);
+	unsigned char *p = mmap(NULL, len + align, PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+	if (align) {
+		uintptr_t skip = -(uintptr_t)p & (align-1);
+		if (skip)
+			munmap(p, skip);
+		munmap(p + skip + len, align - skip);
+		p += skip;
+	}
+	*map_bytes = len;
+	return p;
+}
+
+void *
+big_malloc(size_t bytes)
+{
+	struct header *h;
+	size_t map_bytes;
+	if (bytes > SIZE_MAX - HUGE_PAGE)
+		return NULL;
+	if (!policy_enabled() || bytes < policy.threshold) {
+		h = malloc(HEADER_SIZE + bytes);
+		if (!h)
+			return NULL;
+		h->map_bytes = 0;
+		return (unsigned char *)h + HEADER_SIZE;
+	}
+	h = map(HEADER_SIZE + bytes, &map_bytes);
+	if (!h)
+		return NULL;
+	big_advise(h, map_bytes);
+	h->map_bytes = map_bytes;
+	return (unsigned char *)h + HEADER_SIZE;
+}
+
+void *
+big_calloc(size_t nmemb, size_t size)
+{
+	void *p;
+	if (size && nmemb > SIZE_MAX / size)
+		return NULL;
+	p = big_malloc(nmemb * size);
+	if (!p)
+		return NULL;
+	/* Fresh mappings are zeroed by the kernel. */
+	if (((struct header *)((unsigned char *)p - HEADER_SIZE))->map_bytes == 0)
+		memset(p, 0, nmemb * size);
+	return p;
+}
+
+void
+big_free(void *p)
+{
+	struct header *h;
+	if (!p)
+		return;
+	h = (struct header *)((unsigned char *)p - HEADER_SIZE);
+	if (h->map_bytes)
+		munmap(h, h->map_bytes);
+	else
+		free(h);
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Allocator for the large temporary arrays of the sorting routines. Without
+ * a policy it is malloc(). With a policy, buffers of at least `threshold'
+ * bytes are mapped directly, and can be backed by transparent huge pages,
+ * placed on NUMA nodes with mbind() and prefaulted, so that the sort itself
+ * takes fewer TLB misses and page faults. Unlike --hugetlb-text, none of
+ * this needs a preconfigured huge page pool.
+ */
+
+#ifndef BIGALLOC_H
+#define BIGALLOC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum big_numa {
+	/* The kernel default policy of the process. */
+	BIG_NUMA_DEFAULT,
+	/* First touch: each page is placed on the node of the CPU that
+	 * touches it first, regardless of the process policy. */
+	BIG_NUMA_LOCAL,
+	/* Pages are interleaved round-robin over the online nodes. */
+	BIG_NUMA_INTERLEAVE,
+};
+
+struct big_policy {
+	/* Buffers smaller than this always come from malloc(). */
+	size_t threshold;
+	/* madvise(MADV_HUGEPAGE), with the buffer aligned to 2 MB. */
+	unsigned thp      : 1;
+	/* Touch every page in parallel when allocating, so that the page
+	 * faults are taken outside of the sort, by all threads. */
+	unsigned prefault : 1;
+	enum big_numa numa;
+};
+
+/* Sets the policy of the following allocations. Not thread safe, set it
+ * before sorting. */
+void big_policy_set(const struct big_policy *);
+const struct big_policy *big_policy_get(void);
+
+/* Like malloc(), calloc() and free(). The memory of big_malloc() and
+ * big_calloc() must be freed with big_free(), and vice versa. */
+void *big_malloc(size_t bytes);
+void *big_calloc(size_t nmemb, size_t size);
+void big_free(void *);
+
+/* Applies the policy to an existing anonymous mapping that has not been
+ * touched yet, for memory that the caller maps itself. */
+void big_advise(void *, size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BIGALLOC_H */
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "collation.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+static void
+apply_fold(unsigned char *table)
+{
+	for (unsigned i=0; i < 256; ++i)
+		if (table[i] >= 'A' && table[i] <= 'Z')
+			table[i] += 'a' - 'A';
+}
+
+/* Moves the digits after 'z' by renumbering the bytes in the new order:
+ * everything up to 'z' except the digits, the digits, and the rest. */
+static void
+apply_digits_last(unsigned char *table)
+{
+	unsigned char rank[256];
+	unsigned i, r = 0;
+	for (i=0; i <= 'z'; ++i)
+		if (i < '0' || i > '9')
+			rank[i] = r++;
+	for (i='0'; i <= '9'; ++i)
+		rank[i] = r++;
+	for (i='z'+1; i < 256; ++i)
+		rank[i] = r++;
+	for (i=0; i < 256; ++i)
+		table[i] = rank[table[i]];
+}
+
+static int
+apply_file(unsigned char *table, const char *filename)
+{
+	unsigned char file[256];
+	FILE *fp = fopen(filename, "rb");
+	if (!fp)
+		return -1;
+	size_t len = fread(file, 1, sizeof(file), fp);
+	int extra = fgetc(fp);
+	fclose(fp);
+	if (len != sizeof(file) || extra != EOF) {
+		errno = EINVAL;
+		return -1;
+	}
+	for (unsigned i=0; i < 256; ++i)
+		table[i] = file[table[i]];
+	return 0;
+}
+
+int
+collation_valid(const unsigned char *table)
+{
+	if (table[0] != 0)
+		return 0;
+	for (unsigned i=1; i < 256; ++i)
+		if (table[i] == 0)
+			return 0;
+	return 1;
+}
+
+int
+collation_parse(const char *spec, unsigned char *table)
+{
+	char name[4096];
+	for (unsigned i=0; i < 256; ++i)
+		table[i] = i;
+	while (*spec) {
+		size_t len = strcspn(spec, ",");
+		if (len == 0 || len >= sizeof(name)) {
+			errno = EINVAL;
+			return -1;
+		}
+		memcpy(name, spec, len);
+		name[len] = '\0';
+		spec += len;
+		if (*spec == ',')
+			++spec;
+		if (strcmp(name, "fold") == 0)
+			apply_fold(table);
+		else if (strcmp(name, "digits-last") == 0)
+			apply_digits_last(table);
+		else if (apply_file(table, name) == -1)
+			return -1;
+	}
+	if (!collation_valid(table)) {
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Byte collation tables for sorting in a custom byte order, see f_collate in
+ * routine.h. The routines look up every byte in the table, instead of
+ * sorting a transformed copy of the text.
+ */
+
+#ifndef COLLATION_H
+#define COLLATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Builds the 256-entry table from a comma separated list of:
+ *
+ *   fold        : ASCII case folding, 'A'..'Z' sort as 'a'..'z'.
+ *   digits-last : digits sort after the letters and before the bytes above
+ *                 'z'.
+ *   <filename>  : a file of 256 bytes, the table itself.
+ *
+ * The tables are applied from left to right. Returns 0, or -1 with errno
+ * set if the file cannot be read, or to EINVAL if the specification or the
+ * resulting table is not valid. */
+int collation_parse(const char *spec, unsigned char *table);
+
+/* Returns nonzero if the table maps 0 to 0 and no other byte to 0. */
+int collation_valid(const unsigned char *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLATION_H */
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <dirent.h>
 
 static char *
 status_entry(const char *key)
@@ -196,3 +197,148 @@ cpu_scaling_max_freq(int cpu)
 	fclose(fp);
 	return max_freq;
 }
+
+static int
+read_topology_int(int cpu, const char *name)
+{
+	int value;
+	FILE *fp;
+	char *filename = NULL;
+	if (asprintf(&filename,
+		"/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name) == -1)
+		return 0;
+	fp = fopen(filename, "r");
+	free(filename);
+	if (!fp)
+		return 0;
+	if (fscanf(fp, "%d", &value) != 1)
+		value = 0;
+	fclose(fp);
+	return value;
+}
+
+static int
+read_cpu_node(int cpu)
+{
+	int node = 0;
+	DIR *dir;
+	struct dirent *de;
+	char *dirname = NULL;
+	if (asprintf(&dirname, "/sys/devices/system/cpu/cpu%d", cpu) == -1)
+		return 0;
+	dir = opendir(dirname);
+	free(dirname);
+	if (!dir)
+		return 0;
+	while ((de = readdir(dir)) != NULL)
+		if (sscanf(de->d_name, "node%d", &node) == 1)
+			break;
+	closedir(dir);
+	return node;
+}
+
+struct cpu_topology {
+	int cpu;
+	int package;
+	int core;
+	int node;
+	/* Index of the CPU among the SMT siblings of its core. */
+	int smt;
+	/* Index of the core among the cores of its package and NUMA node. */
+	int package_core;
+	int node_core;
+};
+
+static int
+cmp_compact(const void *a, const void *b)
+{
+	const struct cpu_topology *x = a, *y = b;
+	if (x->node != y->node) return x->node - y->node;
+	if (x->package != y->package) return x->package - y->package;
+	if (x->core != y->core) return x->core - y->core;
+	return x->cpu - y->cpu;
+}
+
+static int
+cmp_scatter(const void *a, const void *b)
+{
+	const struct cpu_topology *x = a, *y = b;
+	if (x->smt != y->smt) return x->smt - y->smt;
+	if (x->package_core != y->package_core)
+		return x->package_core - y->package_core;
+	if (x->package != y->package) return x->package - y->package;
+	return x->cpu - y->cpu;
+}
+
+static int
+cmp_numa(const void *a, const void *b)
+{
+	const struct cpu_topology *x = a, *y = b;
+	if (x->smt != y->smt) return x->smt - y->smt;
+	if (x->node_core != y->node_core) return x->node_core - y->node_core;
+	if (x->node != y->node) return x->node - y->node;
+	return x->cpu - y->cpu;
+}
+
+int
+cpus_pin_order(enum cpu_pin pin, int **cpus)
+{
+	int i, j, cnt = 0, maxcpu = -1;
+	size_t setsize = 0;
+	struct cpu_topology *topo;
+	cpu_set_t *allowed = cpus_allowed(&setsize, &maxcpu);
+	if (!allowed)
+		return -1;
+	topo = calloc(maxcpu, sizeof(struct cpu_topology));
+	*cpus = malloc(maxcpu * sizeof(int));
+	if (!topo || !*cpus) {
+		free(topo);
+		free(*cpus);
+		CPU_FREE(allowed);
+		return -1;
+	}
+	for (i=0; i < maxcpu; ++i) {
+		if (!CPU_ISSET_S(i, setsize, allowed))
+			continue;
+		topo[cnt].cpu = i;
+		topo[cnt].package = read_topology_int(i, "physical_package_id");
+		topo[cnt].core = read_topology_int(i, "core_id");
+		topo[cnt].node = read_cpu_node(i);
+		++cnt;
+	}
+	CPU_FREE(allowed);
+	/* The number of CPUs is small, quadratic loops are fine here. */
+	for (i=0; i < cnt; ++i) {
+		for (j=0; j < cnt; ++j) {
+			int same_core = topo[j].package == topo[i].package
+				&& topo[j].core == topo[i].core;
+			if (same_core && topo[j].cpu < topo[i].cpu)
+				++topo[i].smt;
+		}
+	}
+	for (i=0; i < cnt; ++i) {
+		for (j=0; j < cnt; ++j) {
+			if (topo[j].smt != 0 || topo[j].core >= topo[i].core)
+				continue;
+			if (topo[j].package == topo[i].package)
+				++topo[i].package_core;
+			if (topo[j].node == topo[i].node)
+				++topo[i].node_core;
+		}
+	}
+	switch (pin) {
+	case CPU_PIN_SCATTER:
+		qsort(topo, cnt, sizeof(*topo), cmp_scatter);
+		break;
+	case CPU_PIN_NUMA:
+		qsort(topo, cnt, sizeof(*topo), cmp_numa);
+		break;
+	default:
+		qsort(topo, cnt, sizeof(*topo), cmp_compact);
+		break;
+	}
+	for (i=0; i < cnt; ++i)
+		(*cpus)[i] = topo[i].cpu;
+	free(topo);
+	return cnt;
+}
@@ -31,4 +31,21 @@ cpu_set_t *cpus_allowed(size_t *, int *maxcpu);
 int cpu_scaling_max_freq(int cpu);
 int cpu_scaling_min_freq(int cpu);
 
+/* Orders for binding threads to the allowed CPUs:
+ *   compact : fill the SMT siblings of a core, then the cores of a package
+ *   scatter : one thread per core, round robin over the packages, and the
+ *             SMT siblings only after every core has a thread
+ *   numa    : as scatter, but round robin over the NUMA nodes
+ */
+enum cpu_pin {
+	CPU_PIN_NONE,
+	CPU_PIN_COMPACT,
+	CPU_PIN_SCATTER,
+	CPU_PIN_NUMA,
+};
+
+/* Returns the number of allowed CPUs, and stores them to *cpus in the order
+ * given by the pinning policy. Returns -1 on failure. */
+int cpus_pin_order(enum cpu_pin, int **cpus);
+
 #endif /* CPUS_ALLOWED_H */
@@ -25,6 +25,9 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "bstring.h"
 
 #ifdef __cplusplus
 #include <iostream>
@@ -69,4 +72,187 @@ check_result(unsigned char **strings, size_t n)
 	return 0;
 }
 
+/* Checks that the first k strings are sorted, and that none of the rest
+ * sorts before them. */
+static inline int
+check_result_top(unsigned char **strings, size_t n, size_t k)
+{
+	size_t wrong = 0;
+	if (k == 0)
+		return 0;
+	if (check_result(strings, k))
+		return 1;
+	for (size_t i=k; i < n; ++i)
+		if (strcmp((char*)strings[k-1], (char*)strings[i]) > 0)
+			++wrong;
+	if (wrong) {
+		fprintf(stderr,
+			"WARNING: found %zu strings after the top %zu that "
+			"sort before them!\n", wrong, k);
+		return 1;
+	}
+	return 0;
+}
+
+/* Checks the output of --unique against the n input strings: the m distinct
+ * strings are in strictly increasing order, every input string is one of
+ * them, and the counts, if any, are the numbers of occurrences. */
+static inline int
+check_result_unique(unsigned char **strings, size_t m, const size_t *counts,
+		unsigned char **input, size_t n)
+{
+	size_t wrong = 0, missing = 0, miscounted = 0;
+	size_t *occurrences;
+	for (size_t i=1; i < m; ++i)
+		if (strcmp((char*)strings[i-1], (char*)strings[i]) >= 0)
+			++wrong;
+	if (wrong) {
+		fprintf(stderr,
+			"WARNING: found %zu incorrect orderings or duplicates!\n",
+			wrong);
+		return 1;
+	}
+	occurrences = (size_t *)calloc(m ? m : 1, sizeof(size_t));
+	if (!occurrences) {
+		fprintf(stderr,
+			"WARNING: unable to allocate memory for checking the "
+			"distinct strings.\n");
+		return 1;
+	}
+	for (size_t i=0; i < n; ++i) {
+		size_t lo = 0, hi = m;
+		int c = 1;
+		while (lo < hi) {
+			size_t mid = lo + (hi-lo)/2;
+			c = strcmp((char*)strings[mid], (char*)input[i]);
+			if (c == 0) {
+				lo = mid;
+				break;
+			}
+			if (c < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (c == 0)
+			++occurrences[lo];
+		else
+			++missing;
+	}
+	for (size_t i=0; i < m; ++i)
+		if (occurrences[i] == 0 || (counts && counts[i] != occurrences[i]))
+			++miscounted;
+	free(occurrences);
+	if (missing)
+		fprintf(stderr,
+			"WARNING: found %zu input strings missing from the "
+			"output!\n", missing);
+	if (miscounted)
+		fprintf(stderr,
+			"WARNING: found %zu distinct strings with %s!\n",
+			miscounted, counts ? "incorrect counts"
+			: "no occurrence in the input");
+	if (missing || miscounted)
+		return 1;
+	return 0;
+}
+
+/* Checks the LCP array of sorted strings: lcp[0] is 0, and lcp[i] is the
+ * length of the longest common prefix of strings[i-1] and strings[i]. If
+ * table is not NULL, the prefix is compared through the collation table. */
+static inline int
+check_result_lcp(unsigned char **strings, const size_t *lcp, size_t n,
+		const unsigned char *table)
+{
+	size_t wrong = 0;
+	if (n && lcp[0] != 0)
+		++wrong;
+	for (size_t i=1; i < n; ++i) {
+		const unsigned char *a = strings[i-1], *b = strings[i];
+		size_t h = 0;
+		if (table)
+			while (a[h] && table[a[h]] == table[b[h]])
+				++h;
+		else
+			while (a[h] && a[h] == b[h])
+				++h;
+		if (lcp[i] != h)
+			++wrong;
+	}
+	if (wrong) {
+		fprintf(stderr,
+			"WARNING: found %zu incorrect LCP values!\n",
+			wrong);
+		return 1;
+	}
+	return 0;
+}
+
+/* Checks that the strings are sorted in the byte order of the collation
+ * table, see f_collate in routine.h. */
+static inline int
+check_result_collated(unsigned char **strings, size_t n,
+		const unsigned char *table)
+{
+	size_t wrong = 0;
+	for (size_t i=1; i < n; ++i) {
+		const unsigned char *a = strings[i-1], *b = strings[i];
+		while (*a && table[*a] == table[*b]) {
+			++a;
+			++b;
+		}
+		if (table[*a] > table[*b])
+			++wrong;
+	}
+	if (wrong) {
+		fprintf(stderr,
+			"WARNING: found %zu incorrect orderings!\n",
+			wrong);
+		return 1;
+	}
+	return 0;
+}
+
+static inline int
+check_result_binary(const struct bstring *strings, size_t n)
+{
+	size_t wrong = 0;
+	for (size_t i=1; i < n; ++i)
+		if (bstring_cmp(&strings[i-1], &strings[i]) > 0)
+			++wrong;
+	if (wrong) {
+		fprintf(stderr,
+			"WARNING: found %zu incorrect orderings!\n",
+			wrong);
+		return 1;
+	}
+	return 0;
+}
+
+static inline int
+check_result_offsets(const unsigned char *text, const uint32_t *offsets,
+		size_t n)
+{
+	size_t wrong = 0;
+	size_t identical = 0;
+	for (size_t i=1; i < n; ++i) {
+		if (offsets[i-1] == offsets[i])
+			++identical;
+		else if (strcmp((const char*)text+offsets[i-1],
+				(const char*)text+offsets[i]) > 0)
+			++wrong;
+	}
+	if (identical)
+		fprintf(stderr,
+			"WARNING: found %zu identical offsets!\n",
+			identical);
+	if (wrong)
+		fprintf(stderr,
+			"WARNING: found %zu incorrect orderings!\n",
+			wrong);
+	if (identical || wrong)
+		return 1;
+	return 0;
+}
+
 #endif //UTIL_DEBUG_H
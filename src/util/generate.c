@@ -0,0 +1,395 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Synthetic inputs for benchmarking without data files. The content is
+ * generated with a private PRNG, so that a given specification produces the
+ * same input on every machine.
+ *
+ * The string lengths, prefixes and vocabulary ranks are drawn from a
+ * separate PRNG stream than the characters. This allows computing the exact
+ * size of the input in a cheap first pass, and then filling the text in a
+ * second pass that reproduces the same lengths.
+ */
+
+#define _GNU_SOURCE
+#include "generate.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+struct rng {
+	uint64_t s;
+};
+
+static uint64_t
+splitmix64(uint64_t *x)
+{
+	uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static void
+rng_init(struct rng *r, uint64_t seed, uint64_t stream)
+{
+	uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+	r->s = splitmix64(&x);
+	if (r->s == 0)
+		r->s = 1;
+}
+
+/* xorshift64* */
+static inline uint64_t
+rng_next(struct rng *r)
+{
+	r->s ^= r->s >> 12;
+	r->s ^= r->s << 25;
+	r->s ^= r->s >> 27;
+	return r->s * 0x2545F4914F6CDD1DULL;
+}
+
+/* Uniform value in [0, bound). */
+static inline uint64_t
+rng_below(struct rng *r, uint64_t bound)
+{
+	return (uint64_t)(((unsigned __int128)rng_next(r) * bound) >> 64);
+}
+
+static inline double
+rng_double(struct rng *r)
+{
+	return (rng_next(r) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* The characters used for an alphabet of size k are the first k entries:
+ * lower case letters first, and never the NULL byte or newline. */
+static unsigned char symbols[254];
+
+static void
+init_symbols(void)
+{
+	unsigned i = 0, c;
+	for (c='a'; c <= '~'; ++c) symbols[i++] = c;
+	for (c='!'; c <  'a'; ++c) symbols[i++] = c;
+	for (c=127; c <= 255; ++c) symbols[i++] = c;
+	symbols[i++] = ' ';
+	for (c=1;   c <  ' '; ++c) if (c != '\n') symbols[i++] = c;
+}
+
+static const char dna_symbols[] = "ACGT";
+static const char url_symbols[] = "abcdefghijklmnopqrstuvwxyz0123456789/";
+
+static void
+fill_symbols(struct rng *r, const struct generate_params *p,
+		unsigned char *out, size_t len)
+{
+	size_t i;
+	switch (p->kind) {
+	case GENERATE_DNA:
+		for (i=0; i < len; ++i)
+			out[i] = dna_symbols[rng_next(r) >> 62];
+		break;
+	case GENERATE_URL:
+		for (i=0; i < len; ++i)
+			out[i] = url_symbols[rng_below(r, sizeof(url_symbols)-1)];
+		break;
+	default:
+		for (i=0; i < len; ++i)
+			out[i] = symbols[rng_below(r, p->alphabet)];
+		break;
+	}
+}
+
+/* Shared prefixes and the vocabulary of the "dups" and "zipf" kinds. */
+struct tables {
+	unsigned char *prefixes;
+	unsigned char **words;
+	size_t *word_lens;
+	double *zipf_cdf;
+};
+
+static size_t
+body_length(struct rng *r, const struct generate_params *p)
+{
+	if (p->len > p->minlen)
+		return p->minlen + rng_below(r, p->len - p->minlen + 1);
+	return p->len;
+}
+
+static void *
+xmalloc(size_t bytes)
+{
+	void *p = malloc(bytes ? bytes : 1);
+	if (!p) {
+		fprintf(stderr,
+			"ERROR: unable to allocate memory for input generator.\n");
+		exit(1);
+	}
+	return p;
+}
+
+static void
+tables_init(struct tables *t, const struct generate_params *p)
+{
+	struct rng r;
+	size_t i;
+	memset(t, 0, sizeof(*t));
+	init_symbols();
+	rng_init(&r, p->seed, 0);
+	t->prefixes = (unsigned char *)xmalloc(p->prefixes * p->prefix);
+	for (i=0; i < p->prefixes; ++i) {
+		unsigned char *pfx = t->prefixes + i*p->prefix;
+		fill_symbols(&r, p, pfx, p->prefix);
+		if (p->kind == GENERATE_URL && p->prefix >= 16) {
+			memcpy(pfx, "http://www.", 11);
+			memcpy(pfx + p->prefix - 5, ".com/", 5);
+		}
+	}
+	if (p->kind != GENERATE_DUPS && p->kind != GENERATE_ZIPF)
+		return;
+	t->words = (unsigned char **)xmalloc(p->distinct * sizeof(unsigned char *));
+	t->word_lens = (size_t *)xmalloc(p->distinct * sizeof(size_t));
+	for (i=0; i < p->distinct; ++i) {
+		t->word_lens[i] = body_length(&r, p);
+		t->words[i] = (unsigned char *)xmalloc(t->word_lens[i]);
+		fill_symbols(&r, p, t->words[i], t->word_lens[i]);
+	}
+	if (p->kind != GENERATE_ZIPF)
+		return;
+	t->zipf_cdf = (double *)xmalloc(p->distinct * sizeof(double));
+	double sum = 0;
+	for (i=0; i < p->distinct; ++i) {
+		sum += 1.0 / pow((double)(i+1), p->zipf_s);
+		t->zipf_cdf[i] = sum;
+	}
+	for (i=0; i < p->distinct; ++i)
+		t->zipf_cdf[i] /= sum;
+}
+
+static void
+tables_free(struct tables *t, const struct generate_params *p)
+{
+	if (t->words)
+		for (size_t i=0; i < p->distinct; ++i)
+			free(t->words[i]);
+	free(t->words);
+	free(t->word_lens);
+	free(t->zipf_cdf);
+	free(t->prefixes);
+}
+
+static size_t
+zipf_rank(struct rng *r, const struct tables *t, size_t distinct)
+{
+	double u = rng_double(r);
+	size_t lo = 0, hi = distinct-1;
+	while (lo < hi) {
+		size_t mid = lo + (hi-lo)/2;
+		if (t->zipf_cdf[mid] < u)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Generates the input into `text', or only computes its size when `text' is
+ * NULL. */
+static size_t
+generate(const struct generate_params *p, const struct tables *t,
+		unsigned char *text, int delim)
+{
+	struct rng lengths, chars;
+	size_t bytes = 0;
+	rng_init(&lengths, p->seed, 1);
+	rng_init(&chars, p->seed, 2);
+	for (size_t i=0; i < p->n; ++i) {
+		size_t pfx = 0, word = 0, len;
+		if (p->prefixes > 1)
+			pfx = rng_below(&lengths, p->prefixes);
+		if (p->kind == GENERATE_DUPS) {
+			word = rng_below(&lengths, p->distinct);
+			len = t->word_lens[word];
+		} else if (p->kind == GENERATE_ZIPF) {
+			word = zipf_rank(&lengths, t, p->distinct);
+			len = t->word_lens[word];
+		} else {
+			len = body_length(&lengths, p);
+		}
+		if (text) {
+			unsigned char *out = text + bytes;
+			memcpy(out, t->prefixes + pfx*p->prefix, p->prefix);
+			out += p->prefix;
+			if (t->words)
+				memcpy(out, t->words[word], len);
+			else
+				fill_symbols(&chars, p, out, len);
+			out[len] = (unsigned char)delim;
+		}
+		bytes += p->prefix + len + 1;
+	}
+	return bytes;
+}
+
+size_t
+generate_size(const struct generate_params *p)
+{
+	struct tables t;
+	size_t bytes;
+	tables_init(&t, p);
+	bytes = generate(p, &t, NULL, 0);
+	tables_free(&t, p);
+	return bytes;
+}
+
+void
+generate_fill(const struct generate_params *p, unsigned char *text, int delim)
+{
+	struct tables t;
+	tables_init(&t, p);
+	generate(p, &t, text, delim);
+	tables_free(&t, p);
+}
+
+static const struct {
+	const char *name;
+	struct generate_params defaults;
+} kinds[] = {
+	/*                        n        seed len minlen prefix prefixes alphabet distinct s */
+	{ "random", { GENERATE_RANDOM, 1000000, 1, 20, 20, 0,    1,   26, 0,      0   } },
+	{ "url",    { GENERATE_URL,    1000000, 1, 30, 10, 40,   100, 0,  0,      0   } },
+	{ "dna",    { GENERATE_DNA,    1000000, 1, 20, 20, 0,    1,   0,  0,      0   } },
+	{ "dups",   { GENERATE_DUPS,   1000000, 1, 20, 20, 0,    1,   26, 1000,   0   } },
+	{ "zipf",   { GENERATE_ZIPF,   1000000, 1, 12, 2,  0,    1,   26, 100000, 1.0 } },
+	{ "lcp",    { GENERATE_LCP,    1000000, 1, 10, 10, 1000, 1,   26, 0,      0   } },
+};
+
+/* Parses numbers such as "1000", "1e6" and "10M". */
+static int
+parse_number(const char *str, double *result)
+{
+	char *end;
+	double v = strtod(str, &end);
+	if (end == str)
+		return -1;
+	switch (*end) {
+	case 'k': v *= 1e3; ++end; break;
+	case 'M': v *= 1e6; ++end; break;
+	case 'G': v *= 1e9; ++end; break;
+	}
+	if (*end != '\0' || v < 0)
+		return -1;
+	*result = v;
+	return 0;
+}
+
+/* Parses a seed as an integer, so that all 64-bit seeds are exact. */
+static int
+parse_seed(const char *str, uint64_t *result)
+{
+	char *end;
+	unsigned long long v;
+	if (*str < '0' || *str > '9')
+		return -1;
+	errno = 0;
+	v = strtoull(str, &end, 0);
+	if (*end != '\0' || errno == ERANGE)
+		return -1;
+	*result = v;
+	return 0;
+}
+
+int
+generate_parse(const char *spec, struct generate_params *p)
+{
+	char *str = strdup(spec);
+	char *tok, *saveptr;
+	int minlen_set = 0, ret = -1;
+	size_t i;
+	if (!str)
+		return -1;
+	tok = strtok_r(str, ",", &saveptr);
+	for (i=0; tok && i < sizeof(kinds)/sizeof(kinds[0]); ++i)
+		if (strcmp(tok, kinds[i].name) == 0)
+			break;
+	if (!tok || i == sizeof(kinds)/sizeof(kinds[0])) {
+		fprintf(stderr,
+			"ERROR: unknown input generator kind '%s'.\n",
+			tok ? tok : "");
+		goto done;
+	}
+	*p = kinds[i].defaults;
+	while ((tok = strtok_r(NULL, ",", &saveptr))) {
+		char *value = strchr(tok, '=');
+		double v = 0;
+		if (!value || (strncmp(tok, "seed=", 5) == 0
+				? parse_seed(value+1, &p->seed)
+				: parse_number(value+1, &v)) == -1) {
+			fprintf(stderr,
+				"ERROR: invalid input generator parameter "
+				"'%s'.\n", tok);
+			goto done;
+		}
+		*value = '\0';
+		if      (strcmp(tok, "n") == 0)        p->n = v;
+		else if (strcmp(tok, "seed") == 0)     ; /* parse_seed() */
+		else if (strcmp(tok, "len") == 0)      p->len = v;
+		else if (strcmp(tok, "minlen") == 0) { p->minlen = v; minlen_set = 1; }
+		else if (strcmp(tok, "prefix") == 0)   p->prefix = v;
+		else if (strcmp(tok, "prefixes") == 0) p->prefixes = v;
+		else if (strcmp(tok, "alphabet") == 0) p->alphabet = v;
+		else if (strcmp(tok, "distinct") == 0) p->distinct = v;
+		else if (strcmp(tok, "s") == 0)        p->zipf_s = v;
+		else {
+			fprintf(stderr,
+				"ERROR: unknown input generator parameter "
+				"'%s'.\n", tok);
+			goto done;
+		}
+	}
+	/* Kinds with fixed length strings by default keep them fixed length
+	 * when only `len' is given. */
+	if (!minlen_set) {
+		if (kinds[i].defaults.minlen == kinds[i].defaults.len
+				|| p->minlen > p->len)
+			p->minlen = p->len;
+	}
+	if (p->n == 0 || p->prefixes == 0 || p->minlen > p->len
+			|| ((p->kind == GENERATE_DUPS || p->kind == GENERATE_ZIPF)
+				&& p->distinct == 0)
+			|| (p->alphabet == 0 && p->kind != GENERATE_URL
+				&& p->kind != GENERATE_DNA)
+			|| p->alphabet > sizeof(symbols)) {
+		fprintf(stderr,
+			"ERROR: invalid input generator parameters in '%s'.\n",
+			spec);
+		goto done;
+	}
+	ret = 0;
+done:
+	free(str);
+	return ret;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GENERATE_H
+#define GENERATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum generate_kind {
+	GENERATE_RANDOM,
+	GENERATE_URL,
+	GENERATE_DNA,
+	GENERATE_DUPS,
+	GENERATE_ZIPF,
+	GENERATE_LCP,
+};
+
+/* Parameters of a synthetic input, parsed from a specification such as
+ * "url,n=1000000,seed=42,prefix=50". Each string consists of a shared
+ * prefix, picked from `prefixes' different prefixes of `prefix' bytes,
+ * followed by a body of [minlen, len] bytes. The kind determines how the
+ * body is generated. */
+struct generate_params {
+	enum generate_kind kind;
+	size_t n;
+	uint64_t seed;
+	size_t len;
+	size_t minlen;
+	size_t prefix;
+	size_t prefixes;
+	unsigned alphabet;
+	size_t distinct;
+	double zipf_s;
+};
+
+int generate_parse(const char *spec, struct generate_params *);
+size_t generate_size(const struct generate_params *);
+void generate_fill(const struct generate_params *, unsigned char *text,
+		int delim);
+
+#endif /* GENERATE_H */
@@ -26,6 +26,7 @@
 #include <cstddef>
 #include <inttypes.h>
 #include <cassert>
+#include "bstring.h"
 
 template <typename CharT>
 inline CharT
@@ -151,6 +152,57 @@ get_char(unsigned char* ptr)
 	}
 }
 
+/*
+ * Byte orders for sorting NUL terminated strings. identity_map compares the
+ * raw byte values, table_map compares table[byte] instead, for example to
+ * sort case-insensitively. The routines take the byte map as a template
+ * parameter, so that the identity map compiles to the same code as before,
+ * and pass the map down the recursion, so that concurrent sorts can use
+ * different tables. The table must map 0 to 0 and no other byte to 0, which
+ * keeps the end of the string first in the order, and is_end() valid on the
+ * mapped characters.
+ */
+struct identity_map
+{
+	unsigned char map(unsigned char c) const { return c; }
+};
+
+struct table_map
+{
+	const unsigned char* table;
+	unsigned char map(unsigned char c) const { return table[c]; }
+};
+
+template <typename CharT, typename ByteMap>
+struct mapped_char
+{
+	static CharT get(unsigned char* ptr, size_t depth, const ByteMap& bm)
+	{
+		CharT c = 0;
+		for (unsigned i=0; i < sizeof(CharT); ++i) {
+			const unsigned char b = ptr[depth+i];
+			if (b == 0) break;
+			c |= CharT(bm.map(b)) << (8*(sizeof(CharT)-1-i));
+		}
+		return c;
+	}
+};
+
+template <typename CharT>
+struct mapped_char<CharT, identity_map>
+{
+	static CharT get(unsigned char* ptr, size_t depth, const identity_map&)
+	{ return get_char<CharT>(ptr, depth); }
+};
+
+template <typename CharT, typename ByteMap>
+inline CharT
+get_char(unsigned char* ptr, size_t depth, const ByteMap& bm)
+{
+	assert(ptr);
+	return mapped_char<CharT, ByteMap>::get(ptr, depth, bm);
+}
+
 template <typename CharT>
 inline bool is_end(CharT c);
 
@@ -174,4 +226,66 @@ template <> inline bool is_end(uint64_t c)
 	return (c&0xFF)==0;
 }
 
+/*
+ * Binary strings may contain every byte value, so a NUL byte cannot mark the
+ * end of the string. Instead get_char<CharT>() packs sizeof(CharT)-1 bytes
+ * into the high bytes of the character, and stores the number of those bytes
+ * that are within the string in the lowest byte. The packed characters sort
+ * in the same order as the strings, and is_end() holds when the string has
+ * no bytes left at `depth'. A character thus covers one byte less than with
+ * NUL terminated strings, see char_step.
+ */
+template <typename CharT>
+inline CharT
+get_char(const bstring& s, size_t depth)
+{
+	static_assert(sizeof(CharT) > 1, "no room for the end sentinel");
+	CharT c = 0;
+	size_t cnt = 0;
+	for (; cnt < sizeof(CharT)-1 and depth+cnt < s.len; ++cnt)
+		c |= CharT(s.ptr[depth+cnt]) << (8*(sizeof(CharT)-1-cnt));
+	return c | CharT(cnt);
+}
+
+template <>
+inline uint16_t
+get_char<uint16_t>(const bstring& s, size_t depth)
+{
+	if (depth >= s.len) return 0;
+	return uint16_t(s.ptr[depth] << 8) | 1;
+}
+
+/*
+ * A 32-bit handle to a NUL terminated string: its offset from the start of
+ * the text. Sorting offsets instead of pointers halves the string array and
+ * all temporary arrays, as long as the text is smaller than 4 GB.
+ */
+struct text_offset { uint32_t offset; };
+
+/*
+ * The routines that are generic over the string type read the characters
+ * through an accessor, which they pass down the recursion. direct_access
+ * returns the NUL terminated strings and bstrings as such. offset_access
+ * carries the text of the sort, and turns a text_offset into a pointer to its
+ * string, so that no global state is needed.
+ */
+struct direct_access
+{
+	unsigned char* operator()(unsigned char* s) const { return s; }
+	const bstring& operator()(const bstring& s) const { return s; }
+};
+
+struct offset_access
+{
+	unsigned char* text;
+	unsigned char* operator()(text_offset s) const { return text+s.offset; }
+};
+
+// Number of string bytes that one character covers.
+template <typename CharT, typename StringT>
+struct char_step { enum { value = sizeof(CharT) }; };
+
+template <typename CharT>
+struct char_step<CharT, bstring> { enum { value = sizeof(CharT)-1 }; };
+
 #endif //GET_CHAR_H
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/*
+ * The routines that return the permutation of the sort keep the input index
+ * of every string in a side array, parallel to the string array. The index
+ * is moved only where the strings are moved, in the distribution and merge
+ * steps, so the string array and the comparisons stay as they are.
+ *
+ * The sort functions take the side array as a template parameter: a plain
+ * size_t pointer, or no_index that makes every index operation a no-op.
+ */
+
+#ifndef INDEX_ARRAY_H
+#define INDEX_ARRAY_H
+
+#include <cstddef>
+#include <cstring>
+#include "bigalloc.h"
+
+struct no_index
+{
+	struct ref
+	{
+		ref& operator=(size_t) { return *this; }
+		operator size_t() const { return 0; }
+	};
+	ref operator[](size_t) const { return ref(); }
+	ref operator*() const { return ref(); }
+	no_index& operator++() { return *this; }
+	no_index operator++(int) { return *this; }
+	no_index operator+(size_t) const { return *this; }
+};
+
+static inline size_t*
+alloc_index(size_t*, size_t n)
+{ return static_cast<size_t*>(big_malloc(n*sizeof(size_t))); }
+static inline no_index
+alloc_index(no_index, size_t)
+{ return no_index(); }
+
+static inline void
+free_index(size_t* idx)
+{ big_free(idx); }
+static inline void
+free_index(no_index)
+{}
+
+static inline void
+copy_index(const size_t* from, size_t n, size_t* to)
+{ (void) memcpy(to, from, n*sizeof(size_t)); }
+static inline void
+copy_index(no_index, size_t, no_index)
+{}
+
+static inline void
+identity_index(size_t* idx, size_t n)
+{
+	for (size_t i=0; i < n; ++i)
+		idx[i] = i;
+}
+
+#endif /* INDEX_ARRAY_H */
@@ -24,10 +24,14 @@
 #define INSERTION_SORT_H
 
 #include <cstddef>
+#include <cstring>
+#include <algorithm>
 #include "get_char.h"
+#include "index_array.h"
 
+template <typename ByteMap>
 static inline void
-insertion_sort(unsigned char** strings, int n, size_t depth)
+insertion_sort(unsigned char** strings, int n, size_t depth, const ByteMap& bm)
 {
 	for (unsigned char** i = strings + 1; --n > 0; ++i) {
 		unsigned char** j = i;
@@ -35,6 +39,113 @@ insertion_sort(unsigned char** strings, int n, size_t depth)
 		while (j > strings) {
 			unsigned char* s = *(j-1)+depth;
 			unsigned char* t = tmp+depth;
+			while (bm.map(*s) == bm.map(*t) and not is_end(*s)) {
+				++s;
+				++t;
+			}
+			if (bm.map(*s) <= bm.map(*t)) break;
+			*j = *(j-1);
+			--j;
+		}
+		*j = tmp;
+	}
+}
+
+static inline void
+insertion_sort(unsigned char** strings, int n, size_t depth)
+{
+	insertion_sort(strings, n, depth, identity_map());
+}
+
+// Same as insertion_sort(), and moves idx[i] along with strings[i].
+template <typename ByteMap>
+static inline void
+insertion_sort(unsigned char** strings, size_t* idx, int n, size_t depth,
+		const ByteMap& bm)
+{
+	for (int i=1; i < n; ++i) {
+		unsigned char* tmp = strings[i];
+		const size_t tmp_idx = idx[i];
+		int j = i;
+		while (j > 0) {
+			unsigned char* s = strings[j-1]+depth;
+			unsigned char* t = tmp+depth;
+			while (bm.map(*s) == bm.map(*t) and not is_end(*s)) {
+				++s;
+				++t;
+			}
+			if (bm.map(*s) <= bm.map(*t)) break;
+			strings[j] = strings[j-1];
+			idx[j] = idx[j-1];
+			--j;
+		}
+		strings[j] = tmp;
+		idx[j] = tmp_idx;
+	}
+}
+
+static inline void
+insertion_sort(unsigned char** strings, size_t* idx, int n, size_t depth)
+{
+	insertion_sort(strings, idx, n, depth, identity_map());
+}
+
+template <typename StringT, typename ByteMap>
+static inline void
+insertion_sort(StringT* strings, no_index, int n, size_t depth,
+		const ByteMap& bm)
+{
+	insertion_sort(strings, n, depth, bm);
+}
+
+template <typename StringT>
+static inline void
+insertion_sort(StringT* strings, no_index, int n, size_t depth)
+{
+	insertion_sort(strings, n, depth);
+}
+
+static inline void
+insertion_sort(bstring* strings, int n, size_t depth)
+{
+	for (bstring* i = strings + 1; --n > 0; ++i) {
+		bstring* j = i;
+		const bstring tmp = *i;
+		while (j > strings) {
+			const bstring& s = *(j-1);
+			size_t len = std::min(s.len, tmp.len);
+			int c = len > depth ? memcmp(s.ptr+depth, tmp.ptr+depth,
+					len-depth) : 0;
+			if (c < 0 or (c == 0 and s.len <= tmp.len)) break;
+			*j = *(j-1);
+			--j;
+		}
+		*j = tmp;
+	}
+}
+
+static inline void
+insertion_sort(unsigned char** strings, int n, size_t depth, direct_access)
+{
+	insertion_sort(strings, n, depth);
+}
+
+static inline void
+insertion_sort(bstring* strings, int n, size_t depth, direct_access)
+{
+	insertion_sort(strings, n, depth);
+}
+
+static inline void
+insertion_sort(text_offset* strings, int n, size_t depth, offset_access acc)
+{
+	unsigned char* text = acc.text;
+	for (text_offset* i = strings + 1; --n > 0; ++i) {
+		text_offset* j = i;
+		const text_offset tmp = *i;
+		while (j > strings) {
+			unsigned char* s = text+(j-1)->offset+depth;
+			unsigned char* t = text+tmp.offset+depth;
 			while (*s == *t and not is_end(*s)) {
 				++s;
 				++t;
@@ -47,4 +158,44 @@ insertion_sort(unsigned char** strings, int n, size_t depth)
 	}
 }
 
+// Collapses the equal strings of a sorted range, that share the first `depth'
+// characters, to the start of the range. Returns the number of distinct
+// strings.
+static inline size_t
+collapse_sorted(unsigned char** strings, size_t n, size_t depth,
+		size_t* counts)
+{
+	if (n == 0) return 0;
+	size_t m = 0;
+	if (counts) counts[0] = 1;
+	for (size_t i=1; i < n; ++i) {
+		if (strcmp((char*)strings[m]+depth,
+		           (char*)strings[i]+depth) == 0) {
+			if (counts) ++counts[m];
+			continue;
+		}
+		strings[++m] = strings[i];
+		if (counts) counts[m] = 1;
+	}
+	return m+1;
+}
+
+// Longest common prefix of two strings that share the first `depth'
+// characters.
+static inline size_t
+lcp_from(const unsigned char* a, const unsigned char* b, size_t depth)
+{
+	while (a[depth] && a[depth] == b[depth]) ++depth;
+	return depth;
+}
+
+// Stores lcp[i] = lcp(strings[i-1], strings[i]) for 0 < i < n of a sorted
+// range, that shares the first `depth' characters. lcp[0] is left untouched.
+static inline void
+lcp_sorted(unsigned char** strings, size_t n, size_t depth, size_t* lcp)
+{
+	for (size_t i=1; i < n; ++i)
+		lcp[i] = lcp_from(strings[i-1], strings[i], depth);
+}
+
 #endif //INSERTION_SORT_H
@@ -70,32 +70,33 @@ pseudo_median(CharT* begin, CharT* end)
 		       );
 }
 
-template <typename CharT>
+template <typename CharT, typename StringT, typename Access = direct_access>
 CharT
-pseudo_median(unsigned char** strings, size_t N, size_t depth)
+pseudo_median(StringT* strings, size_t N, size_t depth,
+		Access acc = Access())
 {
 	if (N > 30)
 		return med3char(
 			med3char(
-				get_char<CharT>(strings[0], depth),
-				get_char<CharT>(strings[1], depth),
-				get_char<CharT>(strings[2], depth)
+				get_char<CharT>(acc(strings[0]), depth),
+				get_char<CharT>(acc(strings[1]), depth),
+				get_char<CharT>(acc(strings[2]), depth)
 				),
 			med3char(
-				get_char<CharT>(strings[N/2  ], depth),
-				get_char<CharT>(strings[N/2+1], depth),
-				get_char<CharT>(strings[N/2+2], depth)
+				get_char<CharT>(acc(strings[N/2  ]), depth),
+				get_char<CharT>(acc(strings[N/2+1]), depth),
+				get_char<CharT>(acc(strings[N/2+2]), depth)
 				),
 			med3char(
-				get_char<CharT>(strings[N-3], depth),
-				get_char<CharT>(strings[N-2], depth),
-				get_char<CharT>(strings[N-1], depth)
+				get_char<CharT>(acc(strings[N-3]), depth),
+				get_char<CharT>(acc(strings[N-2]), depth),
+				get_char<CharT>(acc(strings[N-1]), depth)
 				)
 		       );
 	else
-		return med3char(get_char<CharT>(strings[0  ], depth),
-				get_char<CharT>(strings[N/2], depth),
-				get_char<CharT>(strings[N-1], depth));
+		return med3char(get_char<CharT>(acc(strings[0  ]), depth),
+				get_char<CharT>(acc(strings[N/2]), depth),
+				get_char<CharT>(acc(strings[N-1]), depth));
 }
 
 #endif //UTIL_H
@@ -0,0 +1,360 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/*
+ * Allocation tracker. Interposes the malloc family, posix_memalign (used by
+ * _mm_malloc), mmap, mremap and munmap in the sortstring process. The C++
+ * operators new and delete are covered through malloc and free, reallocarray
+ * through realloc, and valloc and pvalloc through memalign. Memory that the
+ * C library allocates for itself with internal calls, and brk/sbrk, are not
+ * seen. While tracking is
+ * enabled, records the peak of live bytes allocated since memtrack_start(),
+ * the number of allocations and frees, and a histogram of allocation sizes.
+ *
+ * The size of a freed block is taken from malloc_usable_size(), so the
+ * numbers include the allocator's rounding but not its headers. Freeing a
+ * block that was allocated before tracking started decreases the live
+ * bytes, which is what happened to the heap as well.
+ *
+ * Only linked into the sortstring binary. When tracking is disabled the
+ * overhead is a single load and branch per call.
+ */
+
+#define _GNU_SOURCE
+#include "memtrack.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static void *(*real_malloc)(size_t);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_realloc)(void *, size_t);
+static void  (*real_free)(void *);
+static void *(*real_memalign)(size_t, size_t);
+static int   (*real_posix_memalign)(void **, size_t, size_t);
+static void *(*real_aligned_alloc)(size_t, size_t);
+static void *(*real_mmap)(void *, size_t, int, int, int, off_t);
+static void *(*real_mremap)(void *, size_t, size_t, int, ...);
+static int   (*real_munmap)(void *, size_t);
+
+static int enabled;
+static long long live;
+static long long peak;
+static size_t allocations;
+static size_t frees;
+static size_t histogram[MEMTRACK_BUCKETS];
+
+/* dlsym() may allocate memory before the real functions are known. Such
+ * requests are served from this buffer, and never freed. */
+static char bootstrap[8192] __attribute__((aligned(16)));
+static size_t bootstrap_used;
+static int resolving;
+
+static int
+is_bootstrap(void *ptr)
+{
+	return (char *)ptr >= bootstrap && (char *)ptr < bootstrap+sizeof(bootstrap);
+}
+
+static void *
+bootstrap_alloc(size_t size)
+{
+	void *ptr;
+	size = (size + 15) & ~(size_t)15;
+	if (bootstrap_used + size > sizeof(bootstrap))
+		return NULL;
+	ptr = bootstrap + bootstrap_used;
+	bootstrap_used += size;
+	return ptr;
+}
+
+static void
+resolve(void)
+{
+	if (real_malloc || resolving)
+		return;
+	resolving = 1;
+	real_calloc         = dlsym(RTLD_NEXT, "calloc");
+	real_realloc        = dlsym(RTLD_NEXT, "realloc");
+	real_free           = dlsym(RTLD_NEXT, "free");
+	real_memalign       = dlsym(RTLD_NEXT, "memalign");
+	real_posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+	real_aligned_alloc  = dlsym(RTLD_NEXT, "aligned_alloc");
+	real_mmap           = dlsym(RTLD_NEXT, "mmap");
+	real_mremap         = dlsym(RTLD_NEXT, "mremap");
+	real_munmap         = dlsym(RTLD_NEXT, "munmap");
+	real_malloc         = dlsym(RTLD_NEXT, "malloc");
+	resolving = 0;
+	if (!real_malloc || !real_calloc || !real_realloc || !real_free
+			|| !real_memalign || !real_posix_memalign
+			|| !real_aligned_alloc || !real_mmap || !real_mremap
+			|| !real_munmap)
+		abort();
+}
+
+static unsigned
+bucket(size_t size)
+{
+	unsigned b = 0;
+	while (size > 1 && b < MEMTRACK_BUCKETS-1) {
+		size >>= 1;
+		++b;
+	}
+	return b;
+}
+
+static void
+track_alloc(size_t requested, size_t usable)
+{
+	long long cur, old;
+	__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&histogram[bucket(requested)], 1, __ATOMIC_RELAXED);
+	cur = __atomic_add_fetch(&live, (long long)usable, __ATOMIC_RELAXED);
+	old = __atomic_load_n(&peak, __ATOMIC_RELAXED);
+	while (cur > old && !__atomic_compare_exchange_n(&peak, &old, cur, 1,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+static void
+track_free(size_t usable)
+{
+	__atomic_fetch_add(&frees, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_sub(&live, (long long)usable, __ATOMIC_RELAXED);
+}
+
+static inline int
+tracking(void)
+{
+	return __atomic_load_n(&enabled, __ATOMIC_RELAXED);
+}
+
+void *
+malloc(size_t size)
+{
+	void *ptr;
+	resolve();
+	if (!real_malloc)
+		return bootstrap_alloc(size);
+	ptr = real_malloc(size);
+	if (ptr && tracking())
+		track_alloc(size, malloc_usable_size(ptr));
+	return ptr;
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+	void *ptr;
+	resolve();
+	if (!real_calloc) {
+		if (size && nmemb > SIZE_MAX / size)
+			return NULL;
+		/* The bootstrap buffer is zero initialized. */
+		return bootstrap_alloc(nmemb*size);
+	}
+	ptr = real_calloc(nmemb, size);
+	if (ptr && tracking())
+		track_alloc(nmemb*size, malloc_usable_size(ptr));
+	return ptr;
+}
+
+void *
+realloc(void *old, size_t size)
+{
+	void *ptr;
+	size_t old_usable;
+	resolve();
+	if (!real_realloc || is_bootstrap(old)) {
+		size_t avail = old ? (size_t)(bootstrap+sizeof(bootstrap) - (char *)old) : 0;
+		ptr = malloc(size);
+		if (ptr && old)
+			memcpy(ptr, old, size < avail ? size : avail);
+		return ptr;
+	}
+	old_usable = (old && tracking()) ? malloc_usable_size(old) : 0;
+	ptr = real_realloc(old, size);
+	if (tracking()) {
+		if (old && (ptr || size == 0))
+			track_free(old_usable);
+		if (ptr)
+			track_alloc(size, malloc_usable_size(ptr));
+	}
+	return ptr;
+}
+
+void *
+reallocarray(void *old, size_t nmemb, size_t size)
+{
+	if (size && nmemb > SIZE_MAX / size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	return realloc(old, nmemb*size);
+}
+
+void
+free(void *ptr)
+{
+	if (!ptr || is_bootstrap(ptr))
+		return;
+	resolve();
+	if (tracking())
+		track_free(malloc_usable_size(ptr));
+	real_free(ptr);
+}
+
+void *
+memalign(size_t alignment, size_t size)
+{
+	void *ptr;
+	resolve();
+	ptr = real_memalign(alignment, size);
+	if (ptr && tracking())
+		track_alloc(size, malloc_usable_size(ptr));
+	return ptr;
+}
+
+void *
+valloc(size_t size)
+{
+	return memalign(sysconf(_SC_PAGESIZE), size);
+}
+
+void *
+pvalloc(size_t size)
+{
+	const size_t page = sysconf(_SC_PAGESIZE);
+	if (size > SIZE_MAX - page) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	return memalign(page, (size + page - 1) & ~(page - 1));
+}
+
+int
+posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+	int ret;
+	resolve();
+	ret = real_posix_memalign(memptr, alignment, size);
+	if (ret == 0 && tracking())
+		track_alloc(size, malloc_usable_size(*memptr));
+	return ret;
+}
+
+void *
+aligned_alloc(size_t alignment, size_t size)
+{
+	void *ptr;
+	resolve();
+	ptr = real_aligned_alloc(alignment, size);
+	if (ptr && tracking())
+		track_alloc(size, malloc_usable_size(ptr));
+	return ptr;
+}
+
+void *
+mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+	void *ptr;
+	resolve();
+	ptr = real_mmap(addr, length, prot, flags, fd, offset);
+	if (ptr != MAP_FAILED && tracking())
+		track_alloc(length, length);
+	return ptr;
+}
+
+/* A moved or resized mapping counts as a free and an allocation, like
+ * realloc. */
+void *
+mremap(void *old, size_t old_size, size_t new_size, int flags, ...)
+{
+	void *ptr, *new_address = NULL;
+	if (flags & MREMAP_FIXED) {
+		va_list ap;
+		va_start(ap, flags);
+		new_address = va_arg(ap, void *);
+		va_end(ap);
+	}
+	resolve();
+	ptr = real_mremap(old, old_size, new_size, flags, new_address);
+	if (ptr != MAP_FAILED && tracking()) {
+#ifdef MREMAP_DONTUNMAP
+		if (!(flags & MREMAP_DONTUNMAP))
+#endif
+			track_free(old_size);
+		track_alloc(new_size, new_size);
+	}
+	return ptr;
+}
+
+int
+munmap(void *addr, size_t length)
+{
+	int ret;
+	resolve();
+	ret = real_munmap(addr, length);
+	if (ret == 0 && tracking())
+		track_free(length);
+	return ret;
+}
+
+void
+memtrack_reset(void)
+{
+	__atomic_store_n(&peak, 0, __ATOMIC_RELAXED);
+	memtrack_start();
+	memtrack_stop();
+}
+
+void
+memtrack_start(void)
+{
+	__atomic_store_n(&live, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&allocations, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&frees, 0, __ATOMIC_RELAXED);
+	memset(histogram, 0, sizeof(histogram));
+	__atomic_store_n(&enabled, 1, __ATOMIC_SEQ_CST);
+}
+
+void
+memtrack_stop(void)
+{
+	__atomic_store_n(&enabled, 0, __ATOMIC_SEQ_CST);
+}
+
+void
+memtrack_get(struct memtrack_stats *st)
+{
+	st->peak = peak > 0 ? (size_t)peak : 0;
+	st->allocations = allocations;
+	st->frees = frees;
+	memcpy(st->histogram, histogram, sizeof(histogram));
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef MEMTRACK_H
+#define MEMTRACK_H
+
+#include <stddef.h>
+
+/* Allocation sizes are bucketed by powers of two: bucket i counts sizes in
+ * [2^i, 2^(i+1)), bucket 0 also counts zero sized allocations. */
+#define MEMTRACK_BUCKETS 48
+
+struct memtrack_stats {
+	size_t peak;
+	size_t allocations;
+	size_t frees;
+	size_t histogram[MEMTRACK_BUCKETS];
+};
+
+/* Clears all statistics, including the peak. */
+void memtrack_reset(void);
+/* Starts tracking. Clears the statistics except for the peak, so that the
+ * peak covers all tracked intervals since the last reset. */
+void memtrack_start(void);
+void memtrack_stop(void);
+void memtrack_get(struct memtrack_stats *);
+
+#endif /* MEMTRACK_H */
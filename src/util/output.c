@@ -0,0 +1,454 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/*
+ * Bulk writers for the sorted output. The strings are scattered around the
+ * input text, so writing them one by one through stdio costs a function call
+ * and a copy per string. These writers batch the output into large system
+ * calls instead:
+ *
+ *   writev   : short strings are gathered into a 4 MB buffer, long strings
+ *              are referenced directly from the iovec without copying.
+ *   direct   : strings are copied into 8 MB page aligned buffers that are
+ *              written with O_DIRECT, bypassing the page cache.
+ *   parallel : the sorted array is split into ranges, the output offset of
+ *              each range is computed with a prefix sum, and the ranges are
+ *              written in parallel with pwrite() into a preallocated file.
+ */
+
+#define _GNU_SOURCE
+#include "output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define WRITEV_BUFSIZE   (4*1024*1024)
+#define WRITEV_IOVCNT    1024
+#define WRITEV_LARGE     4096
+#define DIRECT_BUFSIZE   (8*1024*1024)
+#define DIRECT_ALIGN     4096
+#define PARALLEL_BUFSIZE (1024*1024)
+
+static const char *const mode_names[] = {
+	[OUTPUT_WRITEV]   = "writev",
+	[OUTPUT_DIRECT]   = "direct",
+	[OUTPUT_PARALLEL] = "parallel",
+};
+
+int
+output_mode_parse(const char *name, enum output_mode *mode)
+{
+	for (unsigned i=0; i < sizeof(mode_names)/sizeof(mode_names[0]); ++i) {
+		if (strcmp(name, mode_names[i]) == 0) {
+			*mode = (enum output_mode)i;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+const char *
+output_mode_name(enum output_mode mode)
+{
+	return mode_names[mode];
+}
+
+static int
+write_all(int fd, const unsigned char *buf, size_t len)
+{
+	while (len) {
+		ssize_t ret = write(fd, buf, len);
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+static int
+pwrite_all(int fd, const unsigned char *buf, size_t len, off_t off)
+{
+	while (len) {
+		ssize_t ret = pwrite(fd, buf, len, off);
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+		off += ret;
+	}
+	return 0;
+}
+
+static int
+writev_all(int fd, struct iovec *iov, int cnt)
+{
+	while (cnt) {
+		ssize_t ret = writev(fd, iov, cnt);
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		while (cnt && (size_t)ret >= iov->iov_len) {
+			ret -= iov->iov_len;
+			++iov;
+			--cnt;
+		}
+		if (cnt) {
+			iov->iov_base = (char *)iov->iov_base + ret;
+			iov->iov_len -= ret;
+		}
+	}
+	return 0;
+}
+
+/* With counts, each string is preceded by its count like in `uniq -c'. */
+static long long
+output_writev(int fd, unsigned char **strings, size_t n, int delim,
+		const size_t *counts)
+{
+	struct iovec iov[WRITEV_IOVCNT];
+	unsigned char *buf;
+	size_t fill = 0, seg = 0;
+	int cnt = 0;
+	long long total = 0;
+	buf = malloc(WRITEV_BUFSIZE);
+	if (!buf)
+		return -1;
+	for (size_t i=0; i < n; ++i) {
+		size_t len = strlen((const char *)strings[i]);
+		/* Room for the pending buffer segment, a referenced string, and
+		 * the count and delimiter in the buffer. */
+		if (cnt + 3 > WRITEV_IOVCNT
+				|| fill + WRITEV_LARGE + 32 > WRITEV_BUFSIZE) {
+			if (fill > seg) {
+				iov[cnt].iov_base = buf + seg;
+				iov[cnt].iov_len = fill - seg;
+				++cnt;
+			}
+			if (writev_all(fd, iov, cnt) == -1)
+				goto fail;
+			cnt = 0;
+			fill = seg = 0;
+		}
+		if (counts) {
+			int w = sprintf((char *)buf + fill, "%7zu ", counts[i]);
+			fill += w;
+			total += w;
+		}
+		if (len >= WRITEV_LARGE) {
+			if (fill > seg) {
+				iov[cnt].iov_base = buf + seg;
+				iov[cnt].iov_len = fill - seg;
+				++cnt;
+			}
+			iov[cnt].iov_base = strings[i];
+			iov[cnt].iov_len = len;
+			++cnt;
+			seg = fill;
+		} else {
+			memcpy(buf + fill, strings[i], len);
+			fill += len;
+		}
+		buf[fill++] = delim;
+		total += len + 1;
+	}
+	if (fill > seg) {
+		iov[cnt].iov_base = buf + seg;
+		iov[cnt].iov_len = fill - seg;
+		++cnt;
+	}
+	if (writev_all(fd, iov, cnt) == -1)
+		goto fail;
+	free(buf);
+	return total;
+fail:
+	free(buf);
+	return -1;
+}
+
+/* Same as output_writev(), for binary strings: each string is preceded by its
+ * length as a 32-bit little endian integer. */
+static long long
+output_writev_binary(int fd, const struct bstring *strings, size_t n)
+{
+	struct iovec iov[WRITEV_IOVCNT];
+	unsigned char *buf;
+	size_t fill = 0, seg = 0;
+	int cnt = 0;
+	long long total = 0;
+	buf = malloc(WRITEV_BUFSIZE);
+	if (!buf)
+		return -1;
+	for (size_t i=0; i < n; ++i) {
+		size_t len = strings[i].len;
+		if (cnt + 3 > WRITEV_IOVCNT || fill + WRITEV_LARGE + 4 > WRITEV_BUFSIZE) {
+			if (fill > seg) {
+				iov[cnt].iov_base = buf + seg;
+				iov[cnt].iov_len = fill - seg;
+				++cnt;
+			}
+			if (writev_all(fd, iov, cnt) == -1)
+				goto fail;
+			cnt = 0;
+			fill = seg = 0;
+		}
+		buf[fill++] = len;
+		buf[fill++] = len >> 8;
+		buf[fill++] = len >> 16;
+		buf[fill++] = len >> 24;
+		if (len >= WRITEV_LARGE) {
+			iov[cnt].iov_base = buf + seg;
+			iov[cnt].iov_len = fill - seg;
+			++cnt;
+			iov[cnt].iov_base = strings[i].ptr;
+			iov[cnt].iov_len = len;
+			++cnt;
+			seg = fill;
+		} else {
+			memcpy(buf + fill, strings[i].ptr, len);
+			fill += len;
+		}
+		total += len + 4;
+	}
+	if (fill > seg) {
+		iov[cnt].iov_base = buf + seg;
+		iov[cnt].iov_len = fill - seg;
+		++cnt;
+	}
+	if (writev_all(fd, iov, cnt) == -1)
+		goto fail;
+	free(buf);
+	return total;
+fail:
+	free(buf);
+	return -1;
+}
+
+static long long
+output_direct(int fd, unsigned char **strings, size_t n, int delim)
+{
+	unsigned char *buf;
+	size_t fill = 0;
+	long long total = 0;
+	if (posix_memalign((void **)&buf, DIRECT_ALIGN, DIRECT_BUFSIZE))
+		return -1;
+	for (size_t i=0; i < n; ++i) {
+		const unsigned char *str = strings[i];
+		size_t len = strlen((const char *)str);
+		total += len + 1;
+		while (1) {
+			size_t m = DIRECT_BUFSIZE - fill;
+			if (len < m)
+				m = len;
+			memcpy(buf + fill, str, m);
+			fill += m;
+			str += m;
+			len -= m;
+			if (fill == DIRECT_BUFSIZE) {
+				if (write_all(fd, buf, fill) == -1)
+					goto fail;
+				fill = 0;
+			}
+			if (len == 0)
+				break;
+		}
+		buf[fill++] = delim;
+		if (fill == DIRECT_BUFSIZE) {
+			if (write_all(fd, buf, fill) == -1)
+				goto fail;
+			fill = 0;
+		}
+	}
+	/* O_DIRECT requires aligned lengths, the tail goes through the page
+	 * cache. */
+	if (fill) {
+		int flags = fcntl(fd, F_GETFL);
+		if (flags == -1 || fcntl(fd, F_SETFL, flags & ~O_DIRECT) == -1)
+			goto fail;
+		if (write_all(fd, buf, fill) == -1)
+			goto fail;
+	}
+	free(buf);
+	return total;
+fail:
+	free(buf);
+	return -1;
+}
+
+static long long
+output_parallel(int fd, unsigned char **strings, size_t n, int delim)
+{
+	size_t ranges;
+	off_t *offsets;
+	long long total;
+	int error = 0;
+#ifdef _OPENMP
+	ranges = 8*omp_get_max_threads();
+#else
+	ranges = 1;
+#endif
+	if (ranges > n)
+		ranges = n ? n : 1;
+	offsets = malloc((ranges+1)*sizeof(off_t));
+	if (!offsets)
+		return -1;
+	offsets[0] = 0;
+#pragma omp parallel for schedule(dynamic)
+	for (size_t r=0; r < ranges; ++r) {
+		size_t begin = n*r/ranges, end = n*(r+1)/ranges;
+		off_t bytes = 0;
+		for (size_t i=begin; i < end; ++i)
+			bytes += strlen((const char *)strings[i]) + 1;
+		offsets[r+1] = bytes;
+	}
+	for (size_t r=0; r < ranges; ++r)
+		offsets[r+1] += offsets[r];
+	total = offsets[ranges];
+	if (total && fallocate(fd, 0, 0, total) == -1
+			&& ftruncate(fd, total) == -1) {
+		free(offsets);
+		return -1;
+	}
+#pragma omp parallel for schedule(dynamic)
+	for (size_t r=0; r < ranges; ++r) {
+		size_t begin = n*r/ranges, end = n*(r+1)/ranges;
+		off_t off = offsets[r];
+		size_t fill = 0;
+		unsigned char *buf = malloc(PARALLEL_BUFSIZE);
+		int failed;
+		if (!buf) {
+#pragma omp atomic write
+			error = ENOMEM;
+			continue;
+		}
+		for (size_t i=begin; i < end; ++i) {
+			const unsigned char *str = strings[i];
+			size_t len;
+#pragma omp atomic read
+			failed = error;
+			if (failed)
+				break;
+			len = strlen((const char *)str);
+			if (fill + len + 1 > PARALLEL_BUFSIZE) {
+				if (pwrite_all(fd, buf, fill, off) == -1)
+					goto fail;
+				off += fill;
+				fill = 0;
+			}
+			if (len + 1 > PARALLEL_BUFSIZE) {
+				if (pwrite_all(fd, str, len, off) == -1)
+					goto fail;
+				off += len;
+			} else {
+				memcpy(buf + fill, str, len);
+				fill += len;
+			}
+			buf[fill++] = delim;
+		}
+#pragma omp atomic read
+		failed = error;
+		if (!failed && pwrite_all(fd, buf, fill, off) == -1)
+			goto fail;
+		free(buf);
+		continue;
+fail:
+#pragma omp atomic write
+		error = errno;
+		free(buf);
+	}
+	free(offsets);
+	if (error) {
+		errno = error;
+		return -1;
+	}
+	return total;
+}
+
+long long
+output_write(const char *filename, unsigned char **strings, size_t n,
+		int delim, enum output_mode mode)
+{
+	long long ret;
+	int fd, flags = O_WRONLY | O_CREAT | O_TRUNC;
+	if (mode == OUTPUT_DIRECT) {
+		fd = open(filename, flags | O_DIRECT, 0644);
+		/* Not all filesystems support O_DIRECT, tmpfs for one. */
+		if (fd == -1 && errno == EINVAL)
+			fd = open(filename, flags, 0644);
+	} else {
+		fd = open(filename, flags, 0644);
+	}
+	if (fd == -1)
+		return -1;
+	switch (mode) {
+	case OUTPUT_DIRECT:   ret = output_direct(fd, strings, n, delim); break;
+	case OUTPUT_PARALLEL: ret = output_parallel(fd, strings, n, delim); break;
+	default:              ret = output_writev(fd, strings, n, delim, NULL); break;
+	}
+	if (close(fd) == -1)
+		ret = -1;
+	return ret;
+}
+
+long long
+output_write_binary(const char *filename, const struct bstring *strings,
+		size_t n)
+{
+	long long ret;
+	int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1)
+		return -1;
+	ret = output_writev_binary(fd, strings, n);
+	if (close(fd) == -1)
+		ret = -1;
+	return ret;
+}
+
+long long
+output_write_counts(const char *filename, unsigned char **strings,
+		const size_t *counts, size_t n)
+{
+	long long ret;
+	int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1)
+		return -1;
+	ret = output_writev(fd, strings, n, '\n', counts);
+	if (close(fd) == -1)
+		ret = -1;
+	return ret;
+}
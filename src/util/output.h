@@ -0,0 +1,56 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include "bstring.h"
+
+enum output_mode {
+	OUTPUT_WRITEV,
+	OUTPUT_DIRECT,
+	OUTPUT_PARALLEL,
+};
+
+int output_mode_parse(const char *name, enum output_mode *);
+const char *output_mode_name(enum output_mode);
+
+/* Writes the strings to `filename', each followed by `delim'. Returns the
+ * number of bytes written, or -1 with errno set on failure. */
+long long output_write(const char *filename, unsigned char **strings,
+		size_t n, int delim, enum output_mode);
+
+/* Writes the binary strings to `filename' in the --length-prefixed format,
+ * with the writev writer. Returns the number of bytes written, or -1 with
+ * errno set on failure. */
+long long output_write_binary(const char *filename,
+		const struct bstring *strings, size_t n);
+
+/* Writes the strings to `filename' one per line, each preceded by its count
+ * in the format of `uniq -c', with the writev writer. Returns the number of
+ * bytes written, or -1 with errno set on failure. */
+long long output_write_counts(const char *filename, unsigned char **strings,
+		const size_t *counts, size_t n);
+
+#endif /* OUTPUT_H */
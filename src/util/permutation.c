@@ -0,0 +1,226 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "permutation.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+/* The whole element is the key: the string pointer, or the offset, and
+ * the length that follows the pointer in a struct bstring. Two bstrings
+ * may share the pointer and differ only in the length. */
+struct key {
+	uintptr_t ptr;
+	size_t len;
+};
+
+static inline struct key
+string_key(const void *strings, size_t i, size_t size)
+{
+	const unsigned char *p = (const unsigned char *)strings + i*size;
+	struct key k = { 0, 0 };
+	if (size == sizeof(uint32_t)) {
+		uint32_t offset;
+		memcpy(&offset, p, sizeof(offset));
+		k.ptr = offset;
+	} else {
+		const void *ptr;
+		memcpy(&ptr, p, sizeof(ptr));
+		k.ptr = (uintptr_t)ptr;
+		if (size >= sizeof(ptr) + sizeof(size_t))
+			memcpy(&k.len, p + sizeof(ptr), sizeof(size_t));
+	}
+	return k;
+}
+
+static inline int
+cmp_key(struct key a, struct key b)
+{
+	if (a.ptr != b.ptr)
+		return a.ptr < b.ptr ? -1 : 1;
+	return a.len < b.len ? -1 : a.len > b.len;
+}
+
+struct entry {
+	struct key key;
+	size_t index;
+};
+
+/* Equal keys are ordered by the input index, so that duplicates are
+ * assigned in input order. */
+static int
+cmp_entry(const void *a, const void *b)
+{
+	const struct entry *x = a, *y = b;
+	int c = cmp_key(x->key, y->key);
+	if (c)
+		return c;
+	return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/* Every BLOCK'th key of the ascending input is sampled into a small index
+ * that stays in the cache, so that a lookup touches only one block of the
+ * input itself. */
+#define BLOCK 64
+
+/* Index of the input element with the given key, or n. */
+static size_t
+search_input(const void *input, size_t n, size_t size,
+		const struct key *index, size_t index_cnt, struct key key)
+{
+	size_t lo = 0, hi = index_cnt;
+	while (lo < hi) {
+		size_t mid = lo + (hi-lo)/2;
+		if (cmp_key(index[mid], key) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return n;
+	lo = (lo-1)*BLOCK;
+	hi = lo + BLOCK < n ? lo + BLOCK : n;
+	for (; lo < hi; ++lo)
+		if (cmp_key(string_key(input, lo, size), key) == 0)
+			return lo;
+	return n;
+}
+
+static size_t
+search_entries(const struct entry *e, size_t n, struct key key)
+{
+	size_t lo = 0, hi = n;
+	while (lo < hi) {
+		size_t mid = lo + (hi-lo)/2;
+		if (cmp_key(e[mid].key, key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* The strings created from a text are in ascending address order, so
+ * usually the input itself can be searched. */
+static int
+ascending(const void *input, size_t n, size_t size)
+{
+	for (size_t i=1; i < n; ++i)
+		if (cmp_key(string_key(input, i-1, size),
+			    string_key(input, i, size)) >= 0)
+			return 0;
+	return 1;
+}
+
+int
+permutation_recover(const void *input, const void *output, size_t n,
+		size_t size, size_t *perm)
+{
+	size_t missing = 0;
+	if (ascending(input, n, size)) {
+		const size_t index_cnt = (n+BLOCK-1)/BLOCK;
+		struct key *index = malloc((index_cnt ? index_cnt : 1)
+				*sizeof(struct key));
+		if (!index) {
+			errno = ENOMEM;
+			return -1;
+		}
+		for (size_t i=0; i < index_cnt; ++i)
+			index[i] = string_key(input, i*BLOCK, size);
+#pragma omp parallel for schedule(static, 16384) reduction(+:missing)
+		for (size_t i=0; i < n; ++i) {
+			perm[i] = search_input(input, n, size, index,
+					index_cnt, string_key(output, i, size));
+			if (perm[i] == n)
+				++missing;
+		}
+		free(index);
+	} else {
+		/* Several elements may point to the same string. Entries are
+		 * consumed in index order by marking them used. */
+		struct entry *e = malloc(n*sizeof(struct entry));
+		if (!e) {
+			errno = ENOMEM;
+			return -1;
+		}
+		for (size_t i=0; i < n; ++i) {
+			e[i].key = string_key(input, i, size);
+			e[i].index = i;
+		}
+		qsort(e, n, sizeof(struct entry), cmp_entry);
+		for (size_t i=0; i < n; ++i) {
+			struct key key = string_key(output, i, size);
+			size_t j = search_entries(e, n, key);
+			while (j < n && cmp_key(e[j].key, key) == 0
+					&& e[j].index == SIZE_MAX)
+				++j;
+			if (j == n || cmp_key(e[j].key, key) != 0) {
+				++missing;
+				continue;
+			}
+			perm[i] = e[j].index;
+			e[j].index = SIZE_MAX;
+		}
+		free(e);
+	}
+	if (missing) {
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+int
+permutation_check(const void *input, const void *output, size_t n,
+		size_t size, const size_t *perm)
+{
+	size_t invalid = 0, wrong = 0;
+	unsigned char *seen = calloc(n ? n : 1, 1);
+	if (!seen) {
+		fprintf(stderr,
+			"WARNING: unable to allocate memory for checking the "
+			"permutation.\n");
+		return 1;
+	}
+	for (size_t i=0; i < n; ++i) {
+		if (perm[i] >= n || seen[perm[i]]) {
+			++invalid;
+			continue;
+		}
+		seen[perm[i]] = 1;
+		if (memcmp((const unsigned char *)input + perm[i]*size,
+			   (const unsigned char *)output + i*size, size) != 0)
+			++wrong;
+	}
+	free(seen);
+	if (invalid)
+		fprintf(stderr,
+			"WARNING: found %zu invalid permutation indexes!\n",
+			invalid);
+	if (wrong)
+		fprintf(stderr,
+			"WARNING: found %zu incorrect permutation indexes!\n",
+			wrong);
+	return (invalid || wrong) ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Recovers the permutation that a sort applied to the string array, for the
+ * routines that have no f_perm variant carrying the indexes through the
+ * sort. The routines move only the string pointers, so the original index of
+ * each sorted string can be found afterwards by its address in a copy of the
+ * input.
+ */
+
+#ifndef PERMUTATION_H
+#define PERMUTATION_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sets perm[i] to the index in `input' of output[i]. The arrays have n
+ * elements of `size' bytes, which begin with the string pointer, or with
+ * size 4 are 32-bit string offsets. A length that follows the pointer, as
+ * in struct bstring, is part of the key. Equal elements are assigned in
+ * input order. The output must be a permutation of the input. Linear in memory and O(n log n) in time; an extra index of n
+ * elements is sorted if the input addresses are not ascending. Returns 0,
+ * or -1 with errno set on failure. */
+int permutation_recover(const void *input, const void *output, size_t n,
+		size_t size, size_t *perm);
+
+/* Returns 0 if perm is a permutation of 0..n-1 and output[i] is
+ * input[perm[i]] for all i, otherwise prints a warning and returns 1. */
+int permutation_check(const void *input, const void *output, size_t n,
+		size_t size, const size_t *perm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERMUTATION_H */
@@ -21,10 +21,17 @@
  */
 
 #define _GNU_SOURCE
+#include "timing.h"
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <stdint.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 static struct timespec process_cputime_start;
 static struct timespec process_cputime_stop;
@@ -33,8 +40,130 @@ static struct timespec monotonic_stop;
 static struct rusage startclock;
 static struct rusage stopclock;
 
+/* Hardware counters, opened with perf_event_open(). Each counter is opened
+ * individually instead of as a group, because the kernel does not allow
+ * group reads for inherited counters. Multiplexing is compensated for by
+ * scaling with time_enabled/time_running. */
+#define CACHE_EVENT(cache, op, result) \
+	((cache) | ((op) << 8) | ((result) << 16))
+static const struct {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+} counter_events[TIMING_COUNTERS] = {
+	{ "cycles",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "LLC-load-misses",  PERF_TYPE_HW_CACHE,
+		CACHE_EVENT(PERF_COUNT_HW_CACHE_LL,
+			    PERF_COUNT_HW_CACHE_OP_READ,
+			    PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	{ "dTLB-load-misses", PERF_TYPE_HW_CACHE,
+		CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB,
+			    PERF_COUNT_HW_CACHE_OP_READ,
+			    PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	{ "branch-misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+#undef CACHE_EVENT
+
+struct counter_reading {
+	uint64_t value;
+	uint64_t time_enabled;
+	uint64_t time_running;
+};
+
+static int counter_fds[TIMING_COUNTERS] = { -1, -1, -1, -1, -1 };
+static int counters_opened;
+static struct counter_reading counter_start[TIMING_COUNTERS];
+static struct counter_reading counter_stop[TIMING_COUNTERS];
+
+int timing_counters_open(void)
+{
+	int ok = 0;
+	for (unsigned i=0; i < TIMING_COUNTERS; ++i) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = counter_events[i].type;
+		attr.config = counter_events[i].config;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+		                 | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		/* Count also in threads created later, e.g. OpenMP workers.
+		 * Reading the parent counter sums up all child counters. */
+		attr.inherit = 1;
+		counter_fds[i] = syscall(SYS_perf_event_open, &attr,
+				0, -1, -1, 0);
+		if (counter_fds[i] != -1)
+			++ok;
+	}
+	counters_opened = 1;
+	return ok;
+}
+
+void timing_counters_close(void)
+{
+	for (unsigned i=0; i < TIMING_COUNTERS; ++i) {
+		if (counter_fds[i] != -1)
+			close(counter_fds[i]);
+		counter_fds[i] = -1;
+	}
+	counters_opened = 0;
+}
+
+static void
+counters_read(struct counter_reading *r)
+{
+	for (unsigned i=0; i < TIMING_COUNTERS; ++i) {
+		if (counter_fds[i] == -1)
+			continue;
+		if (read(counter_fds[i], &r[i], sizeof(r[i])) != sizeof(r[i])) {
+			close(counter_fds[i]);
+			counter_fds[i] = -1;
+		}
+	}
+}
+
+static void
+counters_ioctl(unsigned long request)
+{
+	for (unsigned i=0; i < TIMING_COUNTERS; ++i)
+		if (counter_fds[i] != -1)
+			ioctl(counter_fds[i], request, 0);
+}
+
+const char *timing_counter_name(unsigned i)
+{
+	return counter_events[i].name;
+}
+
+int timing_counter_available(unsigned i)
+{
+	return counter_fds[i] != -1;
+}
+
+double timing_counter_value(unsigned i)
+{
+	uint64_t value, enabled, running;
+	if (counter_fds[i] == -1)
+		return 0;
+	value   = counter_stop[i].value        - counter_start[i].value;
+	enabled = counter_stop[i].time_enabled - counter_start[i].time_enabled;
+	running = counter_stop[i].time_running - counter_start[i].time_running;
+	if (running == 0)
+		return 0;
+	if (running < enabled)
+		return (double)value * ((double)enabled / (double)running);
+	return (double)value;
+}
+
 void timing_start(void)
 {
+	if (counters_opened) {
+		counters_read(counter_start);
+		counters_ioctl(PERF_EVENT_IOC_ENABLE);
+	}
 	getrusage(RUSAGE_SELF, &startclock);
 	clock_gettime(CLOCK_MONOTONIC, &monotonic_start);
 	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &process_cputime_start);
@@ -45,12 +174,16 @@ void timing_stop(void)
 	getrusage(RUSAGE_SELF, &stopclock);
 	clock_gettime(CLOCK_MONOTONIC, &monotonic_stop);
 	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &process_cputime_stop);
+	if (counters_opened) {
+		counters_ioctl(PERF_EVENT_IOC_DISABLE);
+		counters_read(counter_stop);
+	}
 }
 
 double gettime_wall_clock(void)
 {
-	double msecs_1 = monotonic_start.tv_nsec/1000000 + 1000*monotonic_start.tv_sec;
-	double msecs_2 = monotonic_stop.tv_nsec/1000000 + 1000*monotonic_stop.tv_sec;
+	double msecs_1 = monotonic_start.tv_nsec/1e6 + 1000.0*monotonic_start.tv_sec;
+	double msecs_2 = monotonic_stop.tv_nsec/1e6 + 1000.0*monotonic_stop.tv_sec;
 	return msecs_2 - msecs_1;
 }
 
@@ -81,7 +214,7 @@ double gettime_user_sys(void)
 
 double gettime_process_cputime(void)
 {
-	double msecs_1 = process_cputime_start.tv_nsec/1000000 + 1000*process_cputime_start.tv_sec;
-	double msecs_2 = process_cputime_stop.tv_nsec/1000000 + 1000*process_cputime_stop.tv_sec;
+	double msecs_1 = process_cputime_start.tv_nsec/1e6 + 1000.0*process_cputime_start.tv_sec;
+	double msecs_2 = process_cputime_stop.tv_nsec/1e6 + 1000.0*process_cputime_stop.tv_sec;
 	return msecs_2 - msecs_1;
 }
@@ -32,4 +32,15 @@ double gettime_user_sys(void);
 double gettime_process_cputime(void);
 double gettime_wall_clock(void);
 
+/* Hardware performance counters: cycles, instructions, LLC-load-misses,
+ * dTLB-load-misses and branch-misses. Must be opened before any threads are
+ * created to have them counted. Returns the number of counters that could
+ * be opened. */
+#define TIMING_COUNTERS 5
+int timing_counters_open(void);
+void timing_counters_close(void);
+const char *timing_counter_name(unsigned);
+int timing_counter_available(unsigned);
+double timing_counter_value(unsigned);
+
 #endif /* TIMING_H */
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "verify.h"
+#include "bstring.h"
+#include <stdio.h>
+#include <string.h>
+
+static inline uintptr_t
+string_key(const void *strings, size_t i, size_t size)
+{
+	const unsigned char *p = (const unsigned char *)strings + i*size;
+	if (size == sizeof(uint32_t)) {
+		uint32_t offset;
+		memcpy(&offset, p, sizeof(offset));
+		return offset;
+	} else {
+		const void *ptr;
+		memcpy(&ptr, p, sizeof(ptr));
+		return (uintptr_t)ptr;
+	}
+}
+
+/* The finalizer of SplitMix64. */
+static inline uint64_t
+mix(uint64_t x)
+{
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+/* The key of the whole element, a bstring is its pointer and length. */
+static inline uint64_t
+element_key(const void *strings, size_t i, size_t size)
+{
+	uint64_t key = string_key(strings, i, size);
+	if (size == sizeof(struct bstring))
+		key = mix(key) ^ ((const struct bstring *)strings)[i].len;
+	return key;
+}
+
+void
+verify_fingerprint(const void *strings, size_t n, size_t size,
+		struct fingerprint *fp)
+{
+	uint64_t sum0 = 0, sum1 = 0;
+#pragma omp parallel for schedule(static) reduction(+:sum0,sum1)
+	for (size_t i=0; i < n; ++i) {
+		const uint64_t key = element_key(strings, i, size);
+		sum0 += mix(key);
+		sum1 += mix(key ^ 0x9e3779b97f4a7c15ULL);
+	}
+	fp->sum[0] = sum0;
+	fp->sum[1] = sum1;
+}
+
+int
+verify_permutation(const struct fingerprint *before,
+		const struct fingerprint *after)
+{
+	if (before->sum[0] == after->sum[0]
+			&& before->sum[1] == after->sum[1])
+		return 0;
+	fprintf(stderr,
+		"WARNING: the output is not a permutation of the input, "
+		"strings were lost or duplicated!\n");
+	return 1;
+}
+
+/* Compares the strings i-1 and i, and counts the failures like
+ * check_result(). */
+static inline void
+check_pair(const void *strings, size_t i, size_t size,
+		const unsigned char *text,
+		size_t *wrong, size_t *identical, size_t *invalid)
+{
+	if (size == sizeof(struct bstring)) {
+		const struct bstring *s = (const struct bstring *)strings;
+		if (s[i-1].ptr == s[i].ptr && s[i-1].len == s[i].len)
+			++*identical;
+		else if (bstring_cmp(&s[i-1], &s[i]) > 0)
+			++*wrong;
+		return;
+	}
+	const uintptr_t a = string_key(strings, i-1, size);
+	const uintptr_t b = string_key(strings, i, size);
+	if (a == b) {
+		++*identical;
+		return;
+	}
+	if (size == sizeof(uint32_t)) {
+		if (strcmp((const char *)text+a, (const char *)text+b) > 0)
+			++*wrong;
+	} else if (a == 0 || b == 0) {
+		++*invalid;
+	} else if (strcmp((const char *)a, (const char *)b) > 0) {
+		++*wrong;
+	}
+}
+
+int
+verify_sorted(const void *strings, size_t n, size_t size,
+		const unsigned char *text)
+{
+	size_t wrong = 0, identical = 0, invalid = 0;
+#pragma omp parallel for schedule(static, 65536) \
+		reduction(+:wrong,identical,invalid)
+	for (size_t i=1; i < n; ++i)
+		check_pair(strings, i, size, text, &wrong, &identical,
+				&invalid);
+	if (identical)
+		fprintf(stderr,
+			"WARNING: found %zu identical %s!\n",
+			identical, size == sizeof(uint32_t)
+			? "offsets" : "pointers");
+	if (wrong)
+		fprintf(stderr,
+			"WARNING: found %zu incorrect orderings!\n",
+			wrong);
+	if (invalid)
+		fprintf(stderr,
+			"WARNING: found %zu invalid pointers!\n",
+			invalid);
+	if (identical || wrong || invalid)
+		return 1;
+	return 0;
+}
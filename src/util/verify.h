@@ -0,0 +1,70 @@
+/*
+ * Copyright 2026 by agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Parallel verification of the sort result. The order check of check_result()
+ * only compares neighbours, so it misses a lost string whose slot was filled
+ * with a copy of another string, as long as the copy lands between equal
+ * strings. Verifying the permutation directly would need a copy of the input
+ * and a sort of the pointers, so instead a fingerprint of the multiset of
+ * string pointers is taken before and after sorting: each pointer is hashed,
+ * and the hashes are summed, which does not depend on the order. A lost or
+ * duplicated pointer changes the sums, except with a probability of about
+ * 2^-128.
+ */
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct fingerprint {
+	uint64_t sum[2];
+};
+
+/* Computes the fingerprint of n elements of `size' bytes, which begin with
+ * the string pointer, or with size 4 are 32-bit string offsets. */
+void verify_fingerprint(const void *strings, size_t n, size_t size,
+		struct fingerprint *);
+
+/* Returns 0 if the fingerprints are equal, otherwise prints a warning and
+ * returns 1. */
+int verify_permutation(const struct fingerprint *before,
+		const struct fingerprint *after);
+
+/* Parallel check_result(), check_result_offsets() and check_result_binary():
+ * the element size selects between string pointers, 32-bit offsets from
+ * `text', and struct bstring. Returns 0 if the strings are in order,
+ * otherwise prints warnings and returns 1. */
+int verify_sorted(const void *strings, size_t n, size_t size,
+		const unsigned char *text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VERIFY_H */
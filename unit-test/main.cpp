@@ -7,14 +7,25 @@ static int cmp(int a, int b);
 #include "../src/vector_malloc.h"
 #include "../src/losertree.h"
 #include "../src/routines.h"
+#include "../src/libsortstring.h"
 #include "../src/util/insertion_sort.h"
+#include "../src/util/permutation.h"
+#include "../src/util/collation.h"
+#include "../src/util/bigalloc.h"
+#include "../src/util/verify.h"
+#include "../src/external_sort.h"
 #include <iostream>
 #include <array>
 #include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
 #include <utility>
 
 #undef NDEBUG
 #include <cassert>
+#include <cstring>
+#include <unistd.h>
 
 template <typename Ch1, typename Ch2>
 static int strcmp_u(Ch1 *a, Ch2 *b)
@@ -157,6 +168,83 @@ test_loser_tree()
 	}
 }
 
+struct lcp_test_stream
+{
+	std::vector<const char *> strs;
+	size_t pos;
+
+	bool empty() const { return pos == strs.size(); }
+	unsigned char* head() const { return (unsigned char *)strs[pos]; }
+	size_t head_lcp() const
+	{
+		size_t i = 0;
+		if (pos == 0) return 0;
+		while (strs[pos-1][i] && strs[pos-1][i] == strs[pos][i]) ++i;
+		return i;
+	}
+	void next() { ++pos; }
+};
+
+static void
+test_lcp_loser_tree()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+	{
+		std::vector<lcp_test_stream> streams(1);
+		streams[0].strs = { "a", "ab", "abc" };
+		streams[0].pos = 0;
+		lcp_loser_tree<lcp_test_stream> tree(streams.data(), streams.size());
+		assert(strcmp_u(tree.top(), "a") == 0);   tree.pop();
+		assert(strcmp_u(tree.top(), "ab") == 0);  assert(tree.top_lcp() == 1); tree.pop();
+		assert(strcmp_u(tree.top(), "abc") == 0); assert(tree.top_lcp() == 2); tree.pop();
+		assert(tree.empty());
+	}
+	{
+		std::vector<lcp_test_stream> streams(3);
+		streams[0].strs = { "aaa", "aab", "b" };
+		streams[1].strs = { "aa", "aab", "aac", "ba" };
+		streams[2].strs = { };
+		for (unsigned i=0; i < streams.size(); ++i) streams[i].pos = 0;
+		lcp_loser_tree<lcp_test_stream> tree(streams.data(), streams.size());
+		const char *expected[] = { "aa", "aaa", "aab", "aab", "aac", "b", "ba" };
+		const size_t expected_lcp[] = { 0, 2, 2, 3, 2, 0, 1 };
+		for (unsigned i=0; i < 7; ++i) {
+			assert(!tree.empty());
+			assert(strcmp_u(tree.top(), expected[i]) == 0);
+			assert(tree.top_lcp() == expected_lcp[i]);
+			tree.pop();
+		}
+		assert(tree.empty());
+	}
+	{
+		const unsigned k = 37;
+		std::vector<std::vector<std::string> > data(k);
+		std::vector<std::string> all;
+		for (unsigned i=0; i < 5000; ++i) {
+			std::string s;
+			for (unsigned j=0; j < 1+i%7; ++j)
+				s += char('a' + (i*7919+j*31)%3);
+			data[i%k].push_back(s);
+			all.push_back(s);
+		}
+		std::vector<lcp_test_stream> streams(k);
+		for (unsigned i=0; i < k; ++i) {
+			std::sort(data[i].begin(), data[i].end());
+			for (unsigned j=0; j < data[i].size(); ++j)
+				streams[i].strs.push_back(data[i][j].c_str());
+			streams[i].pos = 0;
+		}
+		std::sort(all.begin(), all.end());
+		lcp_loser_tree<lcp_test_stream> tree(streams.data(), streams.size());
+		for (unsigned i=0; i < all.size(); ++i) {
+			assert(!tree.empty());
+			assert(all[i] == (const char *)tree.top());
+			tree.pop();
+		}
+		assert(tree.empty());
+	}
+}
+
 static void
 test_insertion_sort()
 {
@@ -214,6 +302,8 @@ test_routines()
 	routine_get_all(&routines, &routines_cnt);
 
 	for (unsigned i=0; i < routines_cnt; ++i) {
+		if (routines[i]->suffixes_only)
+			continue;
 		std::cerr << __PRETTY_FUNCTION__
 			<< " [" << routines[i]->name << ']' << std::endl;
 
@@ -252,6 +342,22 @@ test_routines()
 			for (size_t i=0; i < n; ++i)
 				free(input[i]);
 		}
+		// Sizes at which the two halves of mergesort_lcp_2way end up
+		// sorted in different arrays.
+		for (size_t n : { 127, 253, 254, 255, 505, 510, 1021 }) {
+			std::vector<char *> input;
+			srand48(n);
+			for (size_t i=0; i < n; ++i) {
+				char buf[16];
+				snprintf(buf, sizeof(buf), "%ld",
+						lrand48() % 1000);
+				input.push_back(strdup(buf));
+			}
+			routines[i]->f((unsigned char **)input.data(), n);
+			assert(check_result((unsigned char**)input.data(), n) == 0);
+			for (size_t i=0; i < n; ++i)
+				free(input[i]);
+		}
 		for (size_t k=1; k < 10000; k += 2000) {
 			std::vector<char *> input;
 			for (size_t i=0; i < k; ++i) {
@@ -271,6 +377,772 @@ test_routines()
 	}
 }
 
+static void
+test_binary_routines()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	const struct routine **routines;
+	unsigned routines_cnt;
+	routine_get_all(&routines, &routines_cnt);
+
+	// Keys over a tiny alphabet that includes NUL, with many proper
+	// prefixes and duplicates, and a few long runs of NUL bytes.
+	std::vector<std::string> keys;
+	srand48(1);
+	for (size_t i=0; i < 70000; ++i) {
+		std::string key(lrand48() % 12, '\0');
+		for (size_t j=0; j < key.size(); ++j)
+			key[j] = "\0\1\377a"[lrand48() % 4];
+		if (i % 1000 == 0)
+			key.append(std::string(lrand48() % 100, '\0'));
+		keys.push_back(key);
+	}
+
+	for (unsigned i=0; i < routines_cnt; ++i) {
+		if (not routines[i]->f_binary)
+			continue;
+		std::cerr << __PRETTY_FUNCTION__
+			<< " [" << routines[i]->name << ']' << std::endl;
+		for (size_t n : { size_t(0), size_t(1), size_t(31), size_t(1000),
+		                  keys.size() }) {
+			std::vector<bstring> input;
+			for (size_t k=0; k < n; ++k)
+				input.push_back({ (unsigned char *)keys[k].data(),
+				                  keys[k].size() });
+			routines[i]->f_binary(input.data(), n);
+			std::vector<std::string> expected(keys.begin(),
+					keys.begin()+n);
+			std::sort(expected.begin(), expected.end());
+			for (size_t k=0; k < n; ++k)
+				assert(std::string((char *)input[k].ptr,
+						input[k].len) == expected[k]);
+		}
+	}
+}
+
+static void
+test_offset_routines()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	const struct routine **routines;
+	unsigned routines_cnt;
+	routine_get_all(&routines, &routines_cnt);
+
+	std::vector<std::string> keys;
+	srand48(2);
+	for (size_t i=0; i < 70000; ++i) {
+		std::string key(lrand48() % 12, 'a');
+		for (size_t j=0; j < key.size(); ++j)
+			key[j] = "abc\377"[lrand48() % 4];
+		keys.push_back(key);
+	}
+
+	for (unsigned i=0; i < routines_cnt; ++i) {
+		if (not routines[i]->f_offset)
+			continue;
+		std::cerr << __PRETTY_FUNCTION__
+			<< " [" << routines[i]->name << ']' << std::endl;
+		for (size_t n : { size_t(0), size_t(1), size_t(31), size_t(1000),
+		                  keys.size() }) {
+			// The NUL terminated keys are stored back to back.
+			std::string text;
+			std::vector<uint32_t> input;
+			for (size_t k=0; k < n; ++k) {
+				input.push_back(text.size());
+				text.append(keys[k].c_str(), keys[k].size()+1);
+			}
+			routines[i]->f_offset(input.data(), n,
+					(unsigned char *)&text[0]);
+			std::vector<std::string> expected(keys.begin(),
+					keys.begin()+n);
+			std::sort(expected.begin(), expected.end());
+			for (size_t k=0; k < n; ++k)
+				assert(std::string(text.c_str()+input[k]) == expected[k]);
+		}
+	}
+}
+
+static void
+test_top_routines()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	const struct routine **routines;
+	unsigned routines_cnt;
+	routine_get_all(&routines, &routines_cnt);
+
+	// Enough strings with common prefixes to burst the burstsort buckets.
+	std::vector<std::string> keys;
+	srand48(3);
+	for (size_t i=0; i < 50000; ++i) {
+		std::string key(1 + lrand48() % 8, 'a');
+		for (size_t j=0; j < key.size(); ++j)
+			key[j] = "abcd"[lrand48() % (j < 2 ? 1 : 4)];
+		keys.push_back(key);
+	}
+	std::vector<std::string> expected(keys);
+	std::sort(expected.begin(), expected.end());
+
+	for (unsigned i=0; i < routines_cnt; ++i) {
+		if (not routines[i]->f_top)
+			continue;
+		std::cerr << __PRETTY_FUNCTION__
+			<< " [" << routines[i]->name << ']' << std::endl;
+		for (size_t k : { size_t(0), size_t(1), size_t(100),
+		                  size_t(12345), keys.size() }) {
+			std::vector<unsigned char*> input;
+			for (size_t j=0; j < keys.size(); ++j)
+				input.push_back((unsigned char *)keys[j].c_str());
+			routines[i]->f_top(input.data(), input.size(), k);
+			for (size_t j=0; j < k; ++j)
+				assert(expected[j] == (char *)input[j]);
+			assert(check_result_top(input.data(), input.size(), k) == 0);
+			std::sort(input.begin(), input.end());
+			assert(std::unique(input.begin(), input.end()) == input.end());
+		}
+	}
+}
+
+static void
+test_unique_routines()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	const struct routine **routines;
+	unsigned routines_cnt;
+	routine_get_all(&routines, &routines_cnt);
+
+	// Heavily duplicated keys, some of them proper prefixes of others.
+	std::vector<std::string> keys;
+	srand48(4);
+	for (size_t i=0; i < 50000; ++i)
+		keys.push_back(std::to_string(lrand48() % 3000)
+				+ std::string(lrand48() % 3, 'x'));
+	std::map<std::string, size_t> expected;
+	for (const std::string& key : keys)
+		++expected[key];
+
+	for (unsigned i=0; i < routines_cnt; ++i) {
+		if (not routines[i]->f_unique)
+			continue;
+		std::cerr << __PRETTY_FUNCTION__
+			<< " [" << routines[i]->name << ']' << std::endl;
+		for (bool with_counts : { false, true }) {
+			std::vector<unsigned char*> input;
+			for (size_t j=0; j < keys.size(); ++j)
+				input.push_back((unsigned char *)keys[j].c_str());
+			std::vector<size_t> counts(keys.size());
+			size_t m = routines[i]->f_unique(input.data(),
+					input.size(),
+					with_counts ? counts.data() : 0);
+			assert(m == expected.size());
+			size_t j = 0;
+			for (const auto& e : expected) {
+				assert(e.first == (char *)input[j]);
+				if (with_counts)
+					assert(e.second == counts[j]);
+				++j;
+			}
+			std::vector<unsigned char*> pristine;
+			for (size_t j=0; j < keys.size(); ++j)
+				pristine.push_back((unsigned char *)keys[j].c_str());
+			size_t* c = with_counts ? counts.data() : 0;
+			assert(check_result_unique(input.data(), m, c,
+					pristine.data(), pristine.size()) == 0);
+			// A dropped distinct string is still in order.
+			assert(check_result_unique(input.data()+1, m-1,
+					c ? c+1 : 0, pristine.data(),
+					pristine.size()) == 1);
+		}
+		unsigned char* empty = 0;
+		assert(routines[i]->f_unique(&empty, 0, 0) == 0);
+	}
+}
+
+static void
+test_lcp_routines()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	const struct routine **routines;
+	unsigned routines_cnt;
+	routine_get_all(&routines, &routines_cnt);
+
+	// Long shared prefixes and duplicates, enough strings to burst the
+	// trie nodes and to take the parallel code paths.
+	std::vector<std::string> keys;
+	srand48(5);
+	for (size_t i=0; i < 100000; ++i)
+		keys.push_back(std::string(lrand48() % 4, 'p')
+				+ std::to_string(lrand48() % 20000)
+				+ std::string(lrand48() % 3, 'x'));
+	keys.push_back("");
+	keys.push_back("");
+	std::vector<std::string> sorted(keys);
+	std::sort(sorted.begin(), sorted.end());
+	std::vector<size_t> expected(sorted.size());
+	for (size_t j=1; j < sorted.size(); ++j)
+		while (sorted[j-1][expected[j]]
+				and sorted[j-1][expected[j]]
+				== sorted[j][expected[j]])
+			++expected[j];
+
+	for (unsigned i=0; i < routines_cnt; ++i) {
+		if (not routines[i]->f_lcp or routines[i]->suffixes_only)
+			continue;
+		std::cerr << __PRETTY_FUNCTION__
+			<< " [" << routines[i]->name << ']' << std::endl;
+		std::vector<unsigned char*> input;
+		for (size_t j=0; j < keys.size(); ++j)
+			input.push_back((unsigned char *)keys[j].c_str());
+		std::vector<size_t> lcp(keys.size(), size_t(-1));
+		routines[i]->f_lcp(input.data(), input.size(), lcp.data());
+		for (size_t j=0; j < sorted.size(); ++j)
+			assert(sorted[j] == (char *)input[j]);
+		assert(lcp == expected);
+		unsigned char* empty = 0;
+		routines[i]->f_lcp(&empty, 0, 0);
+	}
+}
+
+static void
+test_perm_routines()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	const struct routine **routines;
+	unsigned routines_cnt;
+	routine_get_all(&routines, &routines_cnt);
+
+	// Duplicates, and enough strings for the radix sorts to distribute.
+	std::vector<std::string> keys;
+	srand48(7);
+	for (size_t i=0; i < 100000; ++i)
+		keys.push_back(std::to_string(lrand48() % 30000));
+	std::vector<std::string> sorted(keys);
+	std::sort(sorted.begin(), sorted.end());
+
+	for (unsigned i=0; i < routines_cnt; ++i) {
+		if (not routines[i]->f_perm)
+			continue;
+		std::cerr << __PRETTY_FUNCTION__
+			<< " [" << routines[i]->name << ']' << std::endl;
+		std::vector<unsigned char*> input;
+		for (size_t j=0; j < keys.size(); ++j)
+			input.push_back((unsigned char *)keys[j].c_str());
+		std::vector<unsigned char*> pristine(input);
+		std::vector<size_t> perm(keys.size(), size_t(-1));
+		routines[i]->f_perm(input.data(), input.size(), perm.data());
+		for (size_t j=0; j < sorted.size(); ++j)
+			assert(sorted[j] == (char *)input[j]);
+		assert(permutation_check(pristine.data(), input.data(),
+				input.size(), sizeof(unsigned char*),
+				perm.data()) == 0);
+		unsigned char* empty = 0;
+		routines[i]->f_perm(&empty, 0, 0);
+	}
+}
+
+static void
+test_collate_routines()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	unsigned char table[256];
+	assert(collation_parse("fold,digits-last", table) == 0);
+	assert(table['A'] == table['a']);
+	assert(table['z'] < table['0'] and table['9'] < table['{']);
+	assert(collation_parse("fold,", table) == 0);
+	assert(collation_parse("/nonexistent", table) == -1);
+	unsigned char zero[256] = { 0 };
+	assert(not collation_valid(zero));
+
+	assert(collation_parse("fold,digits-last", table) == 0);
+	const struct routine **routines;
+	unsigned routines_cnt;
+	routine_get_all(&routines, &routines_cnt);
+
+	// Mixed case hostname-like keys with digits, enough to take the
+	// adaptive code paths.
+	std::vector<std::string> keys;
+	const char alphabet[] = "aAbBzZ09.-";
+	srand48(7);
+	for (size_t i=0; i < 100000; ++i) {
+		std::string key(lrand48() % 8, 'h');
+		for (size_t j = lrand48() % 10; j > 0; --j)
+			key += alphabet[lrand48() % (sizeof(alphabet)-1)];
+		keys.push_back(key);
+	}
+	keys.push_back("");
+	// Strings that are equal in the collation may end up in any order,
+	// so compare the mapped strings.
+	std::vector<std::string> expected;
+	for (size_t j=0; j < keys.size(); ++j) {
+		std::string mapped(keys[j]);
+		for (size_t k=0; k < mapped.size(); ++k)
+			mapped[k] = table[(unsigned char)mapped[k]];
+		expected.push_back(mapped);
+	}
+	std::sort(expected.begin(), expected.end(),
+		[](const std::string& a, const std::string& b) {
+			return strcmp_u(a.c_str(), b.c_str()) < 0; });
+
+	for (unsigned i=0; i < routines_cnt; ++i) {
+		if (not routines[i]->f_collate)
+			continue;
+		std::cerr << __PRETTY_FUNCTION__
+			<< " [" << routines[i]->name << ']' << std::endl;
+		std::vector<unsigned char*> input;
+		for (size_t j=0; j < keys.size(); ++j)
+			input.push_back((unsigned char *)keys[j].c_str());
+		routines[i]->f_collate(input.data(), input.size(), table);
+		for (size_t j=0; j < input.size(); ++j) {
+			std::string mapped((char *)input[j]);
+			for (size_t k=0; k < mapped.size(); ++k)
+				mapped[k] = table[(unsigned char)mapped[k]];
+			assert(mapped == expected[j]);
+		}
+		std::sort(input.begin(), input.end());
+		assert(std::unique(input.begin(), input.end()) == input.end());
+	}
+}
+
+static void
+test_suffix_array_routines()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	const char* names[] = { "suffix_array_sais",
+	                        "suffix_array_doubling_parallel" };
+	// Random texts over small alphabets, and periodic texts that are the
+	// worst case for comparison based suffix sorting.
+	std::vector<std::string> texts = { "a", "ab", "ba", "banana",
+		"mississippi", std::string(1000, 'a') };
+	srand48(6);
+	for (unsigned alphabet : { 1, 2, 4, 26 })
+		for (size_t n : { 17, 100, 5000, 100000 }) {
+			// The expected result is sorted naively.
+			if (alphabet == 1 and n > 5000) continue;
+			std::string text;
+			for (size_t i=0; i < n; ++i)
+				text += char('a' + lrand48() % alphabet);
+			texts.push_back(text);
+		}
+	std::string periodic;
+	for (size_t i=0; i < 5000; ++i)
+		periodic += "abcab"[i % 5];
+	texts.push_back(periodic);
+
+	for (const std::string& text : texts) {
+		const size_t n = text.size();
+		unsigned char* t = (unsigned char*)text.c_str();
+		std::vector<size_t> expected(n);
+		for (size_t i=0; i < n; ++i)
+			expected[i] = i;
+		std::sort(expected.begin(), expected.end(),
+			[&text](size_t a, size_t b) {
+				return text.compare(a, std::string::npos,
+					text, b, std::string::npos) < 0; });
+		std::vector<size_t> expected_lcp(n);
+		for (size_t i=1; i < n; ++i)
+			while (t[expected[i-1]+expected_lcp[i]]
+					== t[expected[i]+expected_lcp[i]]
+					and t[expected[i]+expected_lcp[i]])
+				++expected_lcp[i];
+		for (const char* name : names) {
+			const struct routine* r = routine_from_name(name);
+			assert(r);
+			std::vector<unsigned char*> sa(n);
+			for (size_t i=0; i < n; ++i)
+				sa[i] = t+i;
+			std::vector<size_t> lcp(n, size_t(-1));
+			r->f_lcp(sa.data(), n, lcp.data());
+			for (size_t i=0; i < n; ++i)
+				assert(sa[i] == t+expected[i]);
+			assert(lcp == expected_lcp);
+		}
+	}
+	// Strings that are not the suffixes of a text are sorted too.
+	for (const char* name : names) {
+		const struct routine* r = routine_from_name(name);
+		std::vector<std::string> keys = { "c", "a", "b", "a" };
+		std::vector<unsigned char*> input;
+		for (const std::string& key : keys)
+			input.push_back((unsigned char*)key.c_str());
+		r->f(input.data(), input.size());
+		assert(strcmp((char*)input[0], "a") == 0);
+		assert(strcmp((char*)input[1], "a") == 0);
+		assert(strcmp((char*)input[2], "b") == 0);
+		assert(strcmp((char*)input[3], "c") == 0);
+		// Only the first suffixes of the text.
+		unsigned char text[] = "aab";
+		unsigned char* prefix[] = { text, text+1 };
+		r->f(prefix, 2);
+		assert(prefix[0] == text and prefix[1] == text+1);
+	}
+}
+
+static void
+test_natural_runs()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	const struct routine* r = routine_from_name("mergesort_lcp_natural");
+	assert(r);
+	// A sorted input, then one with an unsorted tail appended, then one
+	// with several runs of different lengths.
+	std::vector<std::string> keys;
+	srand48(7);
+	for (size_t i=0; i < 20000; ++i)
+		keys.push_back("p" + std::to_string(lrand48() % 5000));
+	std::sort(keys.begin(), keys.end());
+	for (size_t tail : { size_t(0), size_t(127), size_t(3000),
+			size_t(20000) }) {
+		for (size_t i=0; i < tail; ++i)
+			keys.push_back("p" + std::to_string(lrand48() % 5000));
+		if (tail == 20000)
+			for (size_t b=20000; b < keys.size(); b += 500 + b % 700)
+				std::sort(keys.begin()+b, keys.begin()
+					+ std::min(keys.size(), b+500+b%700));
+		std::vector<std::string> sorted(keys);
+		std::sort(sorted.begin(), sorted.end());
+		std::vector<unsigned char*> input;
+		for (const std::string& key : keys)
+			input.push_back((unsigned char *)key.c_str());
+		r->f(input.data(), input.size());
+		for (size_t j=0; j < sorted.size(); ++j)
+			assert(sorted[j] == (char *)input[j]);
+		input.clear();
+		for (const std::string& key : keys)
+			input.push_back((unsigned char *)key.c_str());
+		std::vector<size_t> lcp(keys.size());
+		r->f_lcp(input.data(), input.size(), lcp.data());
+		assert(check_result_lcp(input.data(), lcp.data(),
+					input.size(), NULL) == 0);
+		for (size_t j=0; j < sorted.size(); ++j)
+			assert(sorted[j] == (char *)input[j]);
+	}
+}
+
+static void
+test_permutation()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	// Input in no particular address order, with repeated pointers.
+	unsigned char text[] = "c\0a\0b\0";
+	unsigned char* input[] = { text+4, text, text+2, text, text+4, text };
+	const size_t n = sizeof(input)/sizeof(input[0]);
+	unsigned char* output[n];
+	std::copy(input, input+n, output);
+	std::sort(output, output+n, [](unsigned char* a, unsigned char* b) {
+		return strcmp((char*)a, (char*)b) < 0; });
+	size_t perm[n];
+	assert(permutation_recover(input, output, n, sizeof(unsigned char*),
+				perm) == 0);
+	assert(permutation_check(input, output, n, sizeof(unsigned char*),
+				perm) == 0);
+	const size_t expected[] = { 2, 0, 4, 1, 3, 5 };
+	for (size_t i=0; i < n; ++i)
+		assert(perm[i] == expected[i]);
+	std::swap(perm[0], perm[1]);
+	assert(permutation_check(input, output, n, sizeof(unsigned char*),
+				perm) == 1);
+	output[0] = text+1;
+	assert(permutation_recover(input, output, n, sizeof(unsigned char*),
+				perm) == -1);
+
+	// The offsets of the strings are ascending.
+	uint32_t offsets[] = { 0, 2, 4 }, sorted[] = { 2, 4, 0 };
+	assert(permutation_recover(offsets, sorted, 3, sizeof(uint32_t),
+				perm) == 0);
+	assert(perm[0] == 1 and perm[1] == 2 and perm[2] == 0);
+
+	// Binary keys that share the pointer differ in the length.
+	struct bstring keys[] = { { text, 2 }, { text, 1 }, { text, 2 } };
+	struct bstring keys_sorted[] = { keys[1], keys[0], keys[2] };
+	assert(permutation_recover(keys, keys_sorted, 3,
+				sizeof(struct bstring), perm) == 0);
+	assert(perm[0] == 1 and perm[1] == 0 and perm[2] == 2);
+	assert(permutation_check(keys, keys_sorted, 3,
+				sizeof(struct bstring), perm) == 0);
+}
+
+static void
+test_bigalloc()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	const struct big_policy saved = *big_policy_get();
+	struct big_policy policy = saved;
+	policy.threshold = 1 << 20;
+	policy.thp = 1;
+	policy.prefault = 1;
+	policy.numa = BIG_NUMA_LOCAL;
+	big_policy_set(&policy);
+	for (size_t bytes : { size_t(0), size_t(100), size_t(3 << 20) }) {
+		unsigned char* p = (unsigned char*) big_calloc(bytes, 1);
+		assert(p);
+		assert(uintptr_t(p) % 16 == 0);
+		for (size_t i=0; i < bytes; ++i) assert(p[i] == 0);
+		memset(p, 0xAA, bytes);
+		big_free(p);
+	}
+	big_free(0);
+	big_policy_set(&saved);
+	assert(big_calloc(SIZE_MAX/2, 4) == 0);
+	void* p = big_malloc(3 << 20);
+	assert(p);
+	big_free(p);
+}
+
+static void
+test_verify()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	unsigned char text[] = "a\0a\0a\0b\0";
+	unsigned char* input[] = { text+6, text+2, text, text+4 };
+	unsigned char* output[] = { text, text+2, text+4, text+6 };
+	const size_t n = 4;
+	struct fingerprint before, after;
+	verify_fingerprint(input, n, sizeof(unsigned char*), &before);
+	verify_fingerprint(output, n, sizeof(unsigned char*), &after);
+	assert(verify_sorted(output, n, sizeof(unsigned char*), NULL) == 0);
+	assert(verify_permutation(&before, &after) == 0);
+	assert(verify_sorted(input, n, sizeof(unsigned char*), NULL) == 1);
+
+	// A lost string replaced by a copy of an equal string is in order,
+	// and not next to its copy.
+	output[2] = text;
+	verify_fingerprint(output, n, sizeof(unsigned char*), &after);
+	assert(verify_sorted(output, n, sizeof(unsigned char*), NULL) == 0);
+	assert(verify_permutation(&before, &after) == 1);
+
+	uint32_t offsets[] = { 0, 2, 6 }, sorted[] = { 2, 0, 6 };
+	assert(verify_sorted(offsets, 3, sizeof(uint32_t), text) == 0);
+	assert(verify_sorted(sorted, 3, sizeof(uint32_t), text) == 0);
+	verify_fingerprint(offsets, 3, sizeof(uint32_t), &before);
+	verify_fingerprint(sorted, 3, sizeof(uint32_t), &after);
+	assert(verify_permutation(&before, &after) == 0);
+	std::swap(sorted[0], sorted[2]);
+	assert(verify_sorted(sorted, 3, sizeof(uint32_t), text) == 1);
+
+	struct bstring bstrings[] = { { text, 1 }, { text+6, 1 }, { text, 2 } };
+	assert(verify_sorted(bstrings, 3, sizeof(struct bstring), NULL) == 1);
+	std::swap(bstrings[1], bstrings[2]);
+	assert(verify_sorted(bstrings, 3, sizeof(struct bstring), NULL) == 0);
+
+	// The length is part of a binary key that shares the pointer.
+	verify_fingerprint(bstrings, 3, sizeof(struct bstring), &before);
+	bstrings[1] = bstrings[0];
+	verify_fingerprint(bstrings, 3, sizeof(struct bstring), &after);
+	assert(verify_permutation(&before, &after) == 1);
+	assert(verify_sorted(bstrings, 3, sizeof(struct bstring), NULL) == 1);
+}
+
+static void
+test_external_sort()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	char input[] = "/tmp/sortstring-test-XXXXXX";
+	char output[] = "/tmp/sortstring-test-XXXXXX";
+	int fd = mkstemp(input);
+	assert(fd != -1);
+	close(fd);
+	fd = mkstemp(output);
+	assert(fd != -1);
+	close(fd);
+	std::vector<std::string> strings;
+	FILE* fp = fopen(input, "w");
+	assert(fp);
+	srand48(7);
+	for (size_t i=0; i < 30000; ++i) {
+		strings.push_back(std::to_string(lrand48() % 5000));
+		fprintf(fp, "%s\n", strings.back().c_str());
+	}
+	fclose(fp);
+	std::sort(strings.begin(), strings.end());
+	// Arbitrary run sizes, with and without routine scratch memory.
+	for (const char* name : { "mergesort_lcp_2way",
+	                          "mergesort_lcp_2way_parallel",
+	                          "mergesort_lcp_natural",
+	                          "mergesort_3way",
+	                          "multikey_cache8" }) {
+		const struct routine* r = routine_from_name(name);
+		assert(r);
+		for (size_t block : { 4096, 16384, 65536 }) {
+		for (size_t blocks : { 5, 16 }) {
+			std::cerr << "\t" << name << " block=" << block
+				<< " memory=" << blocks*block << std::endl;
+			struct external_sort_opts opts;
+			struct external_sort_stats stats;
+			opts.input = input;
+			opts.output = output;
+			opts.tmpdir = "/tmp";
+			opts.delim = '\n';
+			opts.memory = blocks*block;
+			opts.block_size = block;
+			opts.check = 1;
+			external_sort(r, &opts, &stats);
+			assert(stats.strings == strings.size());
+			assert(stats.wrong_order == 0);
+			std::vector<std::string> result;
+			char line[64];
+			fp = fopen(output, "r");
+			assert(fp);
+			while (fgets(line, sizeof(line), fp)) {
+				line[strcspn(line, "\n")] = 0;
+				result.push_back(line);
+			}
+			fclose(fp);
+			assert(result == strings);
+		}
+		}
+	}
+	unlink(input);
+	unlink(output);
+}
+
+static void
+test_libsortstring()
+{
+	std::cerr<<__PRETTY_FUNCTION__<<std::endl;
+
+	assert(sortstring_routine_lookup("no_such_routine") == NULL);
+	assert(sortstring_routine_count() > 0);
+	const struct sortstring_routine *r = sortstring_routine_get(0);
+	assert(r);
+	assert(sortstring_routine_lookup(sortstring_routine_name(r)) == r);
+
+	r = sortstring_routine_lookup("msd_CE2");
+	assert(r);
+	assert(sortstring_scratch_size(r, 100) == SORTSTRING_SCRATCH_INTERNAL);
+
+	for (const char *name : { "mergesort_lcp_2way", "mergesort_4way",
+	                          "mergesort_losertree_64way", "msd_CE2" }) {
+		r = sortstring_routine_lookup(name);
+		assert(r);
+		const size_t n = 100000;
+		std::vector<std::string> data;
+		for (size_t i=0; i < n; ++i)
+			data.push_back(std::to_string((i*7919) % 65536));
+		std::vector<unsigned char *> input;
+		for (size_t i=0; i < n; ++i)
+			input.push_back((unsigned char *)data[i].c_str());
+		std::vector<size_t> lcp(n), perm(n);
+		std::vector<char> scratch;
+		struct sortstring_options opts = sortstring_options();
+		opts.size = sizeof(opts);
+		opts.lcp = lcp.data();
+		opts.permutation = perm.data();
+		size_t bytes = sortstring_scratch_size(r, n);
+		if (bytes != SORTSTRING_SCRATCH_INTERNAL) {
+			assert(bytes >= n*sizeof(unsigned char *));
+			scratch.resize(bytes);
+			opts.scratch = scratch.data();
+			opts.scratch_size = bytes - 1;
+			assert(sortstring_sort(r, input.data(), n, &opts) == -1);
+			opts.scratch_size = bytes;
+		}
+		assert(sortstring_sort(r, input.data(), n, &opts) == 0);
+		assert(check_result(input.data(), n) == 0);
+		assert(lcp[0] == 0);
+		for (size_t i=1; i < n; ++i) {
+			size_t h = 0;
+			while (input[i-1][h] && input[i-1][h] == input[i][h]) ++h;
+			assert(lcp[i] == h);
+		}
+		for (size_t i=0; i < n; ++i)
+			assert(input[i] == (unsigned char *)data[perm[i]].c_str());
+		// Without the LCP array the permutation variant is used.
+		for (size_t i=0; i < n; ++i)
+			input[i] = (unsigned char *)data[i].c_str();
+		opts = sortstring_options();
+		opts.size = sizeof(opts);
+		opts.permutation = perm.data();
+		assert(sortstring_sort(r, input.data(), n, &opts) == 0);
+		for (size_t i=0; i < n; ++i)
+			assert(input[i] == (unsigned char *)data[perm[i]].c_str());
+	}
+
+	r = sortstring_routine_lookup("mergesort_4way");
+	assert(not sortstring_routine_binary(r));
+	assert(sortstring_sort_binary(r, NULL, 0, NULL) == -1);
+	r = sortstring_routine_lookup("multikey_simd4");
+	assert(sortstring_routine_binary(r));
+	std::vector<std::string> keys = { std::string("a\0b", 3), "a",
+		std::string("a\0", 2), "", std::string("\0", 1), "b" };
+	std::vector<sortstring_key> input;
+	for (const std::string& key : keys)
+		input.push_back({ (unsigned char *)key.data(), key.size() });
+	std::vector<size_t> lcp(keys.size());
+	struct sortstring_options opts = sortstring_options();
+	opts.size = sizeof(opts);
+	opts.lcp = lcp.data();
+	assert(sortstring_sort_binary(r, input.data(), input.size(), &opts) == 0);
+	std::vector<std::string> expected(keys);
+	std::sort(expected.begin(), expected.end());
+	const size_t expected_lcp[] = { 0, 0, 0, 1, 2, 0 };
+	for (size_t i=0; i < keys.size(); ++i) {
+		assert(std::string((char *)input[i].ptr, input[i].len)
+				== expected[i]);
+		assert(lcp[i] == expected_lcp[i]);
+	}
+	// Prefixes of one buffer share the pointer.
+	unsigned char buf[] = "zzz";
+	std::vector<sortstring_key> prefixes = { { buf, 3 }, { buf, 1 },
+		{ buf, 2 }, { buf, 1 } };
+	std::vector<size_t> perm(prefixes.size());
+	opts = sortstring_options();
+	opts.size = sizeof(opts);
+	opts.permutation = perm.data();
+	assert(sortstring_sort_binary(r, prefixes.data(), prefixes.size(),
+				&opts) == 0);
+	const size_t expected_perm[] = { 1, 3, 2, 0 };
+	for (size_t i=0; i < prefixes.size(); ++i)
+		assert(perm[i] == expected_perm[i]);
+
+	unsigned char table[256];
+	assert(collation_parse("fold", table) == 0);
+	std::vector<unsigned char *> strings = { (unsigned char *)"b",
+		(unsigned char *)"B", (unsigned char *)"Ab", (unsigned char *)"a" };
+	opts = sortstring_options();
+	opts.size = sizeof(opts);
+	opts.collation = table;
+	assert(sortstring_sort(r, strings.data(), strings.size(), &opts) == -1);
+	r = sortstring_routine_lookup("msd_A");
+	assert(sortstring_routine_collate(r));
+	assert(sortstring_sort(r, strings.data(), strings.size(), &opts) == 0);
+	assert(check_result_collated(strings.data(), strings.size(), table) == 0);
+	assert(strcmp_u(strings[1], "Ab") == 0);
+	// `b' and `B' are equal under the table, so they share one character.
+	std::vector<size_t> collated_lcp(strings.size());
+	opts.lcp = collated_lcp.data();
+	assert(sortstring_sort(r, strings.data(), strings.size(), &opts) == 0);
+	assert(check_result_lcp(strings.data(), collated_lcp.data(),
+				strings.size(), table) == 0);
+	assert(collated_lcp[1] == 1 and collated_lcp[3] == 1);
+	opts.lcp = 0;
+	table['c'] = 0;
+	assert(sortstring_sort(r, strings.data(), strings.size(), &opts) == -1);
+	table['c'] = 'c';
+	assert(sortstring_sort(r, strings.data(), strings.size(), &opts) == 0);
+
+	// The options of an older caller end at its size.
+	opts.size = offsetof(struct sortstring_options, collation);
+	assert(sortstring_sort(r, strings.data(), strings.size(), &opts) == 0);
+	assert(check_result(strings.data(), strings.size()) == 0);
+	opts.size = sizeof(opts) + 1;
+	assert(sortstring_sort(r, strings.data(), strings.size(), &opts) == -1);
+	opts.size = 0;
+	assert(sortstring_sort(r, strings.data(), strings.size(), &opts) == -1);
+	assert(sortstring_sort_binary(r, NULL, 0, &opts) == -1);
+}
+
 struct OK { ~OK() { std::cerr << "*** All OK ***\n"; } };
 
 int main()
@@ -278,6 +1150,7 @@ int main()
 	OK ok;
 
 	test_loser_tree();
+	test_lcp_loser_tree();
 
 	test_basics<vector_brodnik<int> >();
 	test_basics<vector_bagwell<int> >();
@@ -300,4 +1173,18 @@ int main()
 	test_insertion_sort();
 
 	test_routines();
+	test_binary_routines();
+	test_offset_routines();
+	test_top_routines();
+	test_unique_routines();
+	test_lcp_routines();
+	test_perm_routines();
+	test_collate_routines();
+	test_suffix_array_routines();
+	test_natural_runs();
+	test_permutation();
+	test_bigalloc();
+	test_verify();
+	test_external_sort();
+	test_libsortstring();
 }